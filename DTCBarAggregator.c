@@ -0,0 +1,221 @@
+#include "DTCBarAggregator.h"
+
+#include <math.h>
+#include <string.h>
+
+static const int32_t intervals[DTC_BAR_INTERVAL_COUNT] = {
+    INTERVAL_1_SECOND,
+    INTERVAL_2_SECONDS,
+    INTERVAL_4_SECONDS,
+    INTERVAL_5_SECONDS,
+    INTERVAL_10_SECONDS,
+    INTERVAL_30_SECONDS,
+    INTERVAL_1_MINUTE,
+    INTERVAL_1_DAY,
+    INTERVAL_1_WEEK
+};
+
+/* The epoch is a Thursday, weeks start three days later on Sunday */
+#define WEEK_START_OFFSET (3 * 86400)
+
+int32_t DTCBarAggregator_interval(int index)
+{
+    return intervals[index];
+}
+
+int DTCBarAggregator_interval_index(int32_t interval)
+{
+    int i;
+
+    for (i = 0; i < DTC_BAR_INTERVAL_COUNT; i++) {
+        if (intervals[i] == interval)
+            return i;
+    }
+    return -1;
+}
+
+static t_DateTime bar_start(t_DateTime date_time, int32_t interval)
+{
+    t_DateTime offset = interval == INTERVAL_1_WEEK ? WEEK_START_OFFSET : 0;
+    t_DateTime remainder = (date_time - offset) % interval;
+
+    if (remainder < 0)
+        remainder += interval;
+    return date_time - remainder;
+}
+
+/* Adds a later bar of the same interval period into bar */
+static void merge_bar(struct s_HistoricalPriceDataRecordResponse *bar, const struct s_HistoricalPriceDataRecordResponse *later)
+{
+    if (later->High > bar->High)
+        bar->High = later->High;
+    if (later->Low < bar->Low)
+        bar->Low = later->Low;
+    bar->Last = later->Last;
+    bar->Volume += later->Volume;
+    bar->BidVolume += later->BidVolume;
+    bar->AskVolume += later->AskVolume;
+    bar->NumberTrades += later->NumberTrades;
+}
+
+static void report(struct DTCBarAggregator *aggregator, int index)
+{
+    aggregator->IsOpen[index] = 0;
+    if (aggregator->OnBar != NULL)
+        aggregator->OnBar(aggregator->Context, intervals[index], &aggregator->Bars[index]);
+}
+
+/* Merges the completed 1 second bar into the longer interval at index */
+static void roll_up(struct DTCBarAggregator *aggregator, int index, const struct s_HistoricalPriceDataRecordResponse *second)
+{
+    struct s_HistoricalPriceDataRecordResponse *bar = &aggregator->Bars[index];
+
+    if (aggregator->IsOpen[index] && second->StartingDateTime >= aggregator->BarEnd[index])
+        report(aggregator, index);
+
+    if (!aggregator->IsOpen[index]) {
+        *bar = *second;
+        bar->StartingDateTime = bar_start(second->StartingDateTime, intervals[index]);
+        aggregator->BarEnd[index] = bar->StartingDateTime + intervals[index];
+        aggregator->IsOpen[index] = 1;
+    } else {
+        merge_bar(bar, second);
+    }
+}
+
+static void close_second(struct DTCBarAggregator *aggregator)
+{
+    int i;
+
+    report(aggregator, 0);
+    for (i = 1; i < DTC_BAR_INTERVAL_COUNT; i++)
+        roll_up(aggregator, i, &aggregator->Bars[0]);
+}
+
+void DTCBarAggregator_init(struct DTCBarAggregator *aggregator, DTCBarHandler on_bar, void *context)
+{
+    int i;
+
+    memset(aggregator, 0, sizeof(*aggregator));
+    aggregator->OnBar = on_bar;
+    aggregator->Context = context;
+    aggregator->ReportedUntil = INT64_MIN;
+
+    for (i = 0; i < DTC_BAR_INTERVAL_COUNT; i++)
+        HistoricalPriceDataRecordResponse_init(&aggregator->Bars[i]);
+}
+
+void DTCBarAggregator_flush(struct DTCBarAggregator *aggregator, t_DateTime now)
+{
+    int i;
+
+    if (now > aggregator->ReportedUntil)
+        aggregator->ReportedUntil = now;
+
+    if (aggregator->IsOpen[0] && now >= aggregator->BarEnd[0])
+        close_second(aggregator);
+
+    for (i = 1; i < DTC_BAR_INTERVAL_COUNT; i++) {
+        if (aggregator->IsOpen[i] && now >= aggregator->BarEnd[i])
+            report(aggregator, i);
+    }
+}
+
+void DTCBarAggregator_finish(struct DTCBarAggregator *aggregator)
+{
+    int i;
+
+    if (aggregator->IsOpen[0])
+        close_second(aggregator);
+
+    for (i = 1; i < DTC_BAR_INTERVAL_COUNT; i++) {
+        if (aggregator->IsOpen[i])
+            report(aggregator, i);
+    }
+}
+
+void DTCBarAggregator_add_trade(struct DTCBarAggregator *aggregator, double date_time, double price, double volume, uint16_t at_bid_or_ask)
+{
+    struct s_HistoricalPriceDataRecordResponse *second = &aggregator->Bars[0];
+    t_DateTime time = (t_DateTime)floor(date_time);
+
+    if (time < aggregator->ReportedUntil)
+        time = aggregator->ReportedUntil;
+
+    /*
+     * Bars of every interval end on a second boundary, so nothing can complete
+     * within the forming second. Without one, a longer bar may have ended
+     * since the last flush.
+     */
+    if (!aggregator->IsOpen[0] || time >= aggregator->BarEnd[0])
+        DTCBarAggregator_flush(aggregator, time);
+
+    if (!aggregator->IsOpen[0]) {
+        second->StartingDateTime = time;
+        second->Open = price;
+        second->High = price;
+        second->Low = price;
+        second->Volume = 0;
+        second->BidVolume = 0;
+        second->AskVolume = 0;
+        second->NumberTrades = 0;
+        aggregator->BarEnd[0] = time + 1;
+        aggregator->IsOpen[0] = 1;
+    } else {
+        if (price > second->High)
+            second->High = price;
+        if (price < second->Low)
+            second->Low = price;
+    }
+
+    second->Last = price;
+    second->Volume += volume;
+    second->NumberTrades++;
+    if (at_bid_or_ask == AT_BID)
+        second->BidVolume += volume;
+    else if (at_bid_or_ask == AT_ASK)
+        second->AskVolume += volume;
+}
+
+void DTCBarAggregator_add_tick_record(struct DTCBarAggregator *aggregator, const struct s_HistoricalPriceDataTickRecordResponse *tick)
+{
+    DTCBarAggregator_add_trade(aggregator, tick->TradeDateTimeWithMilliseconds, tick->TradePrice, tick->TradeVolume, tick->BidOrAsk);
+}
+
+void DTCBarAggregator_add_trade_update(struct DTCBarAggregator *aggregator, const struct s_TradeIncrementalUpdate *trade)
+{
+    DTCBarAggregator_add_trade(aggregator, trade->TradeDateTimeUnix, trade->Price, trade->TradeVolume, trade->TradeAtBidOrAsk);
+}
+
+void DTCBarAggregator_add_trade_update_compact(struct DTCBarAggregator *aggregator, const struct s_TradeIncrementalUpdateCompact *trade)
+{
+    DTCBarAggregator_add_trade(aggregator, trade->TradeDateTimeUnix, trade->Price, trade->TradeVolume, trade->TradeAtBidOrAsk);
+}
+
+int DTCBarAggregator_current(const struct DTCBarAggregator *aggregator, int32_t interval, struct s_HistoricalPriceDataRecordResponse *bar)
+{
+    const struct s_HistoricalPriceDataRecordResponse *second = &aggregator->Bars[0];
+    int index = DTCBarAggregator_interval_index(interval);
+
+    if (index < 0)
+        return -1;
+
+    if (aggregator->IsOpen[index]) {
+        int second_is_later = index > 0 && aggregator->IsOpen[0] && second->StartingDateTime >= aggregator->BarEnd[index];
+
+        if (!second_is_later) {
+            *bar = aggregator->Bars[index];
+            if (index > 0 && aggregator->IsOpen[0])
+                merge_bar(bar, second);
+            return 0;
+        }
+    }
+
+    /* Nothing rolled up into the current period yet, the forming second is the whole bar so far */
+    if (aggregator->IsOpen[0]) {
+        *bar = *second;
+        bar->StartingDateTime = bar_start(second->StartingDateTime, interval);
+        return 0;
+    }
+    return -1;
+}
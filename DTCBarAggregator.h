@@ -0,0 +1,74 @@
+#ifndef __DTC_BAR_AGGREGATOR_H__
+#define __DTC_BAR_AGGREGATOR_H__
+
+/*
+ * Incremental bar aggregation of one symbol's trades into every
+ * HistoricalDataIntervalEnum interval from 1 second to 1 week.
+ *
+ * A trade only updates the forming 1 second bar. When that bar completes it
+ * is merged into the forming bar of each longer interval, so the longer
+ * intervals cost one merge per second of trading instead of one update per
+ * trade. A bar is passed to OnBar as soon as a trade, or a call to
+ * DTCBarAggregator_flush(), falls past its end; shorter intervals are
+ * reported before longer ones.
+ *
+ * Trades at the bid or ask (BidOrAskEnum) are added to BidVolume or
+ * AskVolume. Bars are aligned to the Unix epoch in UTC, weekly bars start on
+ * Sunday.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "DTCProtocol.h"
+
+/* 1, 2, 4, 5, 10 and 30 seconds, 1 minute, 1 day and 1 week */
+#define DTC_BAR_INTERVAL_COUNT 9
+
+typedef void (*DTCBarHandler)(void *context, int32_t interval, const struct s_HistoricalPriceDataRecordResponse *bar);
+
+struct DTCBarAggregator
+{
+    DTCBarHandler OnBar;
+    void *Context;
+    uint8_t IsOpen[DTC_BAR_INTERVAL_COUNT];
+    t_DateTime BarEnd[DTC_BAR_INTERVAL_COUNT];
+    t_DateTime ReportedUntil;               /* every bar ending at or before this was reported */
+    struct s_HistoricalPriceDataRecordResponse Bars[DTC_BAR_INTERVAL_COUNT];
+};
+
+/* The interval with index 0 .. DTC_BAR_INTERVAL_COUNT - 1, shortest first */
+int32_t DTCBarAggregator_interval(int index);
+
+/* Index of a HistoricalDataIntervalEnum interval, or -1 for INTERVAL_TICK and unknown values */
+int DTCBarAggregator_interval_index(int32_t interval);
+
+void DTCBarAggregator_init(struct DTCBarAggregator *aggregator, DTCBarHandler on_bar, void *context);
+
+/*
+ * Adds a trade at date_time, Unix time in seconds with a fraction. A trade
+ * older than the forming 1 second bar is counted in that bar, and one older
+ * than the time bars were last reported up to is counted as at that time,
+ * so a late trade never reopens a bar that was already reported.
+ */
+void DTCBarAggregator_add_trade(struct DTCBarAggregator *aggregator, double date_time, double price, double volume, uint16_t at_bid_or_ask);
+
+void DTCBarAggregator_add_tick_record(struct DTCBarAggregator *aggregator, const struct s_HistoricalPriceDataTickRecordResponse *tick);
+void DTCBarAggregator_add_trade_update(struct DTCBarAggregator *aggregator, const struct s_TradeIncrementalUpdate *trade);
+void DTCBarAggregator_add_trade_update_compact(struct DTCBarAggregator *aggregator, const struct s_TradeIncrementalUpdateCompact *trade);
+
+/* Reports every bar that ends at or before now, for quiet markets */
+void DTCBarAggregator_flush(struct DTCBarAggregator *aggregator, t_DateTime now);
+
+/* Reports all forming bars, e.g. at the end of a historical tick request */
+void DTCBarAggregator_finish(struct DTCBarAggregator *aggregator);
+
+/* Copies the forming bar of an interval into bar. Returns 0, or -1 if there is none. */
+int DTCBarAggregator_current(const struct DTCBarAggregator *aggregator, int32_t interval, struct s_HistoricalPriceDataRecordResponse *bar);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DTC_BAR_AGGREGATOR_H__ */
@@ -0,0 +1,329 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "DTCBarStore.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* Blocks added at most per growth of the file */
+#define MAX_GROWTH_BLOCKS 64
+
+static size_t file_size_for_blocks(uint64_t blocks)
+{
+    return DTC_BAR_STORE_DATA_OFFSET + (size_t)blocks * sizeof(struct DTCBarBlock);
+}
+
+static void set_mapping(struct DTCBarStore *store, void *map, size_t size)
+{
+    store->Header = (struct DTCBarStoreHeader *)map;
+    store->MapSize = size;
+    store->BlockCapacity = (size - DTC_BAR_STORE_DATA_OFFSET) / sizeof(struct DTCBarBlock);
+}
+
+static int map_store(struct DTCBarStore *store, size_t size)
+{
+    int prot = store->Writable ? PROT_READ | PROT_WRITE : PROT_READ;
+    void *map = mmap(NULL, size, prot, MAP_SHARED, store->Fd, 0);
+
+    if (map == MAP_FAILED)
+        return -1;
+
+    set_mapping(store, map, size);
+    return 0;
+}
+
+static int grow_store(struct DTCBarStore *store)
+{
+    uint64_t blocks = store->BlockCapacity;
+    size_t size;
+    void *map;
+
+    blocks += blocks == 0 ? 1 : blocks < MAX_GROWTH_BLOCKS ? blocks : MAX_GROWTH_BLOCKS;
+    size = file_size_for_blocks(blocks);
+
+    if (ftruncate(store->Fd, (off_t)size) != 0)
+        return -1;
+
+    /* The old mapping stays in place if this fails; the longer file is harmless */
+    map = mremap(store->Header, store->MapSize, size, MREMAP_MAYMOVE);
+    if (map == MAP_FAILED)
+        return -1;
+
+    set_mapping(store, map, size);
+    return 0;
+}
+
+int DTCBarStore_path(char *path, size_t size, const char *directory, const char *symbol, const char *exchange, int32_t interval)
+{
+    char name[SYMBOL_LENGTH + 1];
+    size_t i;
+    int length;
+
+    for (i = 0; i < SYMBOL_LENGTH && symbol[i] != '\0'; i++)
+        name[i] = symbol[i] == '/' ? '_' : symbol[i];
+    name[i] = '\0';
+
+    if (exchange != NULL && exchange[0] != '\0')
+        length = snprintf(path, size, "%s/%s-%.*s.%d.bars", directory, name, EXCHANGE_LENGTH, exchange, (int)interval);
+    else
+        length = snprintf(path, size, "%s/%s.%d.bars", directory, name, (int)interval);
+
+    if (length < 0 || (size_t)length >= size)
+        return -1;
+    return 0;
+}
+
+int DTCBarStore_open(struct DTCBarStore *store, const char *path, int32_t interval, int writable)
+{
+    const struct DTCBarStoreHeader *header;
+    struct stat st;
+    int error;
+
+    store->Fd = open(path, writable ? O_RDWR | O_CREAT | O_CLOEXEC : O_RDONLY | O_CLOEXEC, 0644);
+    if (store->Fd < 0)
+        return -1;
+
+    store->Writable = writable;
+    store->Header = NULL;
+
+    if (fstat(store->Fd, &st) != 0)
+        goto fail;
+
+    if (st.st_size == 0 && writable) {
+        if (ftruncate(store->Fd, (off_t)file_size_for_blocks(1)) != 0
+            || map_store(store, file_size_for_blocks(1)) != 0)
+            goto fail;
+
+        memcpy(store->Header->Magic, DTC_BAR_STORE_MAGIC, sizeof(DTC_BAR_STORE_MAGIC));
+        store->Header->Version = DTC_BAR_STORE_VERSION;
+        store->Header->Interval = interval;
+        store->Header->BlockBars = DTC_BAR_BLOCK_BARS;
+        store->Count = 0;
+        return 0;
+    }
+
+    if ((size_t)st.st_size < DTC_BAR_STORE_DATA_OFFSET) {
+        errno = EINVAL;
+        goto fail;
+    }
+    if (map_store(store, (size_t)st.st_size) != 0)
+        goto fail;
+
+    header = store->Header;
+    if (memcmp(header->Magic, DTC_BAR_STORE_MAGIC, sizeof(DTC_BAR_STORE_MAGIC)) != 0
+        || header->Version != DTC_BAR_STORE_VERSION || header->Interval != interval
+        || header->BlockBars != DTC_BAR_BLOCK_BARS) {
+        errno = EINVAL;
+        goto fail;
+    }
+
+    /* A writer may have grown the file past this mapping since the fstat() */
+    store->Count = __atomic_load_n(&header->Count, __ATOMIC_ACQUIRE);
+    if (store->Count > store->BlockCapacity * DTC_BAR_BLOCK_BARS) {
+        if (writable) {
+            errno = EINVAL;
+            goto fail;
+        }
+        store->Count = store->BlockCapacity * DTC_BAR_BLOCK_BARS;
+    }
+    return 0;
+
+fail:
+    error = errno;
+    if (store->Header != NULL)
+        munmap(store->Header, store->MapSize);
+    close(store->Fd);
+    store->Header = NULL;
+    store->Fd = -1;
+    errno = error;
+    return -1;
+}
+
+void DTCBarStore_close(struct DTCBarStore *store)
+{
+    uint64_t used_blocks;
+
+    if (store->Fd < 0)
+        return;
+
+    if (store->Header != NULL) {
+        used_blocks = (store->Count + DTC_BAR_BLOCK_BARS - 1) / DTC_BAR_BLOCK_BARS;
+        munmap(store->Header, store->MapSize);
+
+        /* Give back the preallocated blocks, keeping one for an empty store */
+        if (store->Writable) {
+            if (used_blocks == 0)
+                used_blocks = 1;
+            while (ftruncate(store->Fd, (off_t)file_size_for_blocks(used_blocks)) != 0 && errno == EINTR)
+                ;
+        }
+    }
+
+    close(store->Fd);
+    store->Fd = -1;
+    store->Header = NULL;
+    store->Count = 0;
+}
+
+uint64_t DTCBarStore_count(const struct DTCBarStore *store)
+{
+    return store->Count;
+}
+
+struct DTCBarBlock *DTCBarStore_block(const struct DTCBarStore *store, uint64_t index)
+{
+    unsigned char *data = (unsigned char *)store->Header + DTC_BAR_STORE_DATA_OFFSET;
+
+    return (struct DTCBarBlock *)(data + (size_t)(index / DTC_BAR_BLOCK_BARS) * sizeof(struct DTCBarBlock));
+}
+
+static t_DateTime bar_time(const struct DTCBarStore *store, uint64_t index)
+{
+    return DTCBarStore_block(store, index)->StartingDateTime[DTC_BAR_BLOCK_INDEX(index)];
+}
+
+int DTCBarStore_append(struct DTCBarStore *store, const struct s_HistoricalPriceDataRecordResponse *bar)
+{
+    uint64_t count;
+    uint64_t index;
+    struct DTCBarBlock *block;
+    size_t i;
+
+    if (!store->Writable) {
+        errno = EBADF;
+        return -1;
+    }
+
+    count = store->Count;
+    index = count;
+    if (count > 0) {
+        t_DateTime last = bar_time(store, count - 1);
+
+        if (bar->StartingDateTime < last) {
+            errno = EINVAL;
+            return -1;
+        }
+        if (bar->StartingDateTime == last)
+            index = count - 1;
+    }
+
+    if (index / DTC_BAR_BLOCK_BARS >= store->BlockCapacity && grow_store(store) != 0)
+        return -1;
+
+    block = DTCBarStore_block(store, index);
+    i = DTC_BAR_BLOCK_INDEX(index);
+    block->StartingDateTime[i] = bar->StartingDateTime;
+    block->Open[i] = bar->Open;
+    block->High[i] = bar->High;
+    block->Low[i] = bar->Low;
+    block->Last[i] = bar->Last;
+    block->Volume[i] = bar->Volume;
+    block->BidVolume[i] = bar->BidVolume;
+    block->AskVolume[i] = bar->AskVolume;
+    block->NumberTrades[i] = bar->NumberTrades;
+
+    /* Readers that see the new count must see the bar */
+    if (index == count) {
+        store->Count = count + 1;
+        __atomic_store_n(&store->Header->Count, store->Count, __ATOMIC_RELEASE);
+    }
+    return 0;
+}
+
+uint64_t DTCBarStore_lower_bound(const struct DTCBarStore *store, t_DateTime date_time)
+{
+    uint64_t low = 0;
+    uint64_t high = store->Count;
+
+    while (low < high) {
+        uint64_t middle = low + (high - low) / 2;
+
+        if (bar_time(store, middle) < date_time)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+void DTCBarStore_range(const struct DTCBarStore *store, t_DateTime start, t_DateTime end, struct DTCBarCursor *cursor)
+{
+    cursor->Next = start != 0 ? DTCBarStore_lower_bound(store, start) : 0;
+    cursor->End = end != 0 && end != INT64_MAX ? DTCBarStore_lower_bound(store, end + 1) : store->Count;
+
+    if (cursor->End < cursor->Next)
+        cursor->End = cursor->Next;
+}
+
+size_t DTCBarStore_read(const struct DTCBarStore *store, struct DTCBarCursor *cursor,
+                        struct s_HistoricalPriceDataRecordResponse *records, size_t max)
+{
+    size_t filled = 0;
+
+    while (filled < max && cursor->Next < cursor->End) {
+        const struct DTCBarBlock *block = DTCBarStore_block(store, cursor->Next);
+        size_t i = DTC_BAR_BLOCK_INDEX(cursor->Next);
+        struct s_HistoricalPriceDataRecordResponse *record = &records[filled++];
+
+        HistoricalPriceDataRecordResponse_init(record);
+        record->StartingDateTime = block->StartingDateTime[i];
+        record->Open = block->Open[i];
+        record->High = block->High[i];
+        record->Low = block->Low[i];
+        record->Last = block->Last[i];
+        record->Volume = block->Volume[i];
+        record->NumberTrades = block->NumberTrades[i];
+        record->BidVolume = block->BidVolume[i];
+        record->AskVolume = block->AskVolume[i];
+
+        cursor->Next++;
+        record->FinalRecord = cursor->Next == cursor->End;
+    }
+    return filled;
+}
+
+void DTCBarStore_summarize(const struct DTCBarStore *store, uint64_t first, uint64_t count, struct DTCBarSummary *summary)
+{
+    uint64_t end = first + count;
+    uint64_t index = first;
+
+    memset(summary, 0, sizeof(*summary));
+    if (count == 0)
+        return;
+
+    summary->Count = count;
+    summary->StartingDateTime = bar_time(store, first);
+    summary->Open = DTCBarStore_block(store, first)->Open[DTC_BAR_BLOCK_INDEX(first)];
+    summary->Last = DTCBarStore_block(store, end - 1)->Last[DTC_BAR_BLOCK_INDEX(end - 1)];
+    summary->High = DTCBarStore_block(store, first)->High[DTC_BAR_BLOCK_INDEX(first)];
+    summary->Low = DTCBarStore_block(store, first)->Low[DTC_BAR_BLOCK_INDEX(first)];
+
+    /* One pass per block over the columns that are combined */
+    while (index < end) {
+        const struct DTCBarBlock *block = DTCBarStore_block(store, index);
+        size_t i = DTC_BAR_BLOCK_INDEX(index);
+        size_t stop = DTC_BAR_BLOCK_BARS;
+
+        if (end - index < stop - i)
+            stop = i + (size_t)(end - index);
+        index += stop - i;
+
+        for (; i < stop; i++) {
+            if (block->High[i] > summary->High)
+                summary->High = block->High[i];
+            if (block->Low[i] < summary->Low)
+                summary->Low = block->Low[i];
+            summary->Volume += block->Volume[i];
+            summary->BidVolume += block->BidVolume[i];
+            summary->AskVolume += block->AskVolume[i];
+            summary->NumberTrades += block->NumberTrades[i];
+        }
+    }
+}
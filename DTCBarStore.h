@@ -0,0 +1,143 @@
+#ifndef __DTC_BAR_STORE_H__
+#define __DTC_BAR_STORE_H__
+
+/*
+ * Columnar memory-mapped store of historical bars, one file per symbol and
+ * HistoricalDataIntervalEnum interval (POSIX).
+ *
+ * Bars are kept in blocks of DTC_BAR_BLOCK_BARS bars. Inside a block every
+ * field of s_HistoricalPriceDataRecordResponse is its own array, so a range
+ * scan or an aggregate only reads the columns it uses. Bars are appended in
+ * StartingDateTime order, which lets a HistoricalPriceDataRequest range be
+ * found by binary search on the time column.
+ *
+ * A reader sees the bars that were stored when it opened the file: it keeps
+ * the count it found then, cut to what its mapping covers, while a writer
+ * may go on appending and growing the file. The writer publishes the count
+ * only after the bar's columns are written. The last bar seen may still be
+ * replaced while it is being read.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "DTCProtocol.h"
+
+#define DTC_BAR_STORE_MAGIC                 "DTCBARS"
+#define DTC_BAR_STORE_VERSION               1
+#define DTC_BAR_BLOCK_BARS                  4096
+
+/* The first block starts on the page after the header */
+#define DTC_BAR_STORE_DATA_OFFSET           4096
+
+struct DTCBarStoreHeader
+{
+    char Magic[8];
+    uint32_t Version;
+    int32_t Interval;                       /* HistoricalDataIntervalEnum */
+    uint64_t Count;
+    uint32_t BlockBars;
+    uint32_t Reserved;
+};
+
+struct DTCBarBlock
+{
+    t_DateTime StartingDateTime[DTC_BAR_BLOCK_BARS];
+    double Open[DTC_BAR_BLOCK_BARS];
+    double High[DTC_BAR_BLOCK_BARS];
+    double Low[DTC_BAR_BLOCK_BARS];
+    double Last[DTC_BAR_BLOCK_BARS];
+    double Volume[DTC_BAR_BLOCK_BARS];
+    double BidVolume[DTC_BAR_BLOCK_BARS];
+    double AskVolume[DTC_BAR_BLOCK_BARS];
+    uint32_t NumberTrades[DTC_BAR_BLOCK_BARS];     /* or OpenInterest */
+};
+
+struct DTCBarStore
+{
+    int Fd;
+    int Writable;
+    struct DTCBarStoreHeader *Header;
+    size_t MapSize;
+    uint64_t BlockCapacity;                 /* blocks that fit in the mapping */
+    uint64_t Count;                         /* bars visible through this store */
+};
+
+/* A range of bars being read out */
+struct DTCBarCursor
+{
+    uint64_t Next;
+    uint64_t End;                           /* one past the last bar */
+};
+
+struct DTCBarSummary
+{
+    uint64_t Count;
+    t_DateTime StartingDateTime;
+    double Open;
+    double High;
+    double Low;
+    double Last;
+    double Volume;
+    double BidVolume;
+    double AskVolume;
+    uint64_t NumberTrades;
+};
+
+/*
+ * Writes <directory>/<symbol>[-<exchange>].<interval>.bars into path, with
+ * '/' in the symbol replaced by '_'. Returns -1 if it does not fit.
+ */
+int DTCBarStore_path(char *path, size_t size, const char *directory, const char *symbol, const char *exchange, int32_t interval);
+
+/*
+ * Opens a store read-only, or for appending with writable set, in which case
+ * a missing file is created. Returns 0 or -1 with errno set (EINVAL if the
+ * file is not a bar store of this interval).
+ */
+int DTCBarStore_open(struct DTCBarStore *store, const char *path, int32_t interval, int writable);
+
+/* Trims the unused preallocated blocks of a writable store */
+void DTCBarStore_close(struct DTCBarStore *store);
+
+uint64_t DTCBarStore_count(const struct DTCBarStore *store);
+
+/*
+ * Appends a bar. A bar with the StartingDateTime of the last one replaces it,
+ * so a bar that is still forming can be stored repeatedly. Returns 0, or -1
+ * with errno set (EINVAL for a bar older than the last one).
+ */
+int DTCBarStore_append(struct DTCBarStore *store, const struct s_HistoricalPriceDataRecordResponse *bar);
+
+/* The block holding bar index, and the position of the bar within it */
+struct DTCBarBlock *DTCBarStore_block(const struct DTCBarStore *store, uint64_t index);
+#define DTC_BAR_BLOCK_INDEX(index) ((size_t)((index) % DTC_BAR_BLOCK_BARS))
+
+/* Index of the first bar starting at or after date_time */
+uint64_t DTCBarStore_lower_bound(const struct DTCBarStore *store, t_DateTime date_time);
+
+/*
+ * Positions cursor on the bars starting within [start, end]. As in
+ * HistoricalPriceDataRequest, start 0 means from the first bar and end 0 up
+ * to the last one.
+ */
+void DTCBarStore_range(const struct DTCBarStore *store, t_DateTime start, t_DateTime end, struct DTCBarCursor *cursor);
+
+/*
+ * Fills up to max initialised record responses from the cursor. FinalRecord
+ * is set on the last bar of the range. Returns the number filled.
+ */
+size_t DTCBarStore_read(const struct DTCBarStore *store, struct DTCBarCursor *cursor,
+                        struct s_HistoricalPriceDataRecordResponse *records, size_t max);
+
+/* Combines count bars from first into one bar */
+void DTCBarStore_summarize(const struct DTCBarStore *store, uint64_t first, uint64_t count, struct DTCBarSummary *summary);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DTC_BAR_STORE_H__ */
@@ -0,0 +1,133 @@
+#include "DTCCompression.h"
+
+#include <string.h>
+
+/* Reserves up to DTC_COMPRESS_CHUNK_SIZE contiguous bytes, halving down to a minimum */
+static unsigned char *reserve_output(struct DTCOutputRing *ring, size_t *size)
+{
+    size_t want;
+
+    for (want = DTC_COMPRESS_CHUNK_SIZE; want >= 64; want /= 2) {
+        unsigned char *out = (unsigned char *)DTCOutputRing_reserve(ring, want);
+
+        if (out != NULL) {
+            *size = want;
+            return out;
+        }
+    }
+    return NULL;
+}
+
+/* Runs deflate with flush until it needs more input or, for Z_FINISH, ends the stream */
+static int deflate_into(struct DTCCompressor *compressor, struct DTCOutputRing *ring, int flush)
+{
+    z_stream *stream = &compressor->Stream;
+
+    for (;;) {
+        size_t size;
+        unsigned char *out = reserve_output(ring, &size);
+        int result;
+
+        if (out == NULL)
+            return DTC_COMPRESS_OUTPUT_FULL;
+
+        stream->next_out = out;
+        stream->avail_out = (uInt)size;
+        result = deflate(stream, flush);
+        DTCOutputRing_commit(ring, size - stream->avail_out);
+
+        if (result == Z_STREAM_END)
+            return DTC_COMPRESS_OK;
+        if (result != Z_OK && result != Z_BUF_ERROR)
+            return DTC_COMPRESS_ERROR;
+
+        /* Output space left over means deflate has nothing more to write */
+        if (stream->avail_out != 0 && stream->avail_in == 0 && flush != Z_FINISH)
+            return DTC_COMPRESS_OK;
+    }
+}
+
+int DTCCompressor_init(struct DTCCompressor *compressor, int level)
+{
+    memset(&compressor->Stream, 0, sizeof(compressor->Stream));
+    return deflateInit(&compressor->Stream, level) == Z_OK ? 0 : -1;
+}
+
+void DTCCompressor_end(struct DTCCompressor *compressor)
+{
+    deflateEnd(&compressor->Stream);
+}
+
+int DTCCompressor_write(struct DTCCompressor *compressor, struct DTCOutputRing *ring,
+                        const void *data, size_t length, size_t *consumed)
+{
+    z_stream *stream = &compressor->Stream;
+    int result;
+
+    stream->next_in = (Bytef *)data;
+    stream->avail_in = (uInt)length;
+
+    result = deflate_into(compressor, ring, Z_NO_FLUSH);
+
+    *consumed = length - stream->avail_in;
+    stream->next_in = NULL;
+    stream->avail_in = 0;
+    return result;
+}
+
+int DTCCompressor_flush(struct DTCCompressor *compressor, struct DTCOutputRing *ring)
+{
+    return deflate_into(compressor, ring, Z_SYNC_FLUSH);
+}
+
+int DTCCompressor_finish(struct DTCCompressor *compressor, struct DTCOutputRing *ring)
+{
+    return deflate_into(compressor, ring, Z_FINISH);
+}
+
+int DTCDecompressor_init(struct DTCDecompressor *decompressor)
+{
+    memset(&decompressor->Stream, 0, sizeof(decompressor->Stream));
+    decompressor->Finished = 0;
+    DTCDecoder_init(&decompressor->Decoder);
+    return inflateInit(&decompressor->Stream) == Z_OK ? 0 : -1;
+}
+
+void DTCDecompressor_end(struct DTCDecompressor *decompressor)
+{
+    inflateEnd(&decompressor->Stream);
+}
+
+void DTCDecompressor_feed(struct DTCDecompressor *decompressor, const void *data, size_t length)
+{
+    decompressor->Stream.next_in = (Bytef *)data;
+    decompressor->Stream.avail_in = (uInt)length;
+}
+
+int DTCDecompressor_next(struct DTCDecompressor *decompressor, const struct DTCMessageHeader **msg)
+{
+    z_stream *stream = &decompressor->Stream;
+
+    for (;;) {
+        int result = DTCDecoder_next(&decompressor->Decoder, msg);
+
+        if (result != DTC_DECODE_NEED_MORE)
+            return result;
+
+        /* Inflate again while there is input or the last call filled the buffer */
+        if (decompressor->Finished || (stream->avail_in == 0 && stream->avail_out != 0))
+            return DTC_DECODE_NEED_MORE;
+
+        /* The decoder is done with the buffer, so it can be refilled */
+        stream->next_out = decompressor->Buffer;
+        stream->avail_out = sizeof(decompressor->Buffer);
+
+        result = inflate(stream, Z_NO_FLUSH);
+        if (result == Z_STREAM_END)
+            decompressor->Finished = 1;
+        else if (result != Z_OK && result != Z_BUF_ERROR)
+            return DTC_DECODE_ERROR;
+
+        DTCDecoder_feed(&decompressor->Decoder, decompressor->Buffer, sizeof(decompressor->Buffer) - stream->avail_out);
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef __DTC_COMPRESSION_H__
+#define __DTC_COMPRESSION_H__
+
+/*
+ * Streaming zlib compression of historical price data records (links with
+ * -lz).
+ *
+ * When a HistoricalPriceDataRequest sets UseZLibCompression the server sends
+ * the HistoricalPriceDataHeaderResponse uncompressed with
+ * RecordsUseZLibCompression set, and every record after it as one zlib
+ * stream. DTCCompressor deflates records straight into a connection's
+ * DTCOutputRing in bounded pieces; DTCCompressor_flush() makes everything
+ * written so far decodable, so a large download can start streaming before
+ * the last record has been read from the store.
+ *
+ * DTCDecompressor inflates the stream on the client into a fixed buffer and
+ * hands the records out through a DTCDecoder.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <zlib.h>
+
+#include "DTCProtocol.h"
+#include "DTCDecoder.h"
+#include "DTCEncoder.h"
+
+/* Largest piece of the output ring a single deflate call writes into */
+#ifndef DTC_COMPRESS_CHUNK_SIZE
+#define DTC_COMPRESS_CHUNK_SIZE 4096
+#endif
+
+/* Inflated bytes held for the decoder at a time */
+#ifndef DTC_DECOMPRESS_BUFFER_SIZE
+#define DTC_DECOMPRESS_BUFFER_SIZE 16384
+#endif
+
+enum DTCCompressResultEnum {
+    DTC_COMPRESS_OK = 0,
+    DTC_COMPRESS_OUTPUT_FULL = 1,   /* the output ring is full, call again once it has drained */
+    DTC_COMPRESS_ERROR = -1
+};
+
+struct DTCCompressor
+{
+    z_stream Stream;
+};
+
+struct DTCDecompressor
+{
+    z_stream Stream;
+    int Finished;                   /* the end of the zlib stream was reached */
+    struct DTCDecoder Decoder;
+    unsigned char Buffer[DTC_DECOMPRESS_BUFFER_SIZE];
+};
+
+/* level is a zlib level, Z_DEFAULT_COMPRESSION or 1 (fastest) to 9. Returns 0 or -1. */
+int DTCCompressor_init(struct DTCCompressor *compressor, int level);
+void DTCCompressor_end(struct DTCCompressor *compressor);
+
+/*
+ * Compresses length bytes into ring. *consumed is set to the number of input
+ * bytes taken, which is less than length only with DTC_COMPRESS_OUTPUT_FULL.
+ */
+int DTCCompressor_write(struct DTCCompressor *compressor, struct DTCOutputRing *ring,
+                        const void *data, size_t length, size_t *consumed);
+
+/* Writes everything compressed so far so the client can decode it */
+int DTCCompressor_flush(struct DTCCompressor *compressor, struct DTCOutputRing *ring);
+
+/* Ends the stream after the final record */
+int DTCCompressor_finish(struct DTCCompressor *compressor, struct DTCOutputRing *ring);
+
+/* Returns 0 or -1 */
+int DTCDecompressor_init(struct DTCDecompressor *decompressor);
+void DTCDecompressor_end(struct DTCDecompressor *decompressor);
+
+/*
+ * Sets the next piece of compressed input. It must stay valid until
+ * DTCDecompressor_next() returns DTC_DECODE_NEED_MORE.
+ */
+void DTCDecompressor_feed(struct DTCDecompressor *decompressor, const void *data, size_t length);
+
+/*
+ * Returns the next record in *msg as a DTCDecodeResultEnum value;
+ * DTC_DECODE_ERROR also covers a corrupt zlib stream.
+ */
+int DTCDecompressor_next(struct DTCDecompressor *decompressor, const struct DTCMessageHeader **msg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DTC_COMPRESSION_H__ */
@@ -0,0 +1,244 @@
+#include "DTCConflation.h"
+
+#include <errno.h>
+#include <float.h>
+#include <string.h>
+
+/* What identifies the state a conflatable message updates */
+struct conflation_key
+{
+    uint16_t Type;
+    uint16_t MarketDataSymbolID;
+    uint16_t Side;
+    double Price;
+};
+
+/* Returns 0 for messages that are never conflated */
+static int make_key(const struct DTCMessageHeader *msg, struct conflation_key *key)
+{
+    const union DTCConflationSlot *m = (const union DTCConflationSlot *)msg;
+
+    key->Type = msg->Type;
+    key->Side = 0;
+    key->Price = 0;
+
+    switch (msg->Type) {
+    case QUOTE_INCREMENTAL_UPDATE:
+        key->MarketDataSymbolID = m->Quote.MarketDataSymbolID;
+        return 1;
+    case QUOTE_INCREMENTAL_UPDATE_COMPACT:
+        key->MarketDataSymbolID = m->QuoteCompact.MarketDataSymbolID;
+        return 1;
+    case MARKET_DEPTH_INCREMENTAL_UPDATE:
+        key->MarketDataSymbolID = m->Depth.MarketDataSymbolID;
+        key->Side = m->Depth.Side;
+        key->Price = m->Depth.Price;
+        return 1;
+    case MARKET_DEPTH_INCREMENTAL_UPDATE_COMPACT:
+        key->MarketDataSymbolID = m->DepthCompact.MarketDataSymbolID;
+        key->Side = m->DepthCompact.Side;
+        key->Price = m->DepthCompact.Price;
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+static int same_key(const struct conflation_key *a, const struct conflation_key *b)
+{
+    return a->Type == b->Type && a->MarketDataSymbolID == b->MarketDataSymbolID
+        && a->Side == b->Side && a->Price == b->Price;
+}
+
+static uint32_t hash_key(const struct conflation_key *key)
+{
+    uint64_t price_bits;
+    uint64_t h;
+
+    memcpy(&price_bits, &key->Price, sizeof(price_bits));
+    h = price_bits ^ ((uint64_t)key->Type << 48) ^ ((uint64_t)key->Side << 32) ^ key->MarketDataSymbolID;
+    h *= 0x9E3779B97F4A7C15ULL;
+    return (uint32_t)(h >> 32);
+}
+
+static uint32_t index_mask(const struct DTCConflation *conflation)
+{
+    return DTC_CONFLATION_INDEX_SIZE(conflation->Capacity) - 1;
+}
+
+/* Position in the index of the entry for key, or of the empty entry ending its probe sequence */
+static uint32_t find_entry(const struct DTCConflation *conflation, const struct conflation_key *key)
+{
+    uint32_t mask = index_mask(conflation);
+    uint32_t pos = hash_key(key) & mask;
+    struct conflation_key other;
+
+    while (conflation->Index[pos] != 0) {
+        make_key(&conflation->Slots[conflation->Index[pos] - 1].Header, &other);
+        if (same_key(key, &other))
+            break;
+        pos = (pos + 1) & mask;
+    }
+    return pos;
+}
+
+/* Backward shift deletion keeps probe sequences intact without tombstones */
+static void remove_entry(struct DTCConflation *conflation, uint32_t pos)
+{
+    uint32_t mask = index_mask(conflation);
+    uint32_t next = (pos + 1) & mask;
+    struct conflation_key key;
+
+    while (conflation->Index[next] != 0) {
+        uint32_t home;
+
+        make_key(&conflation->Slots[conflation->Index[next] - 1].Header, &key);
+        home = hash_key(&key) & mask;
+
+        /* Move the entry back if its home is not in (pos, next] */
+        if (((next - home) & mask) >= ((next - pos) & mask)) {
+            conflation->Index[pos] = conflation->Index[next];
+            pos = next;
+        }
+        next = (next + 1) & mask;
+    }
+    conflation->Index[pos] = 0;
+}
+
+static void merge_quote(struct s_QuoteIncrementalUpdate *pending, const struct s_QuoteIncrementalUpdate *msg)
+{
+    /* A side left unset by the newer quote keeps the pending value */
+    if (msg->BidPrice != DBL_MAX) {
+        pending->BidPrice = msg->BidPrice;
+        pending->BidSize = msg->BidSize;
+    }
+    if (msg->AskPrice != DBL_MAX) {
+        pending->AskPrice = msg->AskPrice;
+        pending->AskSize = msg->AskSize;
+    }
+    pending->QuoteDateTimeUnix = msg->QuoteDateTimeUnix;
+}
+
+static void merge_quote_compact(struct s_QuoteIncrementalUpdateCompact *pending, const struct s_QuoteIncrementalUpdateCompact *msg)
+{
+    if (msg->BidPrice != FLT_MAX) {
+        pending->BidPrice = msg->BidPrice;
+        pending->BidSize = msg->BidSize;
+    }
+    if (msg->AskPrice != FLT_MAX) {
+        pending->AskPrice = msg->AskPrice;
+        pending->AskSize = msg->AskSize;
+    }
+    pending->QuoteDateTimeUnix = msg->QuoteDateTimeUnix;
+}
+
+int DTCConflation_init(struct DTCConflation *conflation, union DTCConflationSlot *slots, uint32_t *index, uint32_t capacity)
+{
+    /* The index mask relies on it, and the index size must fit 32 bits */
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0 || capacity > UINT32_MAX / 2) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    conflation->Slots = slots;
+    conflation->Index = index;
+    conflation->Capacity = capacity;
+    conflation->Head = 0;
+    conflation->Tail = 0;
+    conflation->DroppedMessages = 0;
+    memset(index, 0, DTC_CONFLATION_INDEX_SIZE(capacity) * sizeof(uint32_t));
+    return 0;
+}
+
+int DTCConflation_push(struct DTCConflation *conflation, const struct DTCMessageHeader *msg)
+{
+    struct conflation_key key;
+    uint32_t pos = 0;
+    uint32_t slot;
+    int conflatable;
+
+    if (msg->Size > sizeof(union DTCConflationSlot))
+        return DTC_CONFLATION_TOO_LARGE;
+
+    conflatable = make_key(msg, &key);
+    if (conflatable) {
+        pos = find_entry(conflation, &key);
+        if (conflation->Index[pos] != 0) {
+            union DTCConflationSlot *pending = &conflation->Slots[conflation->Index[pos] - 1];
+
+            if (msg->Type == QUOTE_INCREMENTAL_UPDATE)
+                merge_quote(&pending->Quote, (const struct s_QuoteIncrementalUpdate *)msg);
+            else if (msg->Type == QUOTE_INCREMENTAL_UPDATE_COMPACT)
+                merge_quote_compact(&pending->QuoteCompact, (const struct s_QuoteIncrementalUpdateCompact *)msg);
+            else
+                memcpy(pending, msg, msg->Size);
+
+            conflation->DroppedMessages++;
+            return DTC_CONFLATION_MERGED;
+        }
+    }
+
+    if (conflation->Tail - conflation->Head == conflation->Capacity)
+        return DTC_CONFLATION_FULL;
+
+    slot = conflation->Tail & (conflation->Capacity - 1);
+    memcpy(&conflation->Slots[slot], msg, msg->Size);
+    conflation->Tail++;
+
+    if (conflatable)
+        conflation->Index[pos] = slot + 1;
+
+    return DTC_CONFLATION_QUEUED;
+}
+
+uint32_t DTCConflation_pending(const struct DTCConflation *conflation)
+{
+    return conflation->Tail - conflation->Head;
+}
+
+const struct DTCMessageHeader *DTCConflation_peek(const struct DTCConflation *conflation)
+{
+    if (conflation->Head == conflation->Tail)
+        return NULL;
+
+    return &conflation->Slots[conflation->Head & (conflation->Capacity - 1)].Header;
+}
+
+void DTCConflation_pop(struct DTCConflation *conflation)
+{
+    const struct DTCMessageHeader *msg = DTCConflation_peek(conflation);
+    struct conflation_key key;
+
+    if (msg == NULL)
+        return;
+
+    if (make_key(msg, &key))
+        remove_entry(conflation, find_entry(conflation, &key));
+
+    conflation->Head++;
+}
+
+uint32_t DTCConflation_drain(struct DTCConflation *conflation, struct DTCOutputRing *ring)
+{
+    const struct DTCMessageHeader *msg;
+    uint32_t moved = 0;
+
+    while ((msg = DTCConflation_peek(conflation)) != NULL) {
+        void *out = DTCOutputRing_reserve(ring, msg->Size);
+
+        if (out == NULL)
+            break;
+
+        memcpy(out, msg, msg->Size);
+        DTCOutputRing_commit(ring, msg->Size);
+        DTCConflation_pop(conflation);
+        moved++;
+    }
+    return moved;
+}
+
+void DTCConflation_fill_heartbeat(struct DTCConflation *conflation, struct s_Heartbeat *msg)
+{
+    msg->DroppedMessages = conflation->DroppedMessages;
+    conflation->DroppedMessages = 0;
+}
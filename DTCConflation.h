@@ -0,0 +1,81 @@
+#ifndef __DTC_CONFLATION_H__
+#define __DTC_CONFLATION_H__
+
+/*
+ * Per-connection conflation buffer for slow clients.
+ *
+ * Pending messages are queued in a fixed ring of slots. A quote for a
+ * MarketDataSymbolID that already has a quote pending is merged into that
+ * queued message, and a depth update for a pending (symbol, side, price)
+ * level replaces it, so only the latest state is sent. Trades and all other
+ * messages are queued losslessly. Every merged message is counted and
+ * reported through the DroppedMessages field of the next Heartbeat.
+ *
+ * Memory is bounded by the caller-provided slot and index arrays.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "DTCProtocol.h"
+#include "DTCEncoder.h"
+
+enum DTCConflationResultEnum {
+    DTC_CONFLATION_QUEUED = 0,
+    DTC_CONFLATION_MERGED = 1,      /* merged into a pending message */
+    DTC_CONFLATION_FULL = -1,       /* no free slot, the client is too far behind */
+    DTC_CONFLATION_TOO_LARGE = -2   /* message does not fit in a slot */
+};
+
+union DTCConflationSlot
+{
+    struct DTCMessageHeader Header;
+    struct s_TradeIncrementalUpdate Trade;
+    struct s_TradeIncrementalUpdateCompact TradeCompact;
+    struct s_QuoteIncrementalUpdate Quote;
+    struct s_QuoteIncrementalUpdateCompact QuoteCompact;
+    struct s_MarketDepthIncrementalUpdate Depth;
+    struct s_MarketDepthIncrementalUpdateCompact DepthCompact;
+};
+
+/* Number of index entries needed for a slot capacity */
+#define DTC_CONFLATION_INDEX_SIZE(capacity) (2 * (capacity))
+
+struct DTCConflation
+{
+    union DTCConflationSlot *Slots;
+    uint32_t *Index;        /* open addressed, slot number + 1, 0 if empty */
+    uint32_t Capacity;      /* power of two */
+    uint32_t Head;          /* sequence number of the oldest pending slot */
+    uint32_t Tail;          /* sequence number of the next free slot */
+    uint32_t DroppedMessages;
+};
+
+/*
+ * capacity must be a power of two. index must hold
+ * DTC_CONFLATION_INDEX_SIZE(capacity) entries. Returns 0, or -1 with errno
+ * EINVAL for any other capacity.
+ */
+int DTCConflation_init(struct DTCConflation *conflation, union DTCConflationSlot *slots, uint32_t *index, uint32_t capacity);
+
+/* Returns a DTCConflationResultEnum value */
+int DTCConflation_push(struct DTCConflation *conflation, const struct DTCMessageHeader *msg);
+
+uint32_t DTCConflation_pending(const struct DTCConflation *conflation);
+
+/* Oldest pending message, or NULL if there is none */
+const struct DTCMessageHeader *DTCConflation_peek(const struct DTCConflation *conflation);
+void DTCConflation_pop(struct DTCConflation *conflation);
+
+/* Moves pending messages into the output ring until it is full, returns the number moved */
+uint32_t DTCConflation_drain(struct DTCConflation *conflation, struct DTCOutputRing *ring);
+
+/* Sets DroppedMessages to the number merged since the last call and resets the count */
+void DTCConflation_fill_heartbeat(struct DTCConflation *conflation, struct s_Heartbeat *msg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DTC_CONFLATION_H__ */
@@ -0,0 +1,201 @@
+#include "DTCConvert.h"
+
+#include <float.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DTC_CONVERT_SSE2
+#include <emmintrin.h>
+#endif
+
+static t_DateTime4Byte datetime_to_4byte(double value)
+{
+    if (value <= 0)
+        return 0;
+    if (value >= 4294967295.0)
+        return UINT32_MAX;
+    return (t_DateTime4Byte)value;
+}
+
+#ifdef DTC_CONVERT_SSE2
+
+/* Price and volume are adjacent in both forms, so each pair converts with one instruction */
+static void pair_to_float(const double *in, float *out)
+{
+    _mm_storel_pi((__m64 *)out, _mm_cvtpd_ps(_mm_loadu_pd(in)));
+}
+
+static void pair_to_double(const float *in, double *out)
+{
+    __m128 v = _mm_castsi128_ps(_mm_loadl_epi64((const __m128i *)in));
+    _mm_storeu_pd(out, _mm_cvtps_pd(v));
+}
+
+/* Lane 0 is the bid, lane 1 the ask; DBL_MAX becomes FLT_MAX */
+static __m128 prices_to_float(__m128d prices)
+{
+    __m128d unset = _mm_cmpeq_pd(prices, _mm_set1_pd(DBL_MAX));
+    __m128 mask = _mm_castsi128_ps(_mm_shuffle_epi32(_mm_castpd_si128(unset), _MM_SHUFFLE(3, 3, 2, 0)));
+
+    return _mm_or_ps(_mm_and_ps(mask, _mm_set1_ps(FLT_MAX)), _mm_andnot_ps(mask, _mm_cvtpd_ps(prices)));
+}
+
+/* FLT_MAX becomes DBL_MAX */
+static __m128d prices_to_double(__m128 prices)
+{
+    __m128 unset = _mm_cmpeq_ps(prices, _mm_set1_ps(FLT_MAX));
+    __m128d mask = _mm_castsi128_pd(_mm_shuffle_epi32(_mm_castps_si128(unset), _MM_SHUFFLE(1, 1, 0, 0)));
+
+    return _mm_or_pd(_mm_and_pd(mask, _mm_set1_pd(DBL_MAX)), _mm_andnot_pd(mask, _mm_cvtps_pd(prices)));
+}
+
+#else
+
+static void pair_to_float(const double *in, float *out)
+{
+    out[0] = (float)in[0];
+    out[1] = (float)in[1];
+}
+
+static void pair_to_double(const float *in, double *out)
+{
+    out[0] = in[0];
+    out[1] = in[1];
+}
+
+static float price_to_float(double price)
+{
+    return price == DBL_MAX ? FLT_MAX : (float)price;
+}
+
+static double price_to_double(float price)
+{
+    return price == FLT_MAX ? DBL_MAX : (double)price;
+}
+
+#endif
+
+void DTCConvert_trades_to_compact(const struct s_TradeIncrementalUpdate *in, struct s_TradeIncrementalUpdateCompact *out, size_t count)
+{
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        out[i].Size = sizeof(struct s_TradeIncrementalUpdateCompact);
+        out[i].Type = TRADE_INCREMENTAL_UPDATE_COMPACT;
+        pair_to_float(&in[i].Price, &out[i].Price);
+        out[i].TradeDateTimeUnix = datetime_to_4byte(in[i].TradeDateTimeUnix);
+        out[i].MarketDataSymbolID = in[i].MarketDataSymbolID;
+        out[i].TradeAtBidOrAsk = in[i].TradeAtBidOrAsk;
+    }
+}
+
+void DTCConvert_trades_from_compact(const struct s_TradeIncrementalUpdateCompact *in, struct s_TradeIncrementalUpdate *out, size_t count)
+{
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        out[i].Size = sizeof(struct s_TradeIncrementalUpdate);
+        out[i].Type = TRADE_INCREMENTAL_UPDATE;
+        out[i].MarketDataSymbolID = in[i].MarketDataSymbolID;
+        out[i].TradeAtBidOrAsk = in[i].TradeAtBidOrAsk;
+        pair_to_double(&in[i].Price, &out[i].Price);
+        out[i].TradeDateTimeUnix = in[i].TradeDateTimeUnix;
+    }
+}
+
+void DTCConvert_quotes_to_compact(const struct s_QuoteIncrementalUpdate *in, struct s_QuoteIncrementalUpdateCompact *out, size_t count)
+{
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+#ifdef DTC_CONVERT_SSE2
+        __m128 prices = prices_to_float(_mm_set_pd(in[i].AskPrice, in[i].BidPrice));
+        __m128 sizes = _mm_cvtpd_ps(_mm_set_pd(in[i].AskSize, in[i].BidSize));
+
+        /* Interleave to Bid, BidSize, Ask, AskSize, the compact field order */
+        _mm_storeu_ps(&out[i].BidPrice, _mm_unpacklo_ps(prices, sizes));
+#else
+        out[i].BidPrice = price_to_float(in[i].BidPrice);
+        out[i].BidSize = in[i].BidSize;
+        out[i].AskPrice = price_to_float(in[i].AskPrice);
+        out[i].AskSize = in[i].AskSize;
+#endif
+        out[i].Size = sizeof(struct s_QuoteIncrementalUpdateCompact);
+        out[i].Type = QUOTE_INCREMENTAL_UPDATE_COMPACT;
+        out[i].QuoteDateTimeUnix = datetime_to_4byte(in[i].QuoteDateTimeUnix);
+        out[i].MarketDataSymbolID = in[i].MarketDataSymbolID;
+    }
+}
+
+void DTCConvert_quotes_from_compact(const struct s_QuoteIncrementalUpdateCompact *in, struct s_QuoteIncrementalUpdate *out, size_t count)
+{
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+#ifdef DTC_CONVERT_SSE2
+        /* Bid, BidSize, Ask, AskSize */
+        __m128 fields = _mm_loadu_ps(&in[i].BidPrice);
+        __m128d prices = prices_to_double(_mm_shuffle_ps(fields, fields, _MM_SHUFFLE(2, 0, 2, 0)));
+
+        _mm_storel_pd(&out[i].BidPrice, prices);
+        _mm_storeh_pd(&out[i].AskPrice, prices);
+#else
+        out[i].BidPrice = price_to_double(in[i].BidPrice);
+        out[i].AskPrice = price_to_double(in[i].AskPrice);
+#endif
+        out[i].Size = sizeof(struct s_QuoteIncrementalUpdate);
+        out[i].Type = QUOTE_INCREMENTAL_UPDATE;
+        out[i].MarketDataSymbolID = in[i].MarketDataSymbolID;
+        out[i].BidSize = in[i].BidSize;
+        out[i].AskSize = in[i].AskSize;
+        out[i].QuoteDateTimeUnix = in[i].QuoteDateTimeUnix;
+    }
+}
+
+void DTCConvert_depth_to_compact(const struct s_MarketDepthIncrementalUpdate *in, struct s_MarketDepthIncrementalUpdateCompact *out, size_t count)
+{
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        out[i].Size = sizeof(struct s_MarketDepthIncrementalUpdateCompact);
+        out[i].Type = MARKET_DEPTH_INCREMENTAL_UPDATE_COMPACT;
+        out[i].MarketDataSymbolID = in[i].MarketDataSymbolID;
+        out[i].Side = in[i].Side;
+        pair_to_float(&in[i].Price, &out[i].Price);
+        out[i].UpdateType = in[i].UpdateType;
+    }
+}
+
+void DTCConvert_depth_from_compact(const struct s_MarketDepthIncrementalUpdateCompact *in, struct s_MarketDepthIncrementalUpdate *out, size_t count)
+{
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        out[i].Size = sizeof(struct s_MarketDepthIncrementalUpdate);
+        out[i].Type = MARKET_DEPTH_INCREMENTAL_UPDATE;
+        out[i].MarketDataSymbolID = in[i].MarketDataSymbolID;
+        out[i].Side = in[i].Side;
+        pair_to_double(&in[i].Price, &out[i].Price);
+        out[i].UpdateType = in[i].UpdateType;
+    }
+}
+
+void DTCConvert_datetimes_to_4byte(const t_DateTime *in, t_DateTime4Byte *out, size_t count)
+{
+    size_t i;
+
+    /* Branch free clamp, left to the compiler to vectorise */
+    for (i = 0; i < count; i++) {
+        t_DateTime v = in[i];
+        v = v < 0 ? 0 : v;
+        v = v > (t_DateTime)UINT32_MAX ? (t_DateTime)UINT32_MAX : v;
+        out[i] = (t_DateTime4Byte)v;
+    }
+}
+
+void DTCConvert_datetimes_from_4byte(const t_DateTime4Byte *in, t_DateTime *out, size_t count)
+{
+    size_t i;
+
+    for (i = 0; i < count; i++)
+        out[i] = in[i];
+}
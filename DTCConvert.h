@@ -0,0 +1,41 @@
+#ifndef __DTC_CONVERT_H__
+#define __DTC_CONVERT_H__
+
+/*
+ * Batch conversion between the full (double) and compact (float, 4 byte
+ * DateTime) forms of the trade, quote and market depth messages.
+ *
+ * Each call converts count messages from one array into another and writes
+ * the complete output message including Size and Type. Padding bytes in the
+ * output are left as they are. Unset quote prices are mapped between DBL_MAX
+ * and FLT_MAX as set by the respective _init() functions.
+ *
+ * SSE2 is used where available, with a portable scalar fallback.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "DTCProtocol.h"
+
+void DTCConvert_trades_to_compact(const struct s_TradeIncrementalUpdate *in, struct s_TradeIncrementalUpdateCompact *out, size_t count);
+void DTCConvert_trades_from_compact(const struct s_TradeIncrementalUpdateCompact *in, struct s_TradeIncrementalUpdate *out, size_t count);
+
+void DTCConvert_quotes_to_compact(const struct s_QuoteIncrementalUpdate *in, struct s_QuoteIncrementalUpdateCompact *out, size_t count);
+void DTCConvert_quotes_from_compact(const struct s_QuoteIncrementalUpdateCompact *in, struct s_QuoteIncrementalUpdate *out, size_t count);
+
+void DTCConvert_depth_to_compact(const struct s_MarketDepthIncrementalUpdate *in, struct s_MarketDepthIncrementalUpdateCompact *out, size_t count);
+void DTCConvert_depth_from_compact(const struct s_MarketDepthIncrementalUpdateCompact *in, struct s_MarketDepthIncrementalUpdate *out, size_t count);
+
+/* Whole seconds, clamped to the range of t_DateTime4Byte */
+void DTCConvert_datetimes_to_4byte(const t_DateTime *in, t_DateTime4Byte *out, size_t count);
+void DTCConvert_datetimes_from_4byte(const t_DateTime4Byte *in, t_DateTime *out, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DTC_CONVERT_H__ */
@@ -0,0 +1,98 @@
+#include "DTCDecoder.h"
+
+#include <string.h>
+
+#define HEADER_SIZE sizeof(struct DTCMessageHeader)
+
+static uint16_t read_frame_size(const unsigned char *p)
+{
+    /* The byte ordering is little endian */
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+void DTCDecoder_init(struct DTCDecoder *dec)
+{
+    dec->Chunk = NULL;
+    dec->ChunkLength = 0;
+    dec->ChunkOffset = 0;
+    dec->PartialLength = 0;
+}
+
+void DTCDecoder_reset(struct DTCDecoder *dec)
+{
+    DTCDecoder_init(dec);
+}
+
+void DTCDecoder_feed(struct DTCDecoder *dec, const void *data, size_t length)
+{
+    dec->Chunk = (const unsigned char *)data;
+    dec->ChunkLength = length;
+    dec->ChunkOffset = 0;
+}
+
+size_t DTCDecoder_pending(const struct DTCDecoder *dec)
+{
+    return dec->PartialLength;
+}
+
+/* Moves up to wanted bytes of the current chunk into the reassembly area */
+static size_t take_partial(struct DTCDecoder *dec, size_t wanted)
+{
+    size_t available = dec->ChunkLength - dec->ChunkOffset;
+    size_t n = wanted < available ? wanted : available;
+
+    memcpy(dec->Partial.Bytes + dec->PartialLength, dec->Chunk + dec->ChunkOffset, n);
+    dec->PartialLength += (uint32_t)n;
+    dec->ChunkOffset += n;
+    return n;
+}
+
+int DTCDecoder_next(struct DTCDecoder *dec, const struct DTCMessageHeader **msg)
+{
+    const unsigned char *p;
+    size_t available;
+    uint16_t frame_size;
+
+    /* Finish a frame started in a previous chunk */
+    if (dec->PartialLength != 0) {
+        if (dec->PartialLength < HEADER_SIZE) {
+            take_partial(dec, HEADER_SIZE - dec->PartialLength);
+            if (dec->PartialLength < HEADER_SIZE)
+                return DTC_DECODE_NEED_MORE;
+        }
+
+        frame_size = read_frame_size(dec->Partial.Bytes);
+        if (frame_size < HEADER_SIZE)
+            return DTC_DECODE_ERROR;
+
+        take_partial(dec, frame_size - dec->PartialLength);
+        if (dec->PartialLength < frame_size)
+            return DTC_DECODE_NEED_MORE;
+
+        dec->PartialLength = 0;
+        *msg = &dec->Partial.Header;
+        return DTC_DECODE_MESSAGE;
+    }
+
+    available = dec->ChunkLength - dec->ChunkOffset;
+    p = dec->Chunk + dec->ChunkOffset;
+
+    if (available >= HEADER_SIZE) {
+        frame_size = read_frame_size(p);
+        if (frame_size < HEADER_SIZE)
+            return DTC_DECODE_ERROR;
+
+        /* Fast path: the whole frame is inside the chunk */
+        if (frame_size <= available) {
+            dec->ChunkOffset += frame_size;
+            *msg = (const struct DTCMessageHeader *)p;
+            return DTC_DECODE_MESSAGE;
+        }
+    }
+
+    /* Keep the incomplete tail for the next chunk */
+    if (available != 0)
+        take_partial(dec, available);
+
+    return DTC_DECODE_NEED_MORE;
+}
@@ -0,0 +1,72 @@
+#ifndef __DTC_DECODER_H__
+#define __DTC_DECODER_H__
+
+/*
+ * Streaming frame decoder for the DTC binary encoding.
+ *
+ * Byte chunks are fed in as they arrive from the transport and complete
+ * frames are handed back as pointers. A frame that lies entirely inside the
+ * current chunk is returned in place, without copying. Only a frame split
+ * across two chunks is reassembled in the decoder's own buffer, and only the
+ * bytes of that single frame are copied.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "DTCProtocol.h"
+
+/* Largest frame representable by the 16 bit Size field */
+#define DTC_MAX_FRAME_SIZE                          65535
+
+enum DTCDecodeResultEnum {
+    DTC_DECODE_ERROR = -1,      /* Size field smaller than the message header */
+    DTC_DECODE_NEED_MORE = 0,   /* chunk exhausted, feed the next one */
+    DTC_DECODE_MESSAGE = 1      /* a complete frame was returned */
+};
+
+struct DTCDecoder
+{
+    /* Current chunk, owned by the caller */
+    const unsigned char *Chunk;
+    size_t ChunkLength;
+    size_t ChunkOffset;
+
+    /* Reassembly area for a frame split across chunks */
+    uint32_t PartialLength;
+    union
+    {
+        struct DTCMessageHeader Header;
+        double Align;
+        unsigned char Bytes[DTC_MAX_FRAME_SIZE];
+    } Partial;
+};
+
+void DTCDecoder_init(struct DTCDecoder *dec);
+void DTCDecoder_reset(struct DTCDecoder *dec);
+
+/*
+ * Sets the chunk to decode from. The chunk must stay valid and unmodified
+ * until DTCDecoder_next() returns DTC_DECODE_NEED_MORE.
+ */
+void DTCDecoder_feed(struct DTCDecoder *dec, const void *data, size_t length);
+
+/*
+ * Returns the next complete frame in *msg. The pointer refers either into the
+ * fed chunk or into the decoder's reassembly area and stays valid until the
+ * next call. Frames returned in place are not necessarily aligned to the
+ * natural alignment of the message struct.
+ */
+int DTCDecoder_next(struct DTCDecoder *dec, const struct DTCMessageHeader **msg);
+
+/* Number of bytes of an incomplete frame held by the decoder */
+size_t DTCDecoder_pending(const struct DTCDecoder *dec);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DTC_DECODER_H__ */
@@ -0,0 +1,71 @@
+#include "DTCDispatcher.h"
+
+#include <string.h>
+
+void DTCDispatcher_init(struct DTCDispatcher *dispatcher, void *context)
+{
+    memset(dispatcher, 0, sizeof(struct DTCDispatcher));
+    dispatcher->Context = context;
+
+#define SET_MINIMUM_SIZE(type, name, direction) \
+    dispatcher->Entries[type].MinimumSize = sizeof(struct s_##name);
+
+    DTC_MESSAGE_LIST(SET_MINIMUM_SIZE)
+
+#undef SET_MINIMUM_SIZE
+}
+
+int DTCDispatcher_set(struct DTCDispatcher *dispatcher, uint16_t msg_type, DTCMessageHandler handler)
+{
+    if (msg_type >= DTC_MESSAGE_TYPE_COUNT || dispatcher->Entries[msg_type].MinimumSize == 0)
+        return DTC_MESSAGE_UNKNOWN_TYPE;
+
+    dispatcher->Entries[msg_type].Handler = handler;
+    dispatcher->Entries[msg_type].Trampoline = NULL;
+    return DTC_MESSAGE_VALID;
+}
+
+/*
+ * Calling a typed handler through DTCMessageHandler would be undefined, so
+ * each type gets a trampoline that converts the message pointer instead.
+ */
+#define DEFINE_TYPED_HANDLER(type, name, direction) \
+    static void call_##name(const struct DTCDispatchEntry *entry, void *context, const struct DTCMessageHeader *msg) \
+    { \
+        entry->Typed.name(context, (const struct s_##name *)msg); \
+    } \
+    \
+    void DTCDispatcher_on_##name(struct DTCDispatcher *dispatcher, DTC##name##Handler handler) \
+    { \
+        dispatcher->Entries[type].Handler = NULL; \
+        dispatcher->Entries[type].Typed.name = handler; \
+        dispatcher->Entries[type].Trampoline = handler != NULL ? call_##name : NULL; \
+    }
+
+DTC_MESSAGE_LIST(DEFINE_TYPED_HANDLER)
+
+#undef DEFINE_TYPED_HANDLER
+
+int DTCDispatcher_dispatch(const struct DTCDispatcher *dispatcher, const struct DTCMessageHeader *msg)
+{
+    const struct DTCDispatchEntry *entry;
+
+    if (msg->Type >= DTC_MESSAGE_TYPE_COUNT || dispatcher->Entries[msg->Type].MinimumSize == 0) {
+        if (dispatcher->DefaultHandler != NULL)
+            dispatcher->DefaultHandler(dispatcher->Context, msg);
+        return DTC_MESSAGE_UNKNOWN_TYPE;
+    }
+
+    entry = &dispatcher->Entries[msg->Type];
+    if (msg->Size < entry->MinimumSize)
+        return DTC_MESSAGE_TRUNCATED;
+
+    if (entry->Trampoline != NULL)
+        entry->Trampoline(entry, dispatcher->Context, msg);
+    else if (entry->Handler != NULL)
+        entry->Handler(dispatcher->Context, msg);
+    else if (dispatcher->DefaultHandler != NULL)
+        dispatcher->DefaultHandler(dispatcher->Context, msg);
+
+    return DTC_MESSAGE_VALID;
+}
@@ -0,0 +1,102 @@
+#ifndef __DTC_DISPATCHER_H__
+#define __DTC_DISPATCHER_H__
+
+/*
+ * Routes decoded messages to handlers by message Type.
+ *
+ * The C dispatcher is a table indexed by Type holding one function pointer
+ * per message, so routing is a single indirect call. Typed registration
+ * functions DTCDispatcher_on_<Name>() are generated from DTC_MESSAGE_LIST;
+ * their handlers are reached through a generated per-type trampoline.
+ *
+ * C++ code can use DTCDispatch() instead, which expands to a switch over all
+ * message types and calls an overloaded handler object, letting the compiler
+ * inline the handlers.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "DTCProtocol.h"
+
+typedef void (*DTCMessageHandler)(void *context, const struct DTCMessageHeader *msg);
+
+struct DTCDispatcher;
+struct DTCDispatchEntry;
+
+#define DTC_DECLARE_TYPED_HANDLER(type, name, direction) \
+    typedef void (*DTC##name##Handler)(void *context, const struct s_##name *msg); \
+    void DTCDispatcher_on_##name(struct DTCDispatcher *dispatcher, DTC##name##Handler handler);
+
+DTC_MESSAGE_LIST(DTC_DECLARE_TYPED_HANDLER)
+
+#define DTC_TYPED_HANDLER_MEMBER(type, name, direction) DTC##name##Handler name;
+
+/* A typed handler is kept with its own pointer type and called by a per-type trampoline */
+union DTCTypedHandler
+{
+    DTC_MESSAGE_LIST(DTC_TYPED_HANDLER_MEMBER)
+};
+
+#undef DTC_TYPED_HANDLER_MEMBER
+
+typedef void (*DTCDispatchTrampoline)(const struct DTCDispatchEntry *entry, void *context, const struct DTCMessageHeader *msg);
+
+struct DTCDispatchEntry
+{
+    DTCMessageHandler Handler;
+    DTCDispatchTrampoline Trampoline;   /* set instead of Handler for typed handlers */
+    union DTCTypedHandler Typed;
+    uint16_t MinimumSize;   /* frames shorter than the struct are not dispatched */
+};
+
+struct DTCDispatcher
+{
+    void *Context;
+    DTCMessageHandler DefaultHandler;   /* types without a handler, may be NULL */
+    struct DTCDispatchEntry Entries[DTC_MESSAGE_TYPE_COUNT];
+};
+
+void DTCDispatcher_init(struct DTCDispatcher *dispatcher, void *context);
+
+/* Returns DTC_MESSAGE_UNKNOWN_TYPE if msg_type is not a DTC message */
+int DTCDispatcher_set(struct DTCDispatcher *dispatcher, uint16_t msg_type, DTCMessageHandler handler);
+
+/* Returns a DTCMessageValidationEnum value */
+int DTCDispatcher_dispatch(const struct DTCDispatcher *dispatcher, const struct DTCMessageHeader *msg);
+
+#ifdef __cplusplus
+}
+
+/* C++ linkage even when this header is included inside another extern "C" block */
+extern "C++" {
+
+/*
+ * Calls handler(const s_<Name> &) for the message type of msg. The handler
+ * needs an overload for every type, typically by adding a catch-all
+ * template <class T> void operator()(const T &) {}.
+ */
+template <class Handler>
+inline int DTCDispatch(Handler &handler, const struct DTCMessageHeader *msg)
+{
+    switch (msg->Type) {
+#define DTC_DISPATCH_CASE(type, name, direction) \
+    case type: \
+        if (msg->Size < sizeof(s_##name)) \
+            return DTC_MESSAGE_TRUNCATED; \
+        handler(*reinterpret_cast<const s_##name *>(msg)); \
+        return DTC_MESSAGE_VALID;
+
+    DTC_MESSAGE_LIST(DTC_DISPATCH_CASE)
+
+#undef DTC_DISPATCH_CASE
+    default:
+        return DTC_MESSAGE_UNKNOWN_TYPE;
+    }
+}
+
+}
+#endif
+
+#endif /* __DTC_DISPATCHER_H__ */
@@ -0,0 +1,125 @@
+#include "DTCEncoder.h"
+
+#include <string.h>
+
+void DTCMessageTemplates_init(struct DTCMessageTemplates *templates)
+{
+#define INIT_TEMPLATE(type, name, direction) name##_init(&templates->name);
+    DTC_MESSAGE_LIST(INIT_TEMPLATE)
+#undef INIT_TEMPLATE
+}
+
+void DTCOutputRing_init(struct DTCOutputRing *ring, void *buffer, size_t capacity)
+{
+    ring->Buffer = (unsigned char *)buffer;
+    ring->Capacity = capacity;
+    ring->Read = 0;
+    ring->Write = 0;
+    ring->Wrap = 0;
+}
+
+void *DTCOutputRing_reserve(struct DTCOutputRing *ring, size_t size)
+{
+    if (ring->Wrap != 0)
+        return size <= ring->Read - ring->Write ? ring->Buffer + ring->Write : NULL;
+
+    if (size <= ring->Capacity - ring->Write)
+        return ring->Buffer + ring->Write;
+
+    /* Not enough room at the end, continue at the start if the sent bytes allow it */
+    if (size > ring->Read)
+        return NULL;
+
+    ring->Wrap = ring->Write;
+    ring->Write = 0;
+    return ring->Buffer;
+}
+
+void DTCOutputRing_commit(struct DTCOutputRing *ring, size_t size)
+{
+    ring->Write += size;
+}
+
+void *DTCOutputRing_emit(struct DTCOutputRing *ring, const void *template_msg)
+{
+    uint16_t size = ((const struct DTCMessageHeader *)template_msg)->Size;
+    void *msg = DTCOutputRing_reserve(ring, size);
+
+    if (msg == NULL)
+        return NULL;
+
+    memcpy(msg, template_msg, size);
+    ring->Write += size;
+    return msg;
+}
+
+void *DTCOutputRing_emit_batch(struct DTCOutputRing *ring, const void *template_msg, size_t count)
+{
+    uint16_t size = ((const struct DTCMessageHeader *)template_msg)->Size;
+    unsigned char *first = (unsigned char *)DTCOutputRing_reserve(ring, size * count);
+    size_t filled;
+
+    if (first == NULL || count == 0)
+        return first;
+
+    /* Double the initialised run each pass instead of copying one message at a time */
+    memcpy(first, template_msg, size);
+    filled = 1;
+    while (filled < count) {
+        size_t n = filled <= count - filled ? filled : count - filled;
+        memcpy(first + filled * size, first, n * size);
+        filled += n;
+    }
+
+    ring->Write += size * count;
+    return first;
+}
+
+int DTCOutputRing_slices(const struct DTCOutputRing *ring, struct DTCSlice slices[2])
+{
+    int n = 0;
+
+    if (ring->Wrap != 0) {
+        if (ring->Wrap > ring->Read) {
+            slices[n].Data = ring->Buffer + ring->Read;
+            slices[n].Length = ring->Wrap - ring->Read;
+            n++;
+        }
+        if (ring->Write != 0) {
+            slices[n].Data = ring->Buffer;
+            slices[n].Length = ring->Write;
+            n++;
+        }
+    } else if (ring->Write > ring->Read) {
+        slices[n].Data = ring->Buffer + ring->Read;
+        slices[n].Length = ring->Write - ring->Read;
+        n++;
+    }
+
+    return n;
+}
+
+void DTCOutputRing_consume(struct DTCOutputRing *ring, size_t size)
+{
+    if (ring->Wrap != 0 && size >= ring->Wrap - ring->Read) {
+        size -= ring->Wrap - ring->Read;
+        ring->Read = 0;
+        ring->Wrap = 0;
+    }
+
+    ring->Read += size;
+
+    /* Everything sent, make the whole buffer contiguous again */
+    if (ring->Wrap == 0 && ring->Read == ring->Write) {
+        ring->Read = 0;
+        ring->Write = 0;
+    }
+}
+
+size_t DTCOutputRing_pending(const struct DTCOutputRing *ring)
+{
+    if (ring->Wrap != 0)
+        return ring->Wrap - ring->Read + ring->Write;
+
+    return ring->Write - ring->Read;
+}
@@ -0,0 +1,81 @@
+#ifndef __DTC_ENCODER_H__
+#define __DTC_ENCODER_H__
+
+/*
+ * In-place message encoding into a caller-owned output ring.
+ *
+ * Messages are constructed directly in the ring by copying a pre-initialised
+ * template and then setting the fields that change, so nothing is memset or
+ * copied a second time on the way to the socket. Each message is contiguous;
+ * the unsent bytes are returned as at most two slices for writev()/send().
+ *
+ * Messages are packed back to back and are only as aligned as their sizes
+ * allow.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "DTCProtocol.h"
+
+/* One initialised instance of every message, e.g. templates.TradeIncrementalUpdate */
+struct DTCMessageTemplates
+{
+#define DTC_TEMPLATE_MEMBER(type, name, direction) struct s_##name name;
+    DTC_MESSAGE_LIST(DTC_TEMPLATE_MEMBER)
+#undef DTC_TEMPLATE_MEMBER
+};
+
+/* Same layout as struct iovec on POSIX systems */
+struct DTCSlice
+{
+    void *Data;
+    size_t Length;
+};
+
+struct DTCOutputRing
+{
+    unsigned char *Buffer;
+    size_t Capacity;
+    size_t Read;    /* first unsent byte */
+    size_t Write;   /* next free byte */
+    size_t Wrap;    /* end of the older data once writing has wrapped to the start, else 0 */
+};
+
+/* Calls <Name>_init() for every member */
+void DTCMessageTemplates_init(struct DTCMessageTemplates *templates);
+
+void DTCOutputRing_init(struct DTCOutputRing *ring, void *buffer, size_t capacity);
+
+/* Contiguous free space of size bytes, or NULL if the ring is too full */
+void *DTCOutputRing_reserve(struct DTCOutputRing *ring, size_t size);
+void DTCOutputRing_commit(struct DTCOutputRing *ring, size_t size);
+
+/*
+ * Copies a template message (Size bytes) into the ring and returns the copy
+ * for the caller to fill in, or NULL if the ring is too full.
+ */
+void *DTCOutputRing_emit(struct DTCOutputRing *ring, const void *template_msg);
+
+/*
+ * Emits count copies of a template back to back and returns the first one.
+ * The result can be indexed as an array of the template's struct type.
+ */
+void *DTCOutputRing_emit_batch(struct DTCOutputRing *ring, const void *template_msg, size_t count);
+
+/* Fills up to two slices with the unsent bytes and returns how many were used */
+int DTCOutputRing_slices(const struct DTCOutputRing *ring, struct DTCSlice slices[2]);
+
+/* Releases size bytes from the front once they have been sent */
+void DTCOutputRing_consume(struct DTCOutputRing *ring, size_t size);
+
+size_t DTCOutputRing_pending(const struct DTCOutputRing *ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DTC_ENCODER_H__ */
@@ -0,0 +1,386 @@
+#include "DTCFanout.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "DTCDecoder.h"
+
+static int is_depth(uint16_t msg_type)
+{
+    switch (msg_type) {
+    case MARKET_DEPTH_FULL_UPDATE_20:
+    case MARKET_DEPTH_FULL_UPDATE_10:
+    case MARKET_DEPTH_SNAPSHOT_LEVEL:
+    case MARKET_DEPTH_INCREMENTAL_UPDATE:
+    case MARKET_DEPTH_INCREMENTAL_UPDATE_COMPACT:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+void DTCFanout_init(struct DTCFanout *fanout)
+{
+    memset(fanout, 0, sizeof(struct DTCFanout));
+    pthread_mutex_init(&fanout->Lock, NULL);
+    fanout->Epoch = 1;
+}
+
+void DTCFanout_free(struct DTCFanout *fanout)
+{
+    struct DTCFanoutSet *set;
+    uint32_t i;
+
+    for (i = 0; i < DTC_SYMBOL_ID_COUNT; i++) {
+        free(fanout->Sets[i]);
+        fanout->Sets[i] = NULL;
+    }
+    while ((set = fanout->Retired) != NULL) {
+        fanout->Retired = set->NextRetired;
+        free(set);
+    }
+    pthread_mutex_destroy(&fanout->Lock);
+}
+
+int DTCFanout_register_reader(struct DTCFanout *fanout)
+{
+    int reader = -1;
+
+    pthread_mutex_lock(&fanout->Lock);
+    if (fanout->ReaderCount < DTC_FANOUT_MAX_READERS) {
+        reader = (int)fanout->ReaderCount;
+        __atomic_store_n(&fanout->ReaderEpoch[reader], __atomic_load_n(&fanout->Epoch, __ATOMIC_SEQ_CST), __ATOMIC_SEQ_CST);
+        __atomic_store_n(&fanout->ReaderCount, fanout->ReaderCount + 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&fanout->Lock);
+    return reader;
+}
+
+void DTCFanout_quiescent(struct DTCFanout *fanout, int reader)
+{
+    int was_offline = __atomic_load_n(&fanout->ReaderEpoch[reader], __ATOMIC_RELAXED) == UINT64_MAX;
+
+    __atomic_store_n(&fanout->ReaderEpoch[reader], __atomic_load_n(&fanout->Epoch, __ATOMIC_SEQ_CST), __ATOMIC_SEQ_CST);
+
+    /* Coming back online the store must be visible before any set is read, or a writer may free it meanwhile */
+    if (was_offline)
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+void DTCFanout_offline(struct DTCFanout *fanout, int reader)
+{
+    __atomic_store_n(&fanout->ReaderEpoch[reader], UINT64_MAX, __ATOMIC_RELEASE);
+}
+
+/* Frees the retired sets no reader can still hold. Called with the lock held. */
+static void reclaim(struct DTCFanout *fanout)
+{
+    struct DTCFanoutSet **link = &fanout->Retired;
+    uint64_t oldest = UINT64_MAX;
+    uint32_t count = __atomic_load_n(&fanout->ReaderCount, __ATOMIC_ACQUIRE);
+    uint32_t i;
+
+    for (i = 0; i < count; i++) {
+        uint64_t epoch = __atomic_load_n(&fanout->ReaderEpoch[i], __ATOMIC_SEQ_CST);
+
+        if (epoch < oldest)
+            oldest = epoch;
+    }
+
+    while (*link != NULL) {
+        struct DTCFanoutSet *set = *link;
+
+        if (set->RetireEpoch <= oldest) {
+            *link = set->NextRetired;
+            free(set);
+        } else {
+            link = &set->NextRetired;
+        }
+    }
+}
+
+/* A client_id of 0 matches every entry of the subscriber */
+static int matches(const struct DTCFanoutEntry *entry, void *subscriber, uint16_t client_id, int remove)
+{
+    return remove && entry->Subscriber == subscriber && (client_id == 0 || entry->SymbolID == client_id);
+}
+
+/*
+ * Replaces the set of symbol_id with a copy lacking the subscriber's
+ * entries for client_id of the kinds in remove_kinds and, if add is not
+ * NULL, with add as an entry of add_kind. Called with the lock held.
+ */
+static int update(struct DTCFanout *fanout, uint16_t symbol_id, void *subscriber, uint16_t client_id, int remove_kinds,
+                  const struct DTCFanoutEntry *add, int add_kind)
+{
+    struct DTCFanoutSet *old = fanout->Sets[symbol_id];
+    struct DTCFanoutSet *set = NULL;
+    const struct DTCFanoutEntry *old_depth = NULL;
+    int remove_market = (remove_kinds & DTC_FANOUT_MARKET_DATA) != 0;
+    int remove_depth = (remove_kinds & DTC_FANOUT_DEPTH) != 0;
+    uint32_t market_count = 0;
+    uint32_t depth_count = 0;
+    uint32_t removed = 0;
+    uint32_t i;
+
+    if (old != NULL) {
+        old_depth = old->Entries + old->MarketDataCount;
+        for (i = 0; i < old->MarketDataCount; i++)
+            if (!matches(&old->Entries[i], subscriber, client_id, remove_market))
+                market_count++;
+        for (i = 0; i < old->DepthCount; i++)
+            if (!matches(&old_depth[i], subscriber, client_id, remove_depth))
+                depth_count++;
+        removed = old->MarketDataCount + old->DepthCount - market_count - depth_count;
+    }
+    if (add == NULL && removed == 0)
+        return 0;
+
+    if (add != NULL && add_kind == DTC_FANOUT_DEPTH)
+        depth_count++;
+    else if (add != NULL)
+        market_count++;
+
+    if (market_count + depth_count > 0) {
+        struct DTCFanoutEntry *entry;
+        int added = add == NULL || add_kind != DTC_FANOUT_DEPTH;
+
+        set = (struct DTCFanoutSet *)malloc(offsetof(struct DTCFanoutSet, Entries)
+                                            + (market_count + depth_count) * sizeof(struct DTCFanoutEntry));
+        if (set == NULL) {
+            errno = ENOMEM;
+            return -1;
+        }
+        set->NextRetired = NULL;
+        set->RetireEpoch = 0;
+        set->MarketDataCount = market_count;
+        set->DepthCount = depth_count;
+
+        entry = set->Entries;
+        for (i = 0; old != NULL && i < old->MarketDataCount; i++)
+            if (!matches(&old->Entries[i], subscriber, client_id, remove_market))
+                *entry++ = old->Entries[i];
+        if (add != NULL && add_kind != DTC_FANOUT_DEPTH)
+            *entry++ = *add;
+
+        /* Depth entries stay sorted deepest first */
+        for (i = 0; old != NULL && i < old->DepthCount; i++) {
+            if (matches(&old_depth[i], subscriber, client_id, remove_depth))
+                continue;
+            if (!added && old_depth[i].Levels < add->Levels) {
+                *entry++ = *add;
+                added = 1;
+            }
+            *entry++ = old_depth[i];
+        }
+        if (!added)
+            *entry++ = *add;
+    }
+
+    /* Publishing before the epoch moves on means a reader seeing the new epoch sees the new set */
+    __atomic_store_n(&fanout->Sets[symbol_id], set, __ATOMIC_SEQ_CST);
+    if (old != NULL) {
+        old->RetireEpoch = __atomic_add_fetch(&fanout->Epoch, 1, __ATOMIC_SEQ_CST);
+        old->NextRetired = fanout->Retired;
+        fanout->Retired = old;
+        reclaim(fanout);
+    }
+    return 0;
+}
+
+static int subscribe(struct DTCFanout *fanout, uint16_t symbol_id, int kind, void *subscriber,
+                     uint16_t client_symbol_id, int32_t levels)
+{
+    struct DTCFanoutEntry entry;
+
+    memset(&entry, 0, sizeof(entry));
+    entry.Subscriber = subscriber;
+    entry.SymbolID = client_symbol_id;
+    entry.Levels = kind == DTC_FANOUT_DEPTH && levels > 0 ? levels : INT32_MAX;
+    return update(fanout, symbol_id, subscriber, client_symbol_id, kind, &entry, kind);
+}
+
+static int has_entry(const struct DTCFanoutSet *set, int kind, void *subscriber, uint16_t client_id)
+{
+    const struct DTCFanoutEntry *entries;
+    uint32_t count;
+    uint32_t i;
+
+    if (set == NULL)
+        return 0;
+    entries = kind == DTC_FANOUT_DEPTH ? set->Entries + set->MarketDataCount : set->Entries;
+    count = kind == DTC_FANOUT_DEPTH ? set->DepthCount : set->MarketDataCount;
+    for (i = 0; i < count; i++)
+        if (entries[i].Subscriber == subscriber && entries[i].SymbolID == client_id)
+            return 1;
+    return 0;
+}
+
+const struct DTCFanoutSet *DTCFanout_subscribers(const struct DTCFanout *fanout, uint16_t symbol_id)
+{
+    return __atomic_load_n(&fanout->Sets[symbol_id], __ATOMIC_ACQUIRE);
+}
+
+int DTCFanout_publish(const struct DTCFanout *fanout, const struct DTCMessageHeader *msg, int32_t level,
+                      DTCFanoutSendFn send, void *context)
+{
+    union {
+        struct DTCMessageHeader Header;
+        unsigned char Bytes[DTC_MAX_FRAME_SIZE];
+    } copy;
+    const struct DTCFanoutSet *set;
+    const struct DTCFanoutEntry *entries;
+    uint32_t count;
+    uint32_t i;
+    int symbol_id = get_market_data_symbol_id(msg);
+    int copy_symbol_id = -1;
+
+    if (symbol_id < 0)
+        return -1;
+
+    set = DTCFanout_subscribers(fanout, (uint16_t)symbol_id);
+    if (set == NULL)
+        return 0;
+
+    if (is_depth(msg->Type)) {
+        entries = set->Entries + set->MarketDataCount;
+        count = set->DepthCount;
+        if (level >= 0)
+            while (count > 0 && entries[count - 1].Levels <= level)
+                count--;
+    } else {
+        entries = set->Entries;
+        count = set->MarketDataCount;
+    }
+
+    for (i = 0; i < count; i++) {
+        if (entries[i].SymbolID == symbol_id) {
+            send(context, entries[i].Subscriber, msg);
+            continue;
+        }
+
+        /* Clients that chose their own ID get a copy rewritten once per distinct ID in a row */
+        if (copy_symbol_id < 0)
+            memcpy(copy.Bytes, msg, msg->Size);
+        if (copy_symbol_id != entries[i].SymbolID) {
+            set_market_data_symbol_id(&copy.Header, entries[i].SymbolID);
+            copy_symbol_id = entries[i].SymbolID;
+        }
+        send(context, entries[i].Subscriber, &copy.Header);
+    }
+    return (int)count;
+}
+
+int DTCFanout_subscribe(struct DTCFanout *fanout, uint16_t symbol_id, int kind, void *subscriber,
+                        uint16_t client_symbol_id, int32_t levels)
+{
+    int result;
+
+    pthread_mutex_lock(&fanout->Lock);
+    result = subscribe(fanout, symbol_id, kind, subscriber, client_symbol_id, levels);
+    pthread_mutex_unlock(&fanout->Lock);
+    return result;
+}
+
+int DTCFanout_unsubscribe(struct DTCFanout *fanout, uint16_t symbol_id, int kinds, void *subscriber)
+{
+    int result;
+
+    pthread_mutex_lock(&fanout->Lock);
+    result = update(fanout, symbol_id, subscriber, 0, kinds, NULL, 0);
+    pthread_mutex_unlock(&fanout->Lock);
+    return result;
+}
+
+/* The DTCSymbolKindEnum of a DTCFanoutKindEnum */
+static int symbol_kind(int kind)
+{
+    return kind == DTC_FANOUT_DEPTH ? DTC_SYMBOL_MARKET_DEPTH : DTC_SYMBOL_MARKET_DATA;
+}
+
+static int request(struct DTCFanout *fanout, struct DTCSymbolTable *table, struct DTCSymbolMap *map, void *subscriber,
+                   int kind, int32_t action, uint16_t client_id, const char *symbol, const char *exchange,
+                   int32_t levels, uint16_t *server_id)
+{
+    int table_kind = symbol_kind(kind);
+    uint16_t previous = DTCSymbolMap_find(map, table_kind, client_id);
+    uint16_t ignored;
+    int result;
+
+    *server_id = 0;
+
+    switch (action) {
+    case SUBSCRIBE:
+        result = DTCSymbolTable_request(table, map, table_kind, action, client_id, symbol, exchange, server_id);
+        if (result != DTC_SYMBOL_OK)
+            return result;
+
+        /* The client ID moved to another symbol for this kind; the table already dropped the old one */
+        if (previous != 0 && previous != *server_id)
+            update(fanout, previous, subscriber, client_id, kind, NULL, 0);
+
+        if (subscribe(fanout, *server_id, kind, subscriber, client_id, levels) < 0) {
+            if (!has_entry(fanout->Sets[*server_id], kind, subscriber, client_id))
+                DTCSymbolTable_request(table, map, table_kind, UNSUBSCRIBE, client_id, symbol, exchange, &ignored);
+            return DTC_SYMBOL_NO_MEMORY;
+        }
+        return DTC_SYMBOL_OK;
+
+    case UNSUBSCRIBE:
+        if (previous == 0)
+            return client_id == 0 ? DTC_SYMBOL_BAD_REQUEST : DTC_SYMBOL_NOT_SUBSCRIBED;
+        if (update(fanout, previous, subscriber, client_id, kind, NULL, 0) < 0)
+            return DTC_SYMBOL_NO_MEMORY;
+        DTCSymbolTable_request(table, map, table_kind, UNSUBSCRIBE, client_id, symbol, exchange, &ignored);
+        *server_id = previous;
+        return DTC_SYMBOL_OK;
+
+    default:
+        return DTCSymbolTable_request(table, map, table_kind, action, client_id, symbol, exchange, server_id);
+    }
+}
+
+int DTCFanout_market_data_request(struct DTCFanout *fanout, struct DTCSymbolTable *table, struct DTCSymbolMap *map,
+                                  void *subscriber, const struct s_MarketDataRequest *request_msg, uint16_t *server_id)
+{
+    int result;
+
+    pthread_mutex_lock(&fanout->Lock);
+    result = request(fanout, table, map, subscriber, DTC_FANOUT_MARKET_DATA, request_msg->RequestActionValue,
+                     request_msg->MarketDataSymbolID, request_msg->Symbol, request_msg->Exchange, 0, server_id);
+    pthread_mutex_unlock(&fanout->Lock);
+    return result;
+}
+
+int DTCFanout_market_depth_request(struct DTCFanout *fanout, struct DTCSymbolTable *table, struct DTCSymbolMap *map,
+                                   void *subscriber, const struct s_MarketDepthRequest *request_msg, uint16_t *server_id)
+{
+    int result;
+
+    pthread_mutex_lock(&fanout->Lock);
+    result = request(fanout, table, map, subscriber, DTC_FANOUT_DEPTH, request_msg->RequestActionValue,
+                     request_msg->MarketDataSymbolID, request_msg->Symbol, request_msg->Exchange,
+                     request_msg->NumberOfLevels, server_id);
+    pthread_mutex_unlock(&fanout->Lock);
+    return result;
+}
+
+void DTCFanout_disconnect(struct DTCFanout *fanout, struct DTCSymbolTable *table, struct DTCSymbolMap *map, void *subscriber)
+{
+    uint32_t i;
+
+    pthread_mutex_lock(&fanout->Lock);
+    for (i = 0; i <= map->Mask; i++) {
+        const struct DTCSymbolMapEntry *entry = &map->Entries[i];
+
+        if (entry->ServerID[DTC_SYMBOL_MARKET_DATA] != 0)
+            update(fanout, entry->ServerID[DTC_SYMBOL_MARKET_DATA], subscriber, entry->ClientID,
+                   DTC_FANOUT_MARKET_DATA, NULL, 0);
+        if (entry->ServerID[DTC_SYMBOL_MARKET_DEPTH] != 0)
+            update(fanout, entry->ServerID[DTC_SYMBOL_MARKET_DEPTH], subscriber, entry->ClientID,
+                   DTC_FANOUT_DEPTH, NULL, 0);
+    }
+    DTCSymbolTable_release_map(table, map);
+    pthread_mutex_unlock(&fanout->Lock);
+}
@@ -0,0 +1,128 @@
+#ifndef __DTC_FANOUT_H__
+#define __DTC_FANOUT_H__
+
+/*
+ * Subscribers of every MarketDataSymbolID, for publishing market data to
+ * many connections.
+ *
+ * Each symbol ID points to an immutable DTCFanoutSet holding two compact
+ * arrays: the subscribers of quotes and trades (MarketDataRequest) and the
+ * subscribers of depth (MarketDepthRequest), the latter sorted by
+ * NumberOfLevels, deepest first, so an update on level n stops at the
+ * first subscriber with n levels or fewer. Publishing reads one pointer and
+ * walks an array; it takes no lock and does not write shared memory.
+ *
+ * Subscription changes copy the set, swap the pointer under a mutex and
+ * retire the old copy. Retired sets are freed once every registered reader
+ * thread has passed a quiescent point, DTCFanout_quiescent(), after the
+ * swap. A reader calls it between publishes, e.g. once per event loop
+ * iteration, and goes offline before it blocks so it does not hold frees
+ * back. A set returned to a reader stays valid until its next quiescent
+ * point.
+ *
+ * Entries carry the MarketDataSymbolID each client chose, and publishing
+ * rewrites it in a copy of the message only where it differs from the
+ * server's. The request functions keep a DTCSymbolTable and the
+ * connection's DTCSymbolMap in step with the sets, under the same mutex.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <pthread.h>
+
+#include "DTCProtocol.h"
+#include "DTCSymbolTable.h"
+
+#ifndef DTC_FANOUT_MAX_READERS
+#define DTC_FANOUT_MAX_READERS 64
+#endif
+
+enum DTCFanoutKindEnum {
+    DTC_FANOUT_MARKET_DATA = 1,         /* quotes, trades and the other market data updates */
+    DTC_FANOUT_DEPTH = 2
+};
+
+struct DTCFanoutEntry
+{
+    void *Subscriber;
+    uint16_t SymbolID;                  /* the client's MarketDataSymbolID */
+    int32_t Levels;                     /* depth levels requested, INT32_MAX for all */
+};
+
+struct DTCFanoutSet
+{
+    struct DTCFanoutSet *NextRetired;
+    uint64_t RetireEpoch;
+    uint32_t MarketDataCount;
+    uint32_t DepthCount;
+    struct DTCFanoutEntry Entries[1];   /* MarketDataCount market data entries, then the depth entries */
+};
+
+typedef void (*DTCFanoutSendFn)(void *context, void *subscriber, const struct DTCMessageHeader *msg);
+
+/* Several hundred kilobytes; allocate it statically or on the heap */
+struct DTCFanout
+{
+    pthread_mutex_t Lock;
+    uint64_t Epoch;
+    uint32_t ReaderCount;
+    uint64_t ReaderEpoch[DTC_FANOUT_MAX_READERS];  /* UINT64_MAX while offline */
+    struct DTCFanoutSet *Retired;
+    struct DTCFanoutSet *Sets[DTC_SYMBOL_ID_COUNT];
+};
+
+void DTCFanout_init(struct DTCFanout *fanout);
+
+/* Frees every set; no reader may be publishing */
+void DTCFanout_free(struct DTCFanout *fanout);
+
+/* Returns the reader number for the calling thread, or -1 if all are taken */
+int DTCFanout_register_reader(struct DTCFanout *fanout);
+void DTCFanout_quiescent(struct DTCFanout *fanout, int reader);
+void DTCFanout_offline(struct DTCFanout *fanout, int reader);
+
+/* The subscribers of a server symbol ID, or NULL */
+const struct DTCFanoutSet *DTCFanout_subscribers(const struct DTCFanout *fanout, uint16_t symbol_id);
+
+/*
+ * Passes msg, which carries the server's MarketDataSymbolID, to send() for
+ * every subscriber of its kind. Depth updates only go to subscribers with
+ * more than level levels; a level of -1 reaches them all. Returns the
+ * number of subscribers, or -1 for a message without a MarketDataSymbolID.
+ */
+int DTCFanout_publish(const struct DTCFanout *fanout, const struct DTCMessageHeader *msg, int32_t level,
+                      DTCFanoutSendFn send, void *context);
+
+/*
+ * Adds or updates the subscriber's entry of one kind for client_symbol_id;
+ * entries for its other client IDs are left alone. levels of 0 or less
+ * means all. Returns 0 or -1 with errno set.
+ */
+int DTCFanout_subscribe(struct DTCFanout *fanout, uint16_t symbol_id, int kind, void *subscriber,
+                        uint16_t client_symbol_id, int32_t levels);
+
+/* Removes the subscriber's entries of the kinds in the kind mask, for every client ID */
+int DTCFanout_unsubscribe(struct DTCFanout *fanout, uint16_t symbol_id, int kinds, void *subscriber);
+
+/*
+ * Handle a connection's requests through the symbol table and map, see
+ * DTCSymbolTable_request(), and subscribe it to the server ID. Quotes and
+ * depth each hold their own reference in the table and their own server ID
+ * in the map; moving a client ID to another symbol moves only the kind
+ * requested. Return a DTCSymbolResultEnum value.
+ */
+int DTCFanout_market_data_request(struct DTCFanout *fanout, struct DTCSymbolTable *table, struct DTCSymbolMap *map,
+                                  void *subscriber, const struct s_MarketDataRequest *request, uint16_t *server_id);
+int DTCFanout_market_depth_request(struct DTCFanout *fanout, struct DTCSymbolTable *table, struct DTCSymbolMap *map,
+                                   void *subscriber, const struct s_MarketDepthRequest *request, uint16_t *server_id);
+
+/* Removes every subscription of a connection, e.g. on disconnect */
+void DTCFanout_disconnect(struct DTCFanout *fanout, struct DTCSymbolTable *table, struct DTCSymbolMap *map, void *subscriber);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DTC_FANOUT_H__ */
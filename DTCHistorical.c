@@ -0,0 +1,511 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "DTCHistorical.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "DTCBarStore.h"
+#include "DTCCompression.h"
+#include "DTCEncoder.h"
+
+#define MAX_EVENTS 256
+#define BATCH_RECORDS 64
+
+enum job_stage {
+    STAGE_HEADER,
+    STAGE_RECORDS,
+    STAGE_FINISH,
+    STAGE_DONE,
+    STAGE_FAILED        /* the compressor failed, the stream cannot be completed */
+};
+
+enum job_result {
+    JOB_SENT,
+    JOB_FAILED,
+    JOB_PARKED,         /* waiting for the socket to become writable */
+    JOB_YIELDED         /* used up its slice */
+};
+
+struct DTCHistoricalJob
+{
+    struct DTCHistoricalExecutor *Executor;
+    struct DTCHistoricalJob *NextReady;
+    struct DTCHistoricalJob *Prev;
+    struct DTCHistoricalJob *Next;
+    int Fd;
+    int Registered;                     /* added to the executor's epoll set */
+    void *UserData;
+    int Stage;
+
+    struct s_HistoricalPriceDataRequest Request;
+    struct DTCBarStore Store;
+    struct DTCBarCursor Cursor;
+    int Compressed;
+    struct DTCCompressor Compressor;
+
+    /* Records read from the store but not yet staged */
+    struct s_HistoricalPriceDataRecordResponse Batch[BATCH_RECORDS];
+    size_t BatchCount;
+    size_t BatchIndex;
+    size_t BatchOffset;                 /* bytes of Batch[BatchIndex] already compressed */
+
+    struct DTCOutputRing Staging;       /* buffer follows the job */
+};
+
+void DTCHistoricalConfig_init(struct DTCHistoricalConfig *config)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    memset(config, 0, sizeof(*config));
+    config->Threads = cpus > 0 ? (int)cpus : 1;
+    config->StagingBufferSize = 65536;
+    config->CompressionLevel = 1;
+}
+
+static void push_ready(struct DTCHistoricalExecutor *executor, struct DTCHistoricalJob *job)
+{
+    pthread_mutex_lock(&executor->Lock);
+    job->NextReady = NULL;
+    if (executor->ReadyTail != NULL)
+        executor->ReadyTail->NextReady = job;
+    else
+        executor->ReadyHead = job;
+    executor->ReadyTail = job;
+    pthread_cond_signal(&executor->Ready);
+    pthread_mutex_unlock(&executor->Lock);
+}
+
+static void finish_job(struct DTCHistoricalJob *job, int result)
+{
+    struct DTCHistoricalExecutor *executor = job->Executor;
+
+    if (job->Registered)
+        epoll_ctl(executor->EpollFd, EPOLL_CTL_DEL, job->Fd, NULL);
+    close(job->Fd);
+
+    if (job->Store.Fd >= 0)
+        DTCBarStore_close(&job->Store);
+    if (job->Compressed)
+        DTCCompressor_end(&job->Compressor);
+
+    pthread_mutex_lock(&executor->Lock);
+    if (job->Prev != NULL)
+        job->Prev->Next = job->Next;
+    else
+        executor->Jobs = job->Next;
+    if (job->Next != NULL)
+        job->Next->Prev = job->Prev;
+    executor->JobCount--;
+    pthread_mutex_unlock(&executor->Lock);
+
+    if (executor->Config.on_complete != NULL)
+        executor->Config.on_complete(executor->Config.Context, job->UserData, result == JOB_SENT ? 0 : -1);
+    free(job);
+}
+
+static void stage_message(struct DTCHistoricalJob *job, const void *msg)
+{
+    /* Only used while the staging ring is empty, so it always fits */
+    uint16_t size = ((const struct DTCMessageHeader *)msg)->Size;
+
+    memcpy(DTCOutputRing_reserve(&job->Staging, size), msg, size);
+    DTCOutputRing_commit(&job->Staging, size);
+}
+
+static void stage_reject(struct DTCHistoricalJob *job, const char *text)
+{
+    struct s_HistoricalPriceDataReject reject;
+
+    HistoricalPriceDataReject_init(&reject);
+    reject.RequestIdentifier = job->Request.RequestIdentifier;
+    strncpy(reject.RejectText, text, sizeof(reject.RejectText) - 1);
+    stage_message(job, &reject);
+    job->Stage = STAGE_DONE;
+}
+
+/* Opens the store, finds the range and stages the header response */
+static void stage_header(struct DTCHistoricalJob *job)
+{
+    const struct s_HistoricalPriceDataRequest *request = &job->Request;
+    struct s_HistoricalPriceDataHeaderResponse header;
+    char path[PATH_MAX];
+    t_DateTime start = request->StartDateTime;
+    t_DateTime end = request->EndDateTime;
+    uint64_t count;
+
+    if (request->DataInterval <= INTERVAL_TICK) {
+        stage_reject(job, "Tick data is not available");
+        return;
+    }
+
+    if (DTCBarStore_path(path, sizeof(path), job->Executor->Config.Directory, request->Symbol, request->Exchange, request->DataInterval) != 0
+        || DTCBarStore_open(&job->Store, path, request->DataInterval, 0) != 0) {
+        stage_reject(job, "No data for the symbol and interval");
+        return;
+    }
+
+    count = DTCBarStore_count(&job->Store);
+    if (request->MaximumDaysToReturn > 0 && count > 0) {
+        t_DateTime last = DTCBarStore_block(&job->Store, count - 1)->StartingDateTime[DTC_BAR_BLOCK_INDEX(count - 1)];
+        t_DateTime earliest = (end != 0 ? end : last) - (t_DateTime)request->MaximumDaysToReturn * INTERVAL_1_DAY + 1;
+
+        if (start < earliest)
+            start = earliest;
+    }
+    DTCBarStore_range(&job->Store, start, end, &job->Cursor);
+
+    HistoricalPriceDataHeaderResponse_init(&header);
+    header.RequestIdentifier = request->RequestIdentifier;
+    header.DataInterval = request->DataInterval;
+    header.NoRecordsToReturn = job->Cursor.Next == job->Cursor.End;
+
+    if (header.NoRecordsToReturn) {
+        stage_message(job, &header);
+        job->Stage = STAGE_DONE;
+        return;
+    }
+
+    if (request->UseZLibCompression) {
+        if (DTCCompressor_init(&job->Compressor, job->Executor->Config.CompressionLevel) == 0)
+            job->Compressed = 1;
+    }
+    header.RecordsUseZLibCompression = (char)job->Compressed;
+
+    stage_message(job, &header);
+    job->Stage = STAGE_RECORDS;
+}
+
+/* Stages records until the ring is full or the range is done. Returns the number staged. */
+static size_t stage_records(struct DTCHistoricalJob *job)
+{
+    size_t staged = 0;
+
+    for (;;) {
+        const struct s_HistoricalPriceDataRecordResponse *record;
+        size_t i;
+
+        if (job->BatchIndex == job->BatchCount) {
+            job->BatchCount = DTCBarStore_read(&job->Store, &job->Cursor, job->Batch, BATCH_RECORDS);
+            job->BatchIndex = 0;
+            job->BatchOffset = 0;
+            if (job->BatchCount == 0) {
+                job->Stage = job->Compressed ? STAGE_FINISH : STAGE_DONE;
+                return staged;
+            }
+            for (i = 0; i < job->BatchCount; i++)
+                job->Batch[i].RequestIdentifier = job->Request.RequestIdentifier;
+        }
+
+        record = &job->Batch[job->BatchIndex];
+        if (job->Compressed) {
+            size_t consumed;
+            int result = DTCCompressor_write(&job->Compressor, &job->Staging, (const unsigned char *)record + job->BatchOffset,
+                                             record->Size - job->BatchOffset, &consumed);
+
+            job->BatchOffset += consumed;
+            if (result == DTC_COMPRESS_ERROR)
+                job->Stage = STAGE_FAILED;
+            if (result != DTC_COMPRESS_OK)
+                return staged;
+        } else {
+            void *out = DTCOutputRing_reserve(&job->Staging, record->Size);
+
+            if (out == NULL)
+                return staged;
+            memcpy(out, record, record->Size);
+            DTCOutputRing_commit(&job->Staging, record->Size);
+        }
+
+        job->BatchIndex++;
+        job->BatchOffset = 0;
+        staged++;
+    }
+}
+
+/* Returns 0 once everything staged is sent, 1 if the socket is full, -1 on error */
+static int send_staging(struct DTCHistoricalJob *job)
+{
+    struct DTCSlice slices[2];
+    struct iovec iov[2];
+    struct msghdr hdr;
+
+    for (;;) {
+        int count = DTCOutputRing_slices(&job->Staging, slices);
+        ssize_t written;
+        int i;
+
+        if (count == 0)
+            return 0;
+
+        for (i = 0; i < count; i++) {
+            iov[i].iov_base = slices[i].Data;
+            iov[i].iov_len = slices[i].Length;
+        }
+
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.msg_iov = iov;
+        hdr.msg_iovlen = count;
+
+        written = sendmsg(job->Fd, &hdr, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return 1;
+            return -1;
+        }
+        DTCOutputRing_consume(&job->Staging, (size_t)written);
+    }
+}
+
+static int run_job(struct DTCHistoricalJob *job)
+{
+    size_t staged = 0;
+
+    for (;;) {
+        int sent;
+
+        switch (job->Stage) {
+        case STAGE_HEADER:
+            stage_header(job);
+            break;
+        case STAGE_RECORDS:
+            staged += stage_records(job);
+            break;
+        case STAGE_FINISH: {
+            int result = DTCCompressor_finish(&job->Compressor, &job->Staging);
+
+            if (result == DTC_COMPRESS_OK)
+                job->Stage = STAGE_DONE;
+            else if (result == DTC_COMPRESS_ERROR)
+                job->Stage = STAGE_FAILED;
+            break;
+        }
+        default:
+            break;
+        }
+
+        /* Retrying would make no progress and spin the worker */
+        if (job->Stage == STAGE_FAILED)
+            return JOB_FAILED;
+
+        sent = send_staging(job);
+        if (sent < 0)
+            return JOB_FAILED;
+        if (sent > 0)
+            return JOB_PARKED;
+        if (job->Stage == STAGE_DONE)
+            return JOB_SENT;
+
+        if (staged >= DTC_HISTORICAL_SLICE_RECORDS) {
+            /* Let the client decode what it has while other requests run */
+            if (job->Compressed)
+                DTCCompressor_flush(&job->Compressor, &job->Staging);
+            return JOB_YIELDED;
+        }
+    }
+}
+
+static void park_job(struct DTCHistoricalJob *job)
+{
+    struct epoll_event ev;
+
+    ev.events = EPOLLOUT | EPOLLONESHOT;
+    ev.data.ptr = job;
+
+    /* A job in neither the ready queue nor the epoll set would never finish */
+    if (job->Registered) {
+        if (epoll_ctl(job->Executor->EpollFd, EPOLL_CTL_MOD, job->Fd, &ev) != 0)
+            finish_job(job, JOB_FAILED);
+        return;
+    }
+
+    job->Registered = 1;
+    if (epoll_ctl(job->Executor->EpollFd, EPOLL_CTL_ADD, job->Fd, &ev) != 0) {
+        job->Registered = 0;
+        finish_job(job, JOB_FAILED);
+    }
+}
+
+static void *worker_thread(void *arg)
+{
+    struct DTCHistoricalExecutor *executor = (struct DTCHistoricalExecutor *)arg;
+
+    for (;;) {
+        struct DTCHistoricalJob *job;
+        int result;
+
+        pthread_mutex_lock(&executor->Lock);
+        while (!executor->Stop && executor->ReadyHead == NULL)
+            pthread_cond_wait(&executor->Ready, &executor->Lock);
+        if (executor->Stop) {
+            pthread_mutex_unlock(&executor->Lock);
+            return NULL;
+        }
+        job = executor->ReadyHead;
+        executor->ReadyHead = job->NextReady;
+        if (executor->ReadyHead == NULL)
+            executor->ReadyTail = NULL;
+        pthread_mutex_unlock(&executor->Lock);
+
+        result = run_job(job);
+        if (result == JOB_YIELDED)
+            push_ready(executor, job);
+        else if (result == JOB_PARKED)
+            park_job(job);
+        else
+            finish_job(job, result);
+    }
+}
+
+/* Moves requests whose sockets became writable back to the workers */
+static void *poller_thread(void *arg)
+{
+    struct DTCHistoricalExecutor *executor = (struct DTCHistoricalExecutor *)arg;
+    struct epoll_event events[MAX_EVENTS];
+
+    while (!executor->Stop) {
+        int n = epoll_wait(executor->EpollFd, events, MAX_EVENTS, 1000);
+        int i;
+
+        for (i = 0; i < n; i++) {
+            if (events[i].data.ptr != NULL)
+                push_ready(executor, (struct DTCHistoricalJob *)events[i].data.ptr);
+        }
+    }
+    return NULL;
+}
+
+int DTCHistoricalExecutor_start(struct DTCHistoricalExecutor *executor, const struct DTCHistoricalConfig *config)
+{
+    struct epoll_event ev;
+    int i;
+
+    if (config->Threads < 1 || config->StagingBufferSize < 4096 || config->Directory == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(executor, 0, sizeof(*executor));
+    executor->Config = *config;
+    executor->WakeFd = -1;
+
+    executor->Workers = (pthread_t *)calloc((size_t)config->Threads, sizeof(pthread_t));
+    if (executor->Workers == NULL)
+        return -1;
+
+    executor->EpollFd = epoll_create1(EPOLL_CLOEXEC);
+    executor->WakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (executor->EpollFd < 0 || executor->WakeFd < 0)
+        goto fail;
+
+    /* The wake descriptor is told apart from requests by a NULL data.ptr */
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    if (epoll_ctl(executor->EpollFd, EPOLL_CTL_ADD, executor->WakeFd, &ev) != 0)
+        goto fail;
+
+    pthread_mutex_init(&executor->Lock, NULL);
+    pthread_cond_init(&executor->Ready, NULL);
+
+    if (pthread_create(&executor->Poller, NULL, poller_thread, executor) != 0) {
+        errno = EAGAIN;
+        executor->Config.Threads = 0;
+        pthread_mutex_destroy(&executor->Lock);
+        pthread_cond_destroy(&executor->Ready);
+        goto fail;
+    }
+
+    for (i = 0; i < config->Threads; i++) {
+        if (pthread_create(&executor->Workers[i], NULL, worker_thread, executor) != 0) {
+            executor->Config.Threads = i;
+            DTCHistoricalExecutor_stop(executor);
+            errno = EAGAIN;
+            return -1;
+        }
+    }
+    return 0;
+
+fail:
+    if (executor->WakeFd >= 0)
+        close(executor->WakeFd);
+    if (executor->EpollFd >= 0)
+        close(executor->EpollFd);
+    free(executor->Workers);
+    executor->Workers = NULL;
+    return -1;
+}
+
+void DTCHistoricalExecutor_stop(struct DTCHistoricalExecutor *executor)
+{
+    uint64_t one = 1;
+    int i;
+
+    pthread_mutex_lock(&executor->Lock);
+    executor->Stop = 1;
+    pthread_cond_broadcast(&executor->Ready);
+    pthread_mutex_unlock(&executor->Lock);
+
+    if (write(executor->WakeFd, &one, sizeof(one)) != sizeof(one)) {
+        /* The poller still notices Stop within its one second timeout */
+    }
+
+    pthread_join(executor->Poller, NULL);
+    for (i = 0; i < executor->Config.Threads; i++)
+        pthread_join(executor->Workers[i], NULL);
+
+    while (executor->Jobs != NULL)
+        finish_job(executor->Jobs, JOB_FAILED);
+
+    close(executor->WakeFd);
+    close(executor->EpollFd);
+    free(executor->Workers);
+    executor->Workers = NULL;
+    pthread_mutex_destroy(&executor->Lock);
+    pthread_cond_destroy(&executor->Ready);
+}
+
+int DTCHistoricalExecutor_submit(struct DTCHistoricalExecutor *executor, int fd,
+                                 const struct s_HistoricalPriceDataRequest *request, void *user_data)
+{
+    struct DTCHistoricalJob *job;
+
+    job = (struct DTCHistoricalJob *)malloc(sizeof(struct DTCHistoricalJob) + executor->Config.StagingBufferSize);
+    if (job == NULL)
+        return -1;
+
+    job->Executor = executor;
+    job->Fd = fd;
+    job->Registered = 0;
+    job->UserData = user_data;
+    job->Stage = STAGE_HEADER;
+    job->Request = *request;
+    job->Store.Fd = -1;
+    job->Compressed = 0;
+    job->BatchCount = 0;
+    job->BatchIndex = 0;
+    job->BatchOffset = 0;
+    DTCOutputRing_init(&job->Staging, job + 1, executor->Config.StagingBufferSize);
+
+    pthread_mutex_lock(&executor->Lock);
+    job->Prev = NULL;
+    job->Next = executor->Jobs;
+    if (executor->Jobs != NULL)
+        executor->Jobs->Prev = job;
+    executor->Jobs = job;
+    executor->JobCount++;
+    pthread_mutex_unlock(&executor->Lock);
+
+    push_ready(executor, job);
+    return 0;
+}
@@ -0,0 +1,88 @@
+#ifndef __DTC_HISTORICAL_H__
+#define __DTC_HISTORICAL_H__
+
+/*
+ * Worker pool answering HistoricalPriceDataRequests from DTCBarStore files
+ * (Linux).
+ *
+ * A submitted request takes over its connection's non-blocking socket, as
+ * with OneHistoricalPriceDataRequestPerConnection set in the LogonResponse;
+ * a DTCServer connection is handed over with DTCServerConnection_detach().
+ * Workers write the header response and the records, zlib compressed when
+ * UseZLibCompression is set, into a small per-request staging ring and send
+ * it straight away. When the socket's send buffer is full the request parks
+ * until the socket is writable again, so a slow client holds no worker and
+ * no more than the staging ring in memory. Requests take turns in slices of
+ * DTC_HISTORICAL_SLICE_RECORDS records so a long download cannot starve the
+ * others.
+ *
+ * MaximumDaysToReturn limits the range to that many days before its end,
+ * EndDateTime or else the last stored bar.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <pthread.h>
+
+#include "DTCProtocol.h"
+
+#ifndef DTC_HISTORICAL_SLICE_RECORDS
+#define DTC_HISTORICAL_SLICE_RECORDS 4096
+#endif
+
+struct DTCHistoricalJob;
+
+struct DTCHistoricalConfig
+{
+    const char *Directory;              /* where the bar stores are, see DTCBarStore_path() */
+    int Threads;
+    uint32_t StagingBufferSize;         /* per request */
+    int CompressionLevel;               /* zlib level for UseZLibCompression requests */
+
+    /* Called once the request has finished and its socket is closed, may be NULL */
+    void (*on_complete)(void *context, void *user_data, int result);
+    void *Context;
+};
+
+struct DTCHistoricalExecutor
+{
+    struct DTCHistoricalConfig Config;
+    int EpollFd;
+    int WakeFd;                         /* eventfd that stops the poller */
+    volatile int Stop;
+
+    pthread_mutex_t Lock;
+    pthread_cond_t Ready;
+    struct DTCHistoricalJob *ReadyHead; /* requests waiting for a worker */
+    struct DTCHistoricalJob *ReadyTail;
+    struct DTCHistoricalJob *Jobs;      /* every request in progress */
+    uint32_t JobCount;
+
+    pthread_t Poller;
+    pthread_t *Workers;
+};
+
+/* Fills in the defaults for all settings but Directory and the callback */
+void DTCHistoricalConfig_init(struct DTCHistoricalConfig *config);
+
+/* Starts the workers. Returns 0 or -1 with errno set. */
+int DTCHistoricalExecutor_start(struct DTCHistoricalExecutor *executor, const struct DTCHistoricalConfig *config);
+
+/* Stops the workers; unfinished requests complete with -1 */
+void DTCHistoricalExecutor_stop(struct DTCHistoricalExecutor *executor);
+
+/*
+ * Queues a request to be answered on fd, which the executor closes when
+ * done. on_complete receives user_data and 0 once everything was sent, or -1
+ * if the client went away. Returns 0, or -1 with errno set, leaving fd open.
+ */
+int DTCHistoricalExecutor_submit(struct DTCHistoricalExecutor *executor, int fd,
+                                 const struct s_HistoricalPriceDataRequest *request, void *user_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DTC_HISTORICAL_H__ */
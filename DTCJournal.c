@@ -0,0 +1,300 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "DTCJournal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* Records start on the first page after the header */
+#define DATA_OFFSET ((sizeof(struct DTCJournalHeader) + 4095) & ~(size_t)4095)
+
+uint64_t DTCJournal_clock(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+int DTCJournal_segment_path(char *path, size_t size, const char *prefix, uint32_t number)
+{
+    int length = snprintf(path, size, "%s.%06u", prefix, number);
+
+    if (length < 0 || (size_t)length >= size)
+        return -1;
+    return 0;
+}
+
+/* Creates, preallocates and maps the first free segment numbered from number on */
+static int create_segment(struct DTCJournalWriter *writer, uint32_t number)
+{
+    char path[PATH_MAX];
+    struct DTCJournalHeader *header;
+    int fd;
+    int error;
+
+    for (;;) {
+        if (DTCJournal_segment_path(path, sizeof(path), writer->Prefix, number) != 0) {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+
+        fd = open(path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if (fd >= 0)
+            break;
+        if (errno != EEXIST)
+            return -1;
+        number++;
+    }
+
+    /* Reserve the blocks up front so appends never fault on a full disk */
+    error = posix_fallocate(fd, 0, (off_t)writer->SegmentSize);
+    if (error != 0) {
+        close(fd);
+        unlink(path);
+        errno = error;
+        return -1;
+    }
+
+    header = (struct DTCJournalHeader *)mmap(NULL, writer->SegmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (header == MAP_FAILED) {
+        error = errno;
+        close(fd);
+        unlink(path);
+        errno = error;
+        return -1;
+    }
+
+    memcpy(header->Magic, DTC_JOURNAL_MAGIC, sizeof(DTC_JOURNAL_MAGIC));
+    header->Version = DTC_JOURNAL_VERSION;
+    header->SegmentNumber = number;
+    header->SegmentSize = writer->SegmentSize;
+    header->DataOffset = DATA_OFFSET;
+    header->DataEnd = DATA_OFFSET;
+
+    writer->SegmentNumber = number;
+    writer->Fd = fd;
+    writer->Header = header;
+    writer->WriteOffset = DATA_OFFSET;
+    return 0;
+}
+
+static void finish_segment(struct DTCJournalHeader *header, int fd, uint64_t data_end, uint64_t segment_size)
+{
+    header->Complete = 1;
+    munmap(header, segment_size);
+
+    /*
+     * Give back the preallocated space that was not used. If this fails the
+     * segment keeps its full size, which readers handle by stopping at DataEnd.
+     */
+    while (ftruncate(fd, (off_t)data_end) != 0 && errno == EINTR)
+        ;
+    close(fd);
+}
+
+int DTCJournalWriter_open(struct DTCJournalWriter *writer, const char *prefix, uint64_t segment_size)
+{
+    size_t length = strlen(prefix);
+
+    if (length >= sizeof(writer->Prefix)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    if (segment_size < DATA_OFFSET + 4096 || segment_size > DTC_JOURNAL_MAX_SEGMENT_SIZE) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memcpy(writer->Prefix, prefix, length + 1);
+    writer->SegmentSize = segment_size;
+    writer->SegmentNumber = 0;
+    writer->Fd = -1;
+    writer->Header = NULL;
+    writer->WriteOffset = 0;
+
+    return create_segment(writer, 0);
+}
+
+int DTCJournalWriter_append(struct DTCJournalWriter *writer, const struct DTCMessageHeader *msg, uint64_t receive_time)
+{
+    size_t space = DTC_JOURNAL_RECORD_SPACE(msg->Size);
+    struct DTCJournalHeader *header;
+    struct DTCJournalRecord *record;
+    int symbol_id;
+
+    if (writer->Header == NULL) {
+        errno = EBADF;
+        return -1;
+    }
+    if (msg->Size < sizeof(struct DTCMessageHeader)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (DATA_OFFSET + space > writer->SegmentSize) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+
+    if (writer->WriteOffset + space > writer->SegmentSize) {
+        struct DTCJournalHeader *full = writer->Header;
+        uint64_t full_end = writer->WriteOffset;
+        int full_fd = writer->Fd;
+
+        /* The full segment stays current until the next one exists, so a failure here can be retried */
+        if (create_segment(writer, writer->SegmentNumber + 1) != 0)
+            return -1;
+        finish_segment(full, full_fd, full_end, writer->SegmentSize);
+    }
+
+    header = writer->Header;
+    record = (struct DTCJournalRecord *)((unsigned char *)header + writer->WriteOffset);
+    symbol_id = get_market_data_symbol_id(msg);
+
+    record->ReceiveTime = receive_time;
+    record->PreviousForSymbol = symbol_id >= 0 ? header->SymbolLast[symbol_id] : 0;
+    record->Reserved = 0;
+    memcpy(record + 1, msg, msg->Size);
+
+    if (symbol_id >= 0) {
+        header->SymbolLast[symbol_id] = (uint32_t)writer->WriteOffset;
+        header->SymbolCount[symbol_id]++;
+    }
+
+    if (header->RecordCount == 0)
+        header->FirstReceiveTime = receive_time;
+    header->LastReceiveTime = receive_time;
+    header->RecordCount++;
+
+    writer->WriteOffset += space;
+    __atomic_store_n(&header->DataEnd, writer->WriteOffset, __ATOMIC_RELEASE);
+    return 0;
+}
+
+int DTCJournalWriter_sync(struct DTCJournalWriter *writer)
+{
+    if (writer->Header == NULL)
+        return 0;
+
+    return msync(writer->Header, writer->WriteOffset, MS_ASYNC);
+}
+
+void DTCJournalWriter_close(struct DTCJournalWriter *writer)
+{
+    if (writer->Header == NULL)
+        return;
+
+    finish_segment(writer->Header, writer->Fd, writer->WriteOffset, writer->SegmentSize);
+    writer->Header = NULL;
+    writer->Fd = -1;
+}
+
+int DTCJournalReader_open(struct DTCJournalReader *reader, const char *path)
+{
+    const struct DTCJournalHeader *header;
+    struct stat st;
+    int fd;
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+    if ((size_t)st.st_size < sizeof(struct DTCJournalHeader)) {
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+
+    header = (const struct DTCJournalHeader *)mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (header == MAP_FAILED) {
+        int error = errno;
+
+        close(fd);
+        errno = error;
+        return -1;
+    }
+
+    if (memcmp(header->Magic, DTC_JOURNAL_MAGIC, sizeof(DTC_JOURNAL_MAGIC)) != 0
+        || header->Version != DTC_JOURNAL_VERSION || header->DataOffset > (uint64_t)st.st_size) {
+        munmap((void *)header, (size_t)st.st_size);
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+
+    reader->Fd = fd;
+    reader->Header = header;
+    reader->MapSize = (size_t)st.st_size;
+    reader->Offset = header->DataOffset;
+    return 0;
+}
+
+void DTCJournalReader_close(struct DTCJournalReader *reader)
+{
+    if (reader->Header == NULL)
+        return;
+
+    munmap((void *)reader->Header, reader->MapSize);
+    close(reader->Fd);
+    reader->Header = NULL;
+    reader->Fd = -1;
+}
+
+const struct DTCJournalRecord *DTCJournalReader_next(struct DTCJournalReader *reader)
+{
+    uint64_t end = __atomic_load_n(&reader->Header->DataEnd, __ATOMIC_ACQUIRE);
+    const struct DTCJournalRecord *record;
+    const struct DTCMessageHeader *msg;
+    uint64_t space;
+
+    if (end > reader->MapSize)
+        end = reader->MapSize;
+    if (reader->Offset + sizeof(struct DTCJournalRecord) + sizeof(struct DTCMessageHeader) > end)
+        return NULL;
+
+    record = (const struct DTCJournalRecord *)((const unsigned char *)reader->Header + reader->Offset);
+    msg = DTC_JOURNAL_RECORD_MESSAGE(record);
+    space = DTC_JOURNAL_RECORD_SPACE(msg->Size);
+
+    /* A damaged record ends the segment */
+    if (msg->Size < sizeof(struct DTCMessageHeader) || reader->Offset + space > end)
+        return NULL;
+
+    reader->Offset += space;
+    return record;
+}
+
+void DTCJournalReader_rewind(struct DTCJournalReader *reader)
+{
+    reader->Offset = reader->Header->DataOffset;
+}
+
+static const struct DTCJournalRecord *record_at(const struct DTCJournalReader *reader, uint32_t offset)
+{
+    if (offset == 0 || offset + sizeof(struct DTCJournalRecord) > reader->MapSize)
+        return NULL;
+
+    return (const struct DTCJournalRecord *)((const unsigned char *)reader->Header + offset);
+}
+
+const struct DTCJournalRecord *DTCJournalReader_symbol_last(const struct DTCJournalReader *reader, uint16_t symbol_id)
+{
+    return record_at(reader, reader->Header->SymbolLast[symbol_id]);
+}
+
+const struct DTCJournalRecord *DTCJournalReader_symbol_previous(const struct DTCJournalReader *reader, const struct DTCJournalRecord *record)
+{
+    return record_at(reader, record->PreviousForSymbol);
+}
@@ -0,0 +1,128 @@
+#ifndef __DTC_JOURNAL_H__
+#define __DTC_JOURNAL_H__
+
+/*
+ * Journal of received DTC frames in memory-mapped rolling segment files
+ * (POSIX).
+ *
+ * Each frame is appended exactly as received, MESSAGE_HEAD included, after a
+ * record header holding the nanosecond receive timestamp. A segment file is
+ * preallocated to its full size and mapped, so an append is a memcpy and
+ * never a system call; when a segment is full the writer rolls over to the
+ * next file, <prefix>.000000, <prefix>.000001 and so on.
+ *
+ * The segment header carries the committed length and, for every
+ * MarketDataSymbolID, the offset of the latest record of that symbol. Each
+ * record links back to the previous record of its symbol, so all records of
+ * one symbol can be walked without scanning the segment. The committed
+ * length is stored after the record, so a reader can follow a segment that
+ * is still being written.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <limits.h>
+
+#include "DTCProtocol.h"
+
+#define DTC_JOURNAL_MAGIC                   "DTCJRNL"
+#define DTC_JOURNAL_VERSION                 1
+
+/* Record offsets are 32 bits */
+#define DTC_JOURNAL_MAX_SEGMENT_SIZE        0xFFFFFFF8u
+
+struct DTCJournalHeader
+{
+    char Magic[8];
+    uint32_t Version;
+    uint32_t SegmentNumber;
+    uint64_t SegmentSize;
+    uint64_t DataOffset;                    /* first record */
+    uint64_t DataEnd;                       /* end of the committed records */
+    uint64_t RecordCount;
+    uint64_t FirstReceiveTime;
+    uint64_t LastReceiveTime;
+    uint32_t Complete;                      /* set once the writer has moved on */
+    uint32_t Reserved;
+
+    /* Per MarketDataSymbolID: offset of its latest record (0 if none) and record count */
+    uint32_t SymbolLast[DTC_SYMBOL_ID_COUNT];
+    uint32_t SymbolCount[DTC_SYMBOL_ID_COUNT];
+};
+
+/* Followed by the frame, padded to a multiple of 8 bytes */
+struct DTCJournalRecord
+{
+    uint64_t ReceiveTime;                   /* nanoseconds since the Unix epoch */
+    uint32_t PreviousForSymbol;             /* offset of the previous record of the symbol, 0 if none */
+    uint32_t Reserved;
+};
+
+#define DTC_JOURNAL_RECORD_MESSAGE(record) ((const struct DTCMessageHeader *)((const struct DTCJournalRecord *)(record) + 1))
+
+/* Space a record of a frame of size bytes takes */
+#define DTC_JOURNAL_RECORD_SPACE(size) ((sizeof(struct DTCJournalRecord) + (size_t)(size) + 7) & ~(size_t)7)
+
+struct DTCJournalWriter
+{
+    char Prefix[PATH_MAX];
+    uint64_t SegmentSize;
+    uint32_t SegmentNumber;
+    int Fd;
+    struct DTCJournalHeader *Header;        /* mapping of the current segment */
+    uint64_t WriteOffset;
+};
+
+struct DTCJournalReader
+{
+    int Fd;
+    const struct DTCJournalHeader *Header;
+    size_t MapSize;
+    uint64_t Offset;                        /* next record */
+};
+
+/* Current CLOCK_REALTIME in nanoseconds */
+uint64_t DTCJournal_clock(void);
+
+/* Writes <prefix>.<number> into path, returns -1 if it does not fit */
+int DTCJournal_segment_path(char *path, size_t size, const char *prefix, uint32_t number);
+
+/*
+ * Creates the first segment numbered after any that already exist for the
+ * prefix. segment_size includes the header. Returns 0 or -1 with errno set.
+ */
+int DTCJournalWriter_open(struct DTCJournalWriter *writer, const char *prefix, uint64_t segment_size);
+
+/*
+ * Appends a frame, rolling to a new segment when full. Returns 0 or -1 with
+ * errno set; if the next segment cannot be created the writer stays on the
+ * full one and later appends try again.
+ */
+int DTCJournalWriter_append(struct DTCJournalWriter *writer, const struct DTCMessageHeader *msg, uint64_t receive_time);
+
+/* Starts writing back dirty pages of the current segment */
+int DTCJournalWriter_sync(struct DTCJournalWriter *writer);
+
+/* Marks the current segment complete and trims its unused space */
+void DTCJournalWriter_close(struct DTCJournalWriter *writer);
+
+/* Maps a segment read-only. Returns 0 or -1 with errno set (EINVAL if it is not a journal). */
+int DTCJournalReader_open(struct DTCJournalReader *reader, const char *path);
+void DTCJournalReader_close(struct DTCJournalReader *reader);
+
+/* The next committed record, or NULL at the end of the committed data */
+const struct DTCJournalRecord *DTCJournalReader_next(struct DTCJournalReader *reader);
+void DTCJournalReader_rewind(struct DTCJournalReader *reader);
+
+/* Walks the records of one symbol from the latest back; NULL when there are no more */
+const struct DTCJournalRecord *DTCJournalReader_symbol_last(const struct DTCJournalReader *reader, uint16_t symbol_id);
+const struct DTCJournalRecord *DTCJournalReader_symbol_previous(const struct DTCJournalReader *reader, const struct DTCJournalRecord *record);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DTC_JOURNAL_H__ */
@@ -0,0 +1,249 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "DTCLatency.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * The owning thread is the only writer, so counters are updated with a
+ * relaxed load and store rather than a locked read-modify-write; the atomic
+ * accesses only keep merging threads from reading torn values.
+ */
+#define LOAD(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#define STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define ADD(p, v) STORE((p), LOAD(p) + (v))
+
+static const char *stage_names[DTC_LATENCY_STAGE_COUNT] = {
+    "receive-to-decode",
+    "decode-to-dispatch",
+    "dispatch-to-send"
+};
+
+uint64_t DTCLatency_now(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+void DTCLatency_init(struct DTCLatency *latency)
+{
+    memset(latency, 0, sizeof(struct DTCLatency));
+    latency->SlotCount = 1;
+}
+
+static int bucket_index(uint64_t value)
+{
+    int shift = 0;
+
+    if (value > DTC_LATENCY_MAX_VALUE)
+        value = DTC_LATENCY_MAX_VALUE;
+    if (value >> DTC_LATENCY_SUB_BUCKET_BITS)
+        shift = 63 - __builtin_clzll(value) - DTC_LATENCY_SUB_BUCKET_BITS;
+
+    return (shift << DTC_LATENCY_SUB_BUCKET_BITS) + (int)(value >> shift);
+}
+
+/* Largest value counted in a bucket */
+static uint64_t bucket_high(int index)
+{
+    int shift = (index >> DTC_LATENCY_SUB_BUCKET_BITS) - 1;
+    uint64_t mantissa;
+
+    if (shift < 0)
+        shift = 0;
+    mantissa = (uint64_t)(index - (shift << DTC_LATENCY_SUB_BUCKET_BITS));
+    return (mantissa << shift) + (UINT64_C(1) << shift) - 1;
+}
+
+static int slot_of(struct DTCLatency *latency, uint16_t msg_type)
+{
+    uint32_t slot;
+
+    if (msg_type >= DTC_MESSAGE_TYPE_COUNT)
+        return DTC_LATENCY_OTHER_SLOT;
+    if (latency->Slot[msg_type] != 0)
+        return latency->Slot[msg_type];
+
+    slot = latency->SlotCount;
+    if (slot == DTC_LATENCY_TYPE_SLOTS)
+        return DTC_LATENCY_OTHER_SLOT;
+
+    /* Published last so a merging thread never sees the slot without its type */
+    latency->SlotType[slot] = msg_type;
+    latency->Slot[msg_type] = (uint8_t)slot;
+    __atomic_store_n(&latency->SlotCount, slot + 1, __ATOMIC_RELEASE);
+    return (int)slot;
+}
+
+static void add_value(struct DTCLatencyHistogram *histogram, uint64_t value)
+{
+    if (value > DTC_LATENCY_MAX_VALUE)
+        value = DTC_LATENCY_MAX_VALUE;
+
+    if (histogram->Count == 0 || value < histogram->Min)
+        STORE(&histogram->Min, value);
+    if (value > histogram->Max)
+        STORE(&histogram->Max, value);
+
+    ADD(&histogram->Buckets[bucket_index(value)], 1);
+    ADD(&histogram->Total, value);
+    ADD(&histogram->Count, 1);
+}
+
+void DTCLatency_record(struct DTCLatency *latency, int stage, uint16_t msg_type, uint64_t nanoseconds)
+{
+    add_value(&latency->Histograms[slot_of(latency, msg_type)][stage], nanoseconds);
+}
+
+uint64_t DTCLatency_record_since(struct DTCLatency *latency, int stage, uint16_t msg_type, uint64_t start)
+{
+    uint64_t now = DTCLatency_now();
+
+    DTCLatency_record(latency, stage, msg_type, now > start ? now - start : 0);
+    return now;
+}
+
+/* Adds from, which may be written concurrently, into to */
+static void merge_histogram(struct DTCLatencyHistogram *to, const struct DTCLatencyHistogram *from)
+{
+    uint64_t count = LOAD(&from->Count);
+    uint64_t min;
+    uint64_t max;
+    int i;
+
+    if (count == 0)
+        return;
+
+    min = LOAD(&from->Min);
+    max = LOAD(&from->Max);
+    if (to->Count == 0 || min < to->Min)
+        to->Min = min;
+    if (max > to->Max)
+        to->Max = max;
+
+    to->Count += count;
+    to->Total += LOAD(&from->Total);
+    for (i = 0; i < DTC_LATENCY_BUCKETS; i++)
+        to->Buckets[i] += LOAD(&from->Buckets[i]);
+}
+
+void DTCLatency_merge(struct DTCLatency *snapshot, const struct DTCLatency *recorder)
+{
+    uint32_t count = __atomic_load_n(&recorder->SlotCount, __ATOMIC_ACQUIRE);
+    uint32_t slot;
+    int stage;
+
+    for (slot = 0; slot < count; slot++) {
+        int to = slot == DTC_LATENCY_OTHER_SLOT ? DTC_LATENCY_OTHER_SLOT : slot_of(snapshot, recorder->SlotType[slot]);
+
+        for (stage = 0; stage < DTC_LATENCY_STAGE_COUNT; stage++)
+            merge_histogram(&snapshot->Histograms[to][stage], &recorder->Histograms[slot][stage]);
+    }
+}
+
+const struct DTCLatencyHistogram *DTCLatency_histogram(const struct DTCLatency *latency, int stage, uint16_t msg_type)
+{
+    if (msg_type >= DTC_MESSAGE_TYPE_COUNT || latency->Slot[msg_type] == 0)
+        return NULL;
+    return &latency->Histograms[latency->Slot[msg_type]][stage];
+}
+
+void DTCLatency_total(const struct DTCLatency *latency, int stage, struct DTCLatencyHistogram *total)
+{
+    uint32_t slot;
+
+    memset(total, 0, sizeof(struct DTCLatencyHistogram));
+    for (slot = 0; slot < latency->SlotCount; slot++)
+        merge_histogram(total, &latency->Histograms[slot][stage]);
+}
+
+uint64_t DTCLatencyHistogram_percentile(const struct DTCLatencyHistogram *histogram, double percentile)
+{
+    uint64_t total = 0;
+    uint64_t target;
+    uint64_t seen = 0;
+    int i;
+
+    /* Summed from the buckets, which a concurrent merge may have left ahead of Count */
+    for (i = 0; i < DTC_LATENCY_BUCKETS; i++)
+        total += histogram->Buckets[i];
+    if (total == 0)
+        return 0;
+
+    if (percentile < 0)
+        percentile = 0;
+    if (percentile > 100)
+        percentile = 100;
+    target = (uint64_t)(percentile / 100.0 * (double)total + 0.5);
+    if (target == 0)
+        target = 1;
+
+    for (i = 0; i < DTC_LATENCY_BUCKETS; i++) {
+        seen += histogram->Buckets[i];
+        if (seen >= target)
+            break;
+    }
+    if (i == DTC_LATENCY_BUCKETS)
+        i--;
+
+    return bucket_high(i) < histogram->Max ? bucket_high(i) : histogram->Max;
+}
+
+static size_t format_line(char *buffer, size_t size, size_t length, const char *stage, const char *name,
+                          const struct DTCLatencyHistogram *histogram)
+{
+    int n;
+
+    n = snprintf(length < size ? buffer + length : NULL, length < size ? size - length : 0,
+                 "%-18s %-36s %12llu %10llu %10llu %10llu %10llu %10llu %10llu %10llu\n", stage, name,
+                 (unsigned long long)histogram->Count,
+                 (unsigned long long)(histogram->Total / histogram->Count),
+                 (unsigned long long)histogram->Min,
+                 (unsigned long long)DTCLatencyHistogram_percentile(histogram, 50),
+                 (unsigned long long)DTCLatencyHistogram_percentile(histogram, 90),
+                 (unsigned long long)DTCLatencyHistogram_percentile(histogram, 99),
+                 (unsigned long long)DTCLatencyHistogram_percentile(histogram, 99.9),
+                 (unsigned long long)histogram->Max);
+    return n > 0 ? (size_t)n : 0;
+}
+
+size_t DTCLatency_format(const struct DTCLatency *latency, char *buffer, size_t size)
+{
+    struct DTCLatencyHistogram total;
+    size_t length;
+    uint32_t slot;
+    int stage;
+    int n;
+
+    n = snprintf(buffer, size, "%-18s %-36s %12s %10s %10s %10s %10s %10s %10s %10s\n", "stage", "type", "count",
+                 "mean", "min", "p50", "p90", "p99", "p99.9", "max");
+    length = n > 0 ? (size_t)n : 0;
+
+    for (stage = 0; stage < DTC_LATENCY_STAGE_COUNT; stage++) {
+        DTCLatency_total(latency, stage, &total);
+        if (total.Count == 0)
+            continue;
+        length += format_line(buffer, size, length, stage_names[stage], "all", &total);
+
+        for (slot = 0; slot < latency->SlotCount; slot++) {
+            const struct DTCLatencyHistogram *histogram = &latency->Histograms[slot][stage];
+            const struct DTCMessageDescriptor *descriptor;
+            const char *name = "other";
+
+            if (histogram->Count == 0)
+                continue;
+            if (slot != DTC_LATENCY_OTHER_SLOT) {
+                descriptor = get_message_descriptor(latency->SlotType[slot]);
+                name = descriptor != NULL ? descriptor->Name : "unknown";
+            }
+            length += format_line(buffer, size, length, stage_names[stage], name, histogram);
+        }
+    }
+    return length;
+}
@@ -0,0 +1,108 @@
+#ifndef __DTC_LATENCY_H__
+#define __DTC_LATENCY_H__
+
+/*
+ * Latency histograms for the message pipeline, per message Type (POSIX).
+ *
+ * Each thread records into its own DTCLatency, so recording is a few plain
+ * counter increments without locks or shared cache lines. Any other thread
+ * can merge a recorder into a snapshot while its owner keeps recording; the
+ * snapshot is another DTCLatency and can be queried or formatted as text.
+ *
+ * Histograms are log-linear like HdrHistogram: every power of two is split
+ * into 16 buckets, so a value is kept to within 1/16 (6.25%) up to about 18
+ * minutes. The first DTC_LATENCY_TYPE_SLOTS - 1 message types seen get
+ * their own histograms, later ones are counted together as "other".
+ *
+ * DTCServer records RECEIVE_TO_DECODE and DISPATCH_TO_SEND for received
+ * frames when MeasureLatency is set in its config. It calls the handler as
+ * soon as a frame is decoded, so it leaves DECODE_TO_DISPATCH out, and it
+ * records DISPATCH_TO_SEND once the output ring has been written to the
+ * socket, one value per write for the oldest message answered in it. Code
+ * that hands frames on through queues can stamp them with DTCLatency_now()
+ * and record the stages itself.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "DTCProtocol.h"
+
+enum DTCLatencyStageEnum {
+    DTC_LATENCY_RECEIVE_TO_DECODE = 0,  /* bytes received until their frame is decoded */
+    DTC_LATENCY_DECODE_TO_DISPATCH = 1, /* frame decoded until its handler is called */
+    DTC_LATENCY_DISPATCH_TO_SEND = 2,   /* handler called until its responses are written to the socket */
+    DTC_LATENCY_STAGE_COUNT = 3
+};
+
+#define DTC_LATENCY_SUB_BUCKET_BITS 4
+#define DTC_LATENCY_MAX_BITS        40
+#define DTC_LATENCY_MAX_VALUE       ((UINT64_C(1) << DTC_LATENCY_MAX_BITS) - 1)
+#define DTC_LATENCY_BUCKETS         ((DTC_LATENCY_MAX_BITS - DTC_LATENCY_SUB_BUCKET_BITS + 1) << DTC_LATENCY_SUB_BUCKET_BITS)
+
+#ifndef DTC_LATENCY_TYPE_SLOTS
+#define DTC_LATENCY_TYPE_SLOTS      64
+#endif
+
+/* Slot 0 counts the types that did not get a slot of their own */
+#define DTC_LATENCY_OTHER_SLOT      0
+
+struct DTCLatencyHistogram
+{
+    uint64_t Count;
+    uint64_t Total;                 /* sum of the values, for the mean */
+    uint64_t Min;
+    uint64_t Max;
+    uint64_t Buckets[DTC_LATENCY_BUCKETS];
+};
+
+struct DTCLatency
+{
+    uint32_t SlotCount;                             /* slots in use, including slot 0 */
+    uint8_t Slot[DTC_MESSAGE_TYPE_COUNT];           /* slot of each type, 0 until assigned */
+    uint16_t SlotType[DTC_LATENCY_TYPE_SLOTS];
+    struct DTCLatencyHistogram Histograms[DTC_LATENCY_TYPE_SLOTS][DTC_LATENCY_STAGE_COUNT];
+};
+
+/* CLOCK_MONOTONIC in nanoseconds */
+uint64_t DTCLatency_now(void);
+
+/* Also resets a recorder, which only its owning thread may do */
+void DTCLatency_init(struct DTCLatency *latency);
+
+/* Adds a value in nanoseconds, larger values count as DTC_LATENCY_MAX_VALUE. Owning thread only. */
+void DTCLatency_record(struct DTCLatency *latency, int stage, uint16_t msg_type, uint64_t nanoseconds);
+
+/* Records the time since start, a DTCLatency_now() value, and returns the current time */
+uint64_t DTCLatency_record_since(struct DTCLatency *latency, int stage, uint16_t msg_type, uint64_t start);
+
+/*
+ * Adds the counts of recorder into snapshot. recorder may be in use by
+ * another thread; values it records meanwhile may or may not be included.
+ */
+void DTCLatency_merge(struct DTCLatency *snapshot, const struct DTCLatency *recorder);
+
+/* Histogram of a stage for one type, or NULL if nothing of that type was recorded */
+const struct DTCLatencyHistogram *DTCLatency_histogram(const struct DTCLatency *latency, int stage, uint16_t msg_type);
+
+/* Sum of the histograms of a stage over all types */
+void DTCLatency_total(const struct DTCLatency *latency, int stage, struct DTCLatencyHistogram *total);
+
+/* Value at or below which percentile (0 .. 100) percent of the values lie, 0 if empty */
+uint64_t DTCLatencyHistogram_percentile(const struct DTCLatencyHistogram *histogram, double percentile);
+
+/*
+ * Writes one line per recorded stage and type with count, mean, min, 50th,
+ * 90th, 99th and 99.9th percentile and max in nanoseconds. Returns the
+ * length of the full text like snprintf(); it is truncated to size - 1.
+ */
+size_t DTCLatency_format(const struct DTCLatency *latency, char *buffer, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DTC_LATENCY_H__ */
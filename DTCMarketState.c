@@ -0,0 +1,233 @@
+#include "DTCMarketState.h"
+
+#include <float.h>
+#include <string.h>
+
+void DTCMarketState_init(struct DTCMarketState *state)
+{
+    memset(state, 0, sizeof(struct DTCMarketState));
+}
+
+void DTCMarketState_reset_symbol(struct DTCMarketState *state, uint16_t symbol_id)
+{
+    state->Bid[symbol_id] = 0;
+    state->Ask[symbol_id] = 0;
+    state->BidSize[symbol_id] = 0;
+    state->AskSize[symbol_id] = 0;
+    state->QuoteDateTime[symbol_id] = 0;
+    state->LastTradePrice[symbol_id] = 0;
+    state->LastTradeSize[symbol_id] = 0;
+    state->LastTradeDateTime[symbol_id] = 0;
+    state->DailyOpen[symbol_id] = 0;
+    state->DailyHigh[symbol_id] = 0;
+    state->DailyLow[symbol_id] = 0;
+    state->DailyVolume[symbol_id] = 0;
+    state->DailyNumberOfTrades[symbol_id] = 0;
+    state->DailySet[symbol_id] = 0;
+    state->SettlementPrice[symbol_id] = 0;
+    state->OpenInterest[symbol_id] = 0;
+}
+
+void DTCMarketState_apply_quote(struct DTCMarketState *state, const struct s_QuoteIncrementalUpdate *msg)
+{
+    uint16_t id = msg->MarketDataSymbolID;
+
+    if (msg->BidPrice != DBL_MAX) {
+        state->Bid[id] = msg->BidPrice;
+        state->BidSize[id] = msg->BidSize;
+    }
+    if (msg->AskPrice != DBL_MAX) {
+        state->Ask[id] = msg->AskPrice;
+        state->AskSize[id] = msg->AskSize;
+    }
+    state->QuoteDateTime[id] = msg->QuoteDateTimeUnix;
+}
+
+void DTCMarketState_apply_quote_compact(struct DTCMarketState *state, const struct s_QuoteIncrementalUpdateCompact *msg)
+{
+    uint16_t id = msg->MarketDataSymbolID;
+
+    if (msg->BidPrice != FLT_MAX) {
+        state->Bid[id] = msg->BidPrice;
+        state->BidSize[id] = msg->BidSize;
+    }
+    if (msg->AskPrice != FLT_MAX) {
+        state->Ask[id] = msg->AskPrice;
+        state->AskSize[id] = msg->AskSize;
+    }
+    state->QuoteDateTime[id] = msg->QuoteDateTimeUnix;
+}
+
+static void apply_trade(struct DTCMarketState *state, uint16_t id, double price, double volume, double date_time)
+{
+    state->LastTradePrice[id] = price;
+    state->LastTradeSize[id] = volume;
+    state->LastTradeDateTime[id] = date_time;
+
+    state->DailyVolume[id] += volume;
+    state->DailyNumberOfTrades[id]++;
+
+    if (!(state->DailySet[id] & DTC_DAILY_OPEN_SET))
+        state->DailyOpen[id] = price;
+    if (!(state->DailySet[id] & DTC_DAILY_HIGH_SET) || price > state->DailyHigh[id])
+        state->DailyHigh[id] = price;
+    if (!(state->DailySet[id] & DTC_DAILY_LOW_SET) || price < state->DailyLow[id])
+        state->DailyLow[id] = price;
+    state->DailySet[id] = DTC_DAILY_OPEN_SET | DTC_DAILY_HIGH_SET | DTC_DAILY_LOW_SET;
+}
+
+void DTCMarketState_apply_trade(struct DTCMarketState *state, const struct s_TradeIncrementalUpdate *msg)
+{
+    apply_trade(state, msg->MarketDataSymbolID, msg->Price, msg->TradeVolume, msg->TradeDateTimeUnix);
+}
+
+void DTCMarketState_apply_trade_compact(struct DTCMarketState *state, const struct s_TradeIncrementalUpdateCompact *msg)
+{
+    apply_trade(state, msg->MarketDataSymbolID, msg->Price, msg->TradeVolume, msg->TradeDateTimeUnix);
+}
+
+void DTCMarketState_apply_snapshot(struct DTCMarketState *state, const struct s_MarketDataSnapshot *msg)
+{
+    uint16_t id = msg->MarketDataSymbolID;
+
+    state->SettlementPrice[id] = msg->SettlementPrice;
+    state->DailyOpen[id] = msg->DailyOpen;
+    state->DailyHigh[id] = msg->DailyHigh;
+    state->DailyLow[id] = msg->DailyLow;
+    state->DailyVolume[id] = msg->DailyVolume;
+    state->DailyNumberOfTrades[id] = msg->DailyNumberOfTrades;
+    state->OpenInterest[id] = msg->OpenInterest;
+
+    /* The snapshot has no unset marker; a range counts once there is one or a trade */
+    if (msg->DailyNumberOfTrades != 0 || msg->DailyOpen != 0 || msg->DailyHigh != 0 || msg->DailyLow != 0)
+        state->DailySet[id] = DTC_DAILY_OPEN_SET | DTC_DAILY_HIGH_SET | DTC_DAILY_LOW_SET;
+    else
+        state->DailySet[id] = 0;
+    state->Bid[id] = msg->Bid;
+    state->Ask[id] = msg->Ask;
+    state->BidSize[id] = msg->BidSize;
+    state->AskSize[id] = msg->AskSize;
+    state->LastTradePrice[id] = msg->LastTradePrice;
+    state->LastTradeSize[id] = msg->LastTradeSize;
+    state->LastTradeDateTime[id] = msg->LastTradeDateTimeUnix;
+}
+
+int DTCMarketState_set_tick_size(struct DTCMarketState *state, uint16_t symbol_id, double tick_size)
+{
+    return DTCTickScale_init(&state->Scale[symbol_id], tick_size);
+}
+
+int DTCMarketState_apply_security_definition(struct DTCMarketState *state, uint16_t symbol_id,
+                                             const struct s_SecurityDefinitionResponse *msg)
+{
+    return DTCTickScale_init_security_definition(&state->Scale[symbol_id], msg);
+}
+
+int DTCMarketState_apply(struct DTCMarketState *state, const struct DTCMessageHeader *msg)
+{
+    switch (msg->Type) {
+    case QUOTE_INCREMENTAL_UPDATE:
+        DTCMarketState_apply_quote(state, (const struct s_QuoteIncrementalUpdate *)msg);
+        break;
+    case QUOTE_INCREMENTAL_UPDATE_COMPACT:
+        DTCMarketState_apply_quote_compact(state, (const struct s_QuoteIncrementalUpdateCompact *)msg);
+        break;
+    case TRADE_INCREMENTAL_UPDATE:
+        DTCMarketState_apply_trade(state, (const struct s_TradeIncrementalUpdate *)msg);
+        break;
+    case TRADE_INCREMENTAL_UPDATE_COMPACT:
+        DTCMarketState_apply_trade_compact(state, (const struct s_TradeIncrementalUpdateCompact *)msg);
+        break;
+    case MARKET_DATA_SNAPSHOT:
+        DTCMarketState_apply_snapshot(state, (const struct s_MarketDataSnapshot *)msg);
+        break;
+    case DAILY_OPEN_INCREMENTAL_UPDATE: {
+        const struct s_DailyOpenIncrementalUpdate *update = (const struct s_DailyOpenIncrementalUpdate *)msg;
+        state->DailyOpen[update->MarketDataSymbolID] = update->DailyOpen;
+        state->DailySet[update->MarketDataSymbolID] |= DTC_DAILY_OPEN_SET;
+        break;
+    }
+    case DAILY_HIGH_INCREMENTAL_UPDATE: {
+        const struct s_DailyHighIncrementalUpdate *update = (const struct s_DailyHighIncrementalUpdate *)msg;
+        state->DailyHigh[update->MarketDataSymbolID] = update->DailyHigh;
+        state->DailySet[update->MarketDataSymbolID] |= DTC_DAILY_HIGH_SET;
+        break;
+    }
+    case DAILY_LOW_INCREMENTAL_UPDATE: {
+        const struct s_DailyLowIncrementalUpdate *update = (const struct s_DailyLowIncrementalUpdate *)msg;
+        state->DailyLow[update->MarketDataSymbolID] = update->DailyLow;
+        state->DailySet[update->MarketDataSymbolID] |= DTC_DAILY_LOW_SET;
+        break;
+    }
+    case DAILY_VOLUME_INCREMENTAL_UPDATE: {
+        const struct s_DailyVolumeIncrementalUpdate *update = (const struct s_DailyVolumeIncrementalUpdate *)msg;
+        state->DailyVolume[update->MarketDataSymbolID] = update->DailyVolume;
+        break;
+    }
+    case SETTLEMENT_INCREMENTAL_UPDATE: {
+        const struct s_SettlementIncrementalUpdate *update = (const struct s_SettlementIncrementalUpdate *)msg;
+        state->SettlementPrice[update->MarketDataSymbolID] = update->SettlementPrice;
+        break;
+    }
+    case OPEN_INTEREST_INCREMENTAL_UPDATE: {
+        const struct s_OpenInterestIncrementalUpdate *update = (const struct s_OpenInterestIncrementalUpdate *)msg;
+        state->OpenInterest[update->MarketDataSymbolID] = update->OpenInterest;
+        break;
+    }
+    case FUNDAMENTAL_DATA_RESPONSE: {
+        const struct s_FundamentalDataResponse *response = (const struct s_FundamentalDataResponse *)msg;
+        DTCMarketState_set_tick_size(state, response->MarketDataSymbolID, response->TickSize);
+        break;
+    }
+    default:
+        return DTC_MARKET_STATE_UNHANDLED_TYPE;
+    }
+    return DTC_MARKET_STATE_OK;
+}
+
+void DTCMarketState_to_snapshot(const struct DTCMarketState *state, uint16_t symbol_id, struct s_MarketDataSnapshot *msg)
+{
+    MarketDataSnapshot_init(msg);
+    msg->MarketDataSymbolID = symbol_id;
+    msg->SettlementPrice = state->SettlementPrice[symbol_id];
+    msg->DailyOpen = state->DailyOpen[symbol_id];
+    msg->DailyHigh = state->DailyHigh[symbol_id];
+    msg->DailyLow = state->DailyLow[symbol_id];
+    msg->DailyVolume = state->DailyVolume[symbol_id];
+    msg->DailyNumberOfTrades = state->DailyNumberOfTrades[symbol_id];
+    msg->OpenInterest = state->OpenInterest[symbol_id];
+    msg->Bid = state->Bid[symbol_id];
+    msg->Ask = state->Ask[symbol_id];
+    msg->BidSize = state->BidSize[symbol_id];
+    msg->AskSize = state->AskSize[symbol_id];
+    msg->LastTradePrice = state->LastTradePrice[symbol_id];
+    msg->LastTradeSize = state->LastTradeSize[symbol_id];
+    msg->LastTradeDateTimeUnix = state->LastTradeDateTime[symbol_id];
+}
+
+static int64_t integer_price(const struct DTCTickScale *scale, double price)
+{
+    int64_t integer = 0;
+
+    DTCTickScale_to_integer(scale, price, &integer);
+    return integer;
+}
+
+int DTCMarketState_to_integer_snapshot(const struct DTCMarketState *state, uint16_t symbol_id,
+                                       struct DTCIntegerSnapshot *snapshot)
+{
+    const struct DTCTickScale *scale = &state->Scale[symbol_id];
+
+    if (scale->Divisor == 0)
+        return -1;
+
+    snapshot->Divisor = scale->Divisor;
+    snapshot->SettlementPrice = integer_price(scale, state->SettlementPrice[symbol_id]);
+    snapshot->DailyOpen = integer_price(scale, state->DailyOpen[symbol_id]);
+    snapshot->DailyHigh = integer_price(scale, state->DailyHigh[symbol_id]);
+    snapshot->DailyLow = integer_price(scale, state->DailyLow[symbol_id]);
+    snapshot->Bid = integer_price(scale, state->Bid[symbol_id]);
+    snapshot->Ask = integer_price(scale, state->Ask[symbol_id]);
+    snapshot->LastTradePrice = integer_price(scale, state->LastTradePrice[symbol_id]);
+    return 0;
+}
@@ -0,0 +1,117 @@
+#ifndef __DTC_MARKET_STATE_H__
+#define __DTC_MARKET_STATE_H__
+
+/*
+ * Top of book and daily statistics for every MarketDataSymbolID.
+ *
+ * The state is stored as one dense array per field indexed directly by
+ * MarketDataSymbolID, so an update touches only the cache lines of the fields
+ * it changes and there is no per-symbol lookup or allocation. The struct is
+ * several megabytes; allocate it statically or on the heap.
+ *
+ * Once a symbol's tick size is known, from FundamentalDataResponse or
+ * SecurityDefinitionResponse, its prices can also be read out as integer
+ * tick prices, see DTCTickPrice.h.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "DTCProtocol.h"
+#include "DTCTickPrice.h"
+
+/* Bits of DailySet; prices may be 0 or negative, so 0 cannot mean unset */
+enum DTCMarketStateDailyEnum {
+    DTC_DAILY_OPEN_SET = 1,
+    DTC_DAILY_HIGH_SET = 2,
+    DTC_DAILY_LOW_SET = 4
+};
+
+enum DTCMarketStateResultEnum {
+    DTC_MARKET_STATE_OK = 0,
+    DTC_MARKET_STATE_UNHANDLED_TYPE = -1    /* not a market data message */
+};
+
+struct DTCMarketState
+{
+    double Bid[DTC_SYMBOL_ID_COUNT];
+    double Ask[DTC_SYMBOL_ID_COUNT];
+    double BidSize[DTC_SYMBOL_ID_COUNT];
+    double AskSize[DTC_SYMBOL_ID_COUNT];
+    double QuoteDateTime[DTC_SYMBOL_ID_COUNT];
+
+    double LastTradePrice[DTC_SYMBOL_ID_COUNT];
+    double LastTradeSize[DTC_SYMBOL_ID_COUNT];
+    double LastTradeDateTime[DTC_SYMBOL_ID_COUNT];
+
+    double DailyOpen[DTC_SYMBOL_ID_COUNT];
+    double DailyHigh[DTC_SYMBOL_ID_COUNT];
+    double DailyLow[DTC_SYMBOL_ID_COUNT];
+    double DailyVolume[DTC_SYMBOL_ID_COUNT];
+    uint32_t DailyNumberOfTrades[DTC_SYMBOL_ID_COUNT];
+    uint8_t DailySet[DTC_SYMBOL_ID_COUNT];      /* DTCMarketStateDailyEnum bits */
+
+    double SettlementPrice[DTC_SYMBOL_ID_COUNT];
+    uint32_t OpenInterest[DTC_SYMBOL_ID_COUNT];
+
+    struct DTCTickScale Scale[DTC_SYMBOL_ID_COUNT];     /* Divisor 0 until the tick size is set */
+};
+
+/* The prices of a MarketDataSnapshot as integers in the symbol's DTCTickScale */
+struct DTCIntegerSnapshot
+{
+    double Divisor;                 /* integer price = price * Divisor */
+    int64_t SettlementPrice;
+    int64_t DailyOpen;
+    int64_t DailyHigh;
+    int64_t DailyLow;
+    int64_t Bid;
+    int64_t Ask;
+    int64_t LastTradePrice;
+};
+
+void DTCMarketState_init(struct DTCMarketState *state);
+
+/* Zeroes all fields of one symbol except its tick size, e.g. at the start of a new session */
+void DTCMarketState_reset_symbol(struct DTCMarketState *state, uint16_t symbol_id);
+
+/* Quote prices still at the DBL_MAX/FLT_MAX unset value leave the stored side unchanged */
+void DTCMarketState_apply_quote(struct DTCMarketState *state, const struct s_QuoteIncrementalUpdate *msg);
+void DTCMarketState_apply_quote_compact(struct DTCMarketState *state, const struct s_QuoteIncrementalUpdateCompact *msg);
+
+/* Trades also accumulate daily volume and number of trades and extend the daily range */
+void DTCMarketState_apply_trade(struct DTCMarketState *state, const struct s_TradeIncrementalUpdate *msg);
+void DTCMarketState_apply_trade_compact(struct DTCMarketState *state, const struct s_TradeIncrementalUpdateCompact *msg);
+
+void DTCMarketState_apply_snapshot(struct DTCMarketState *state, const struct s_MarketDataSnapshot *msg);
+
+/* Returns 0, or -1 if tick_size is not usable, leaving the symbol without one */
+int DTCMarketState_set_tick_size(struct DTCMarketState *state, uint16_t symbol_id, double tick_size);
+
+/* A SecurityDefinitionResponse names the symbol but not its MarketDataSymbolID, the caller passes it */
+int DTCMarketState_apply_security_definition(struct DTCMarketState *state, uint16_t symbol_id,
+                                             const struct s_SecurityDefinitionResponse *msg);
+
+/*
+ * Applies any of the market data messages above, the daily, settlement and
+ * open interest updates, and the tick size of a FundamentalDataResponse.
+ */
+int DTCMarketState_apply(struct DTCMarketState *state, const struct DTCMessageHeader *msg);
+
+/* Writes the state of one symbol as a complete MarketDataSnapshot message */
+void DTCMarketState_to_snapshot(const struct DTCMarketState *state, uint16_t symbol_id, struct s_MarketDataSnapshot *msg);
+
+/*
+ * Writes the prices of one symbol as integer tick prices. Prices that do not
+ * convert are 0, like unset ones. Returns 0, or -1 if the symbol has no tick
+ * size.
+ */
+int DTCMarketState_to_integer_snapshot(const struct DTCMarketState *state, uint16_t symbol_id,
+                                       struct DTCIntegerSnapshot *snapshot);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DTC_MARKET_STATE_H__ */
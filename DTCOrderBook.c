@@ -0,0 +1,344 @@
+#include "DTCOrderBook.h"
+
+#include <string.h>
+
+void DTCOrderBook_init(struct DTCOrderBook *book, uint16_t symbol_id)
+{
+    book->MarketDataSymbolID = symbol_id;
+    book->InSnapshot = 0;
+    book->Bids.Count = 0;
+    book->Asks.Count = 0;
+    memset(&book->Scale, 0, sizeof(book->Scale));
+}
+
+void DTCOrderBook_clear(struct DTCOrderBook *book)
+{
+    book->Bids.Count = 0;
+    book->Asks.Count = 0;
+}
+
+/* Maps a double to an integer with the same order, for books without a tick size */
+static int64_t double_key(double price)
+{
+    int64_t bits;
+
+    memcpy(&bits, &price, sizeof(bits));
+    return bits < 0 ? bits ^ INT64_MAX : bits;
+}
+
+/* Returns 0, or -1 for NaN and, with a tick size, a price that does not convert */
+static int price_key(const struct DTCOrderBook *book, double price, int64_t *key)
+{
+    if (book->Scale.Divisor != 0)
+        return DTCTickScale_to_integer(&book->Scale, price, key);
+    if (price != price)
+        return -1;
+    *key = double_key(price);
+    return 0;
+}
+
+/* Sets the keys of a sorted side, merging levels that fall on the same tick and dropping bad prices */
+static void rekey_side(const struct DTCOrderBook *book, struct DTCBookSide *side)
+{
+    uint32_t count = 0;
+    uint32_t i;
+
+    for (i = 0; i < side->Count; i++) {
+        int64_t key;
+
+        if (price_key(book, side->Price[i], &key) < 0)
+            continue;
+
+        if (count > 0 && side->Key[count - 1] == key) {
+            side->Volume[count - 1] += side->Volume[i];
+            continue;
+        }
+
+        side->Key[count] = key;
+        side->Price[count] = book->Scale.Divisor != 0 ? DTCTickScale_to_price(&book->Scale, key) : side->Price[i];
+        side->Volume[count] = side->Volume[i];
+        count++;
+    }
+    side->Count = count;
+}
+
+void DTCOrderBook_set_tick_size(struct DTCOrderBook *book, double tick_size)
+{
+    DTCTickScale_init(&book->Scale, tick_size);
+    rekey_side(book, &book->Bids);
+    rekey_side(book, &book->Asks);
+}
+
+/* Index of the first level not better than key */
+static uint32_t find_level(const struct DTCBookSide *side, int64_t key, int is_bid)
+{
+    uint32_t lo = 0;
+    uint32_t hi = side->Count;
+
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        int better = is_bid ? side->Key[mid] > key : side->Key[mid] < key;
+
+        if (better)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static void set_level(struct DTCBookSide *side, int64_t key, double price, double volume, int is_bid)
+{
+    uint32_t i;
+    uint32_t tail;
+
+    /* Snapshots and most updates extend the worst end, skip the search */
+    if (side->Count == 0 || (is_bid ? key < side->Key[side->Count - 1] : key > side->Key[side->Count - 1]))
+        i = side->Count;
+    else
+        i = find_level(side, key, is_bid);
+
+    if (i < side->Count && side->Key[i] == key) {
+        side->Volume[i] = volume;
+        return;
+    }
+
+    if (i >= DTC_BOOK_MAX_LEVELS)
+        return;
+
+    /* Insert, dropping the worst level if the side is full */
+    tail = side->Count - i;
+    if (side->Count == DTC_BOOK_MAX_LEVELS)
+        tail--;
+    else
+        side->Count++;
+
+    memmove(&side->Key[i + 1], &side->Key[i], tail * sizeof(int64_t));
+    memmove(&side->Price[i + 1], &side->Price[i], tail * sizeof(double));
+    memmove(&side->Volume[i + 1], &side->Volume[i], tail * sizeof(double));
+    side->Key[i] = key;
+    side->Price[i] = price;
+    side->Volume[i] = volume;
+}
+
+static void delete_level(struct DTCBookSide *side, int64_t key, int is_bid)
+{
+    uint32_t i = find_level(side, key, is_bid);
+    uint32_t tail;
+
+    if (i >= side->Count || side->Key[i] != key)
+        return;
+
+    tail = side->Count - i - 1;
+    memmove(&side->Key[i], &side->Key[i + 1], tail * sizeof(int64_t));
+    memmove(&side->Price[i], &side->Price[i + 1], tail * sizeof(double));
+    memmove(&side->Volume[i], &side->Volume[i + 1], tail * sizeof(double));
+    side->Count--;
+}
+
+static int update_level(struct DTCOrderBook *book, int side, int64_t key, double price, double volume, int update_type)
+{
+    struct DTCBookSide *book_side;
+    int is_bid;
+
+    if (side == AT_BID)
+        book_side = &book->Bids;
+    else if (side == AT_ASK)
+        book_side = &book->Asks;
+    else
+        return DTC_BOOK_BAD_SIDE;
+
+    is_bid = side == AT_BID;
+
+    switch (update_type) {
+    case DEPTH_INSERT_UPDATE:
+        set_level(book_side, key, price, volume, is_bid);
+        break;
+    case DEPTH_DELETE:
+        delete_level(book_side, key, is_bid);
+        break;
+    default:
+        return DTC_BOOK_BAD_UPDATE_TYPE;
+    }
+    return DTC_BOOK_OK;
+}
+
+int DTCOrderBook_update(struct DTCOrderBook *book, int side, double price, double volume, int update_type)
+{
+    int64_t key;
+
+    if (price_key(book, price, &key) < 0)
+        return DTC_BOOK_BAD_PRICE;
+
+    /* On the tick grid the stored price is the exact value of the key */
+    if (book->Scale.Divisor != 0)
+        price = DTCTickScale_to_price(&book->Scale, key);
+    return update_level(book, side, key, price, volume, update_type);
+}
+
+int DTCOrderBook_update_integer(struct DTCOrderBook *book, int side, int64_t price, double volume, int update_type)
+{
+    if (book->Scale.Divisor == 0)
+        return DTC_BOOK_NO_TICK_SIZE;
+    if (price <= -DTC_TICK_MAX_INTEGER || price >= DTC_TICK_MAX_INTEGER)
+        return DTC_BOOK_BAD_PRICE;
+    return update_level(book, side, price, DTCTickScale_to_price(&book->Scale, price), volume, update_type);
+}
+
+int DTCOrderBook_apply_snapshot_level(struct DTCOrderBook *book, const struct s_MarketDepthSnapshotLevel *msg)
+{
+    int result = DTC_BOOK_OK;
+
+    if (msg->FirstMessageInBatch) {
+        DTCOrderBook_clear(book);
+        book->InSnapshot = 1;
+    }
+
+    /* An empty book is sent as a single level with the side unset */
+    if (msg->Side != BID_ASK_UNSET)
+        result = DTCOrderBook_update(book, msg->Side, msg->Price, msg->Volume, DEPTH_INSERT_UPDATE);
+
+    if (msg->LastMessageInBatch)
+        book->InSnapshot = 0;
+
+    return result;
+}
+
+int DTCOrderBook_apply_incremental(struct DTCOrderBook *book, const struct s_MarketDepthIncrementalUpdate *msg)
+{
+    return DTCOrderBook_update(book, msg->Side, msg->Price, msg->Volume, msg->UpdateType);
+}
+
+int DTCOrderBook_apply_incremental_compact(struct DTCOrderBook *book, const struct s_MarketDepthIncrementalUpdateCompact *msg)
+{
+    return DTCOrderBook_update(book, msg->Side, msg->Price, msg->Volume, msg->UpdateType);
+}
+
+/* Full updates list both sides best first, an all zero level ends a side. Keys are set afterwards. */
+#define APPLY_FULL_UPDATE(book, msg, levels) \
+    do { \
+        int i_; \
+        DTCOrderBook_clear(book); \
+        for (i_ = 0; i_ < (levels) && i_ < DTC_BOOK_MAX_LEVELS; i_++) { \
+            if ((msg)->BidDepth[i_].Price == 0 && (msg)->BidDepth[i_].Volume == 0) \
+                break; \
+            (book)->Bids.Price[i_] = (msg)->BidDepth[i_].Price; \
+            (book)->Bids.Volume[i_] = (msg)->BidDepth[i_].Volume; \
+            (book)->Bids.Count++; \
+        } \
+        for (i_ = 0; i_ < (levels) && i_ < DTC_BOOK_MAX_LEVELS; i_++) { \
+            if ((msg)->AskDepth[i_].Price == 0 && (msg)->AskDepth[i_].Volume == 0) \
+                break; \
+            (book)->Asks.Price[i_] = (msg)->AskDepth[i_].Price; \
+            (book)->Asks.Volume[i_] = (msg)->AskDepth[i_].Volume; \
+            (book)->Asks.Count++; \
+        } \
+        rekey_side(book, &(book)->Bids); \
+        rekey_side(book, &(book)->Asks); \
+    } while (0)
+
+int DTCOrderBook_apply_full_update10(struct DTCOrderBook *book, const struct s_MarketDepthFullUpdate10 *msg)
+{
+    APPLY_FULL_UPDATE(book, msg, NUM_DEPTH_LEVELS10);
+    return DTC_BOOK_OK;
+}
+
+int DTCOrderBook_apply_full_update20(struct DTCOrderBook *book, const struct s_MarketDepthFullUpdate20 *msg)
+{
+    APPLY_FULL_UPDATE(book, msg, NUM_DEPTH_LEVELS20);
+    return DTC_BOOK_OK;
+}
+
+#define WRITE_FULL_UPDATE(book, msg, levels) \
+    do { \
+        uint32_t i_; \
+        (msg)->MarketDataSymbolID = (book)->MarketDataSymbolID; \
+        for (i_ = 0; i_ < (levels) && i_ < (book)->Bids.Count; i_++) { \
+            (msg)->BidDepth[i_].Price = (book)->Bids.Price[i_]; \
+            (msg)->BidDepth[i_].Volume = (float)(book)->Bids.Volume[i_]; \
+        } \
+        for (i_ = 0; i_ < (levels) && i_ < (book)->Asks.Count; i_++) { \
+            (msg)->AskDepth[i_].Price = (book)->Asks.Price[i_]; \
+            (msg)->AskDepth[i_].Volume = (float)(book)->Asks.Volume[i_]; \
+        } \
+    } while (0)
+
+void DTCOrderBook_to_full_update10(const struct DTCOrderBook *book, struct s_MarketDepthFullUpdate10 *msg)
+{
+    MarketDepthFullUpdate10_init(msg);
+    WRITE_FULL_UPDATE(book, msg, NUM_DEPTH_LEVELS10);
+}
+
+void DTCOrderBook_to_full_update20(const struct DTCOrderBook *book, struct s_MarketDepthFullUpdate20 *msg)
+{
+    MarketDepthFullUpdate20_init(msg);
+    WRITE_FULL_UPDATE(book, msg, NUM_DEPTH_LEVELS20);
+}
+
+void DTCOrderBookSet_init(struct DTCOrderBookSet *set, struct DTCOrderBook *books, uint32_t capacity)
+{
+    set->Books = books;
+    /* Slots are 16 bit */
+    set->Capacity = capacity < DTC_SYMBOL_ID_COUNT - 1 ? capacity : DTC_SYMBOL_ID_COUNT - 1;
+    set->Count = 0;
+    memset(set->Slot, 0, sizeof(set->Slot));
+}
+
+struct DTCOrderBook *DTCOrderBookSet_get(struct DTCOrderBookSet *set, uint16_t symbol_id, int create)
+{
+    uint16_t slot = set->Slot[symbol_id];
+    struct DTCOrderBook *book;
+
+    if (slot != 0)
+        return &set->Books[slot - 1];
+
+    if (!create || set->Count == set->Capacity)
+        return NULL;
+
+    book = &set->Books[set->Count++];
+    DTCOrderBook_init(book, symbol_id);
+    set->Slot[symbol_id] = (uint16_t)set->Count;
+    return book;
+}
+
+int DTCOrderBookSet_apply(struct DTCOrderBookSet *set, const struct DTCMessageHeader *msg)
+{
+    struct DTCOrderBook *book;
+
+    switch (msg->Type) {
+    case MARKET_DEPTH_SNAPSHOT_LEVEL:
+        book = DTCOrderBookSet_get(set, ((const struct s_MarketDepthSnapshotLevel *)msg)->MarketDataSymbolID, 1);
+        return book ? DTCOrderBook_apply_snapshot_level(book, (const struct s_MarketDepthSnapshotLevel *)msg) : DTC_BOOK_NO_BOOK;
+    case MARKET_DEPTH_INCREMENTAL_UPDATE:
+        book = DTCOrderBookSet_get(set, ((const struct s_MarketDepthIncrementalUpdate *)msg)->MarketDataSymbolID, 1);
+        return book ? DTCOrderBook_apply_incremental(book, (const struct s_MarketDepthIncrementalUpdate *)msg) : DTC_BOOK_NO_BOOK;
+    case MARKET_DEPTH_INCREMENTAL_UPDATE_COMPACT:
+        book = DTCOrderBookSet_get(set, ((const struct s_MarketDepthIncrementalUpdateCompact *)msg)->MarketDataSymbolID, 1);
+        return book ? DTCOrderBook_apply_incremental_compact(book, (const struct s_MarketDepthIncrementalUpdateCompact *)msg) : DTC_BOOK_NO_BOOK;
+    case MARKET_DEPTH_FULL_UPDATE_10:
+        book = DTCOrderBookSet_get(set, ((const struct s_MarketDepthFullUpdate10 *)msg)->MarketDataSymbolID, 1);
+        return book ? DTCOrderBook_apply_full_update10(book, (const struct s_MarketDepthFullUpdate10 *)msg) : DTC_BOOK_NO_BOOK;
+    case MARKET_DEPTH_FULL_UPDATE_20:
+        book = DTCOrderBookSet_get(set, ((const struct s_MarketDepthFullUpdate20 *)msg)->MarketDataSymbolID, 1);
+        return book ? DTCOrderBook_apply_full_update20(book, (const struct s_MarketDepthFullUpdate20 *)msg) : DTC_BOOK_NO_BOOK;
+    case FUNDAMENTAL_DATA_RESPONSE:
+        book = DTCOrderBookSet_get(set, ((const struct s_FundamentalDataResponse *)msg)->MarketDataSymbolID, 1);
+        if (book == NULL)
+            return DTC_BOOK_NO_BOOK;
+        DTCOrderBook_set_tick_size(book, ((const struct s_FundamentalDataResponse *)msg)->TickSize);
+        return DTC_BOOK_OK;
+    default:
+        return DTC_BOOK_UNHANDLED_TYPE;
+    }
+}
+
+int DTCOrderBookSet_apply_security_definition(struct DTCOrderBookSet *set, uint16_t symbol_id,
+                                              const struct s_SecurityDefinitionResponse *msg)
+{
+    struct DTCOrderBook *book = DTCOrderBookSet_get(set, symbol_id, 1);
+
+    if (book == NULL)
+        return DTC_BOOK_NO_BOOK;
+    DTCOrderBook_set_tick_size(book, msg->TickSize);
+    return DTC_BOOK_OK;
+}
@@ -0,0 +1,113 @@
+#ifndef __DTC_ORDER_BOOK_H__
+#define __DTC_ORDER_BOOK_H__
+
+/*
+ * Price level order books built from market depth messages.
+ *
+ * Each side is a set of flat arrays sorted best price first, so lookups are
+ * a binary search and updates near the top of the book move only a few
+ * contiguous elements. Books are kept in a caller-provided pool and found
+ * through a dense index on MarketDataSymbolID.
+ *
+ * Levels are matched on an integer price key. Once the book knows its
+ * symbol's TickSize the key is the DTCTickScale integer price, so a level
+ * sent as 4500.1 in a double and as 4500.1f in a compact update is the same
+ * level, and stored prices are exact multiples of the tick. Without a tick
+ * size the key orders like the double itself and matching is exact.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "DTCProtocol.h"
+#include "DTCTickPrice.h"
+
+/* Levels kept per side, levels beyond this are dropped */
+#ifndef DTC_BOOK_MAX_LEVELS
+#define DTC_BOOK_MAX_LEVELS                         64
+#endif
+
+enum DTCBookResultEnum {
+    DTC_BOOK_OK = 0,
+    DTC_BOOK_NO_BOOK = -1,          /* no book for the MarketDataSymbolID */
+    DTC_BOOK_BAD_SIDE = -2,         /* Side is not AT_BID or AT_ASK */
+    DTC_BOOK_BAD_UPDATE_TYPE = -3,
+    DTC_BOOK_UNHANDLED_TYPE = -4,   /* not a market depth message */
+    DTC_BOOK_NO_TICK_SIZE = -5,     /* integer price update before the tick size is known */
+    DTC_BOOK_BAD_PRICE = -6         /* NaN, or off the integer range of the tick size, see DTCTickPrice.h */
+};
+
+struct DTCBookSide
+{
+    uint32_t Count;
+    int64_t Key[DTC_BOOK_MAX_LEVELS];       /* integer price with a tick size */
+    double Price[DTC_BOOK_MAX_LEVELS];
+    double Volume[DTC_BOOK_MAX_LEVELS];
+};
+
+struct DTCOrderBook
+{
+    uint16_t MarketDataSymbolID;
+    unsigned char InSnapshot;   /* between FirstMessageInBatch and LastMessageInBatch */
+    struct DTCTickScale Scale;  /* Divisor 0 until the tick size is set */
+    struct DTCBookSide Bids;    /* highest price first */
+    struct DTCBookSide Asks;    /* lowest price first */
+};
+
+struct DTCOrderBookSet
+{
+    struct DTCOrderBook *Books;
+    uint32_t Capacity;
+    uint32_t Count;
+    uint16_t Slot[DTC_SYMBOL_ID_COUNT];     /* book index + 1, 0 if none */
+};
+
+void DTCOrderBook_init(struct DTCOrderBook *book, uint16_t symbol_id);
+void DTCOrderBook_clear(struct DTCOrderBook *book);
+
+/* Switches the book to integer prices on the tick grid, levels already in the book are kept */
+void DTCOrderBook_set_tick_size(struct DTCOrderBook *book, double tick_size);
+
+/* Sets (DEPTH_INSERT_UPDATE) or removes (DEPTH_DELETE) the level at price */
+int DTCOrderBook_update(struct DTCOrderBook *book, int side, double price, double volume, int update_type);
+
+/* As DTCOrderBook_update() with an integer price in the book's DTCTickScale */
+int DTCOrderBook_update_integer(struct DTCOrderBook *book, int side, int64_t price, double volume, int update_type);
+
+int DTCOrderBook_apply_snapshot_level(struct DTCOrderBook *book, const struct s_MarketDepthSnapshotLevel *msg);
+int DTCOrderBook_apply_incremental(struct DTCOrderBook *book, const struct s_MarketDepthIncrementalUpdate *msg);
+int DTCOrderBook_apply_incremental_compact(struct DTCOrderBook *book, const struct s_MarketDepthIncrementalUpdateCompact *msg);
+int DTCOrderBook_apply_full_update10(struct DTCOrderBook *book, const struct s_MarketDepthFullUpdate10 *msg);
+int DTCOrderBook_apply_full_update20(struct DTCOrderBook *book, const struct s_MarketDepthFullUpdate20 *msg);
+
+/* Writes the top levels as a complete message, unused levels are zero */
+void DTCOrderBook_to_full_update10(const struct DTCOrderBook *book, struct s_MarketDepthFullUpdate10 *msg);
+void DTCOrderBook_to_full_update20(const struct DTCOrderBook *book, struct s_MarketDepthFullUpdate20 *msg);
+
+void DTCOrderBookSet_init(struct DTCOrderBookSet *set, struct DTCOrderBook *books, uint32_t capacity);
+
+/* Returns the book for symbol_id, creating it if create is set and the pool has room */
+struct DTCOrderBook *DTCOrderBookSet_get(struct DTCOrderBookSet *set, uint16_t symbol_id, int create);
+
+/*
+ * Applies any market depth message to the book of its MarketDataSymbolID,
+ * creating it as needed. A FundamentalDataResponse sets the book's tick size.
+ */
+int DTCOrderBookSet_apply(struct DTCOrderBookSet *set, const struct DTCMessageHeader *msg);
+
+/*
+ * Sets the tick size of symbol_id's book from a SecurityDefinitionResponse,
+ * which names the symbol but not its MarketDataSymbolID, creating the book
+ * as needed.
+ */
+int DTCOrderBookSet_apply_security_definition(struct DTCOrderBookSet *set, uint16_t symbol_id,
+                                              const struct s_SecurityDefinitionResponse *msg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DTC_ORDER_BOOK_H__ */
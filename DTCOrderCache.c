@@ -0,0 +1,407 @@
+#include "DTCOrderCache.h"
+
+#include <errno.h>
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char empty_key[ORDER_ID_LENGTH];
+
+static void make_key(char key[ORDER_ID_LENGTH], const char *id)
+{
+    size_t i;
+
+    for (i = 0; i < ORDER_ID_LENGTH && id[i] != '\0'; i++)
+        key[i] = id[i];
+    for (; i < ORDER_ID_LENGTH; i++)
+        key[i] = '\0';
+}
+
+static uint32_t hash_key(const char key[ORDER_ID_LENGTH])
+{
+    uint64_t hash = 0;
+    size_t i;
+
+    for (i = 0; i < ORDER_ID_LENGTH; i += sizeof(uint64_t)) {
+        uint64_t word;
+
+        memcpy(&word, key + i, sizeof(word));
+        hash = (hash ^ word) * UINT64_C(0x9E3779B97F4A7C15);
+        hash ^= hash >> 32;
+    }
+    return (uint32_t)hash;
+}
+
+static const char *record_key(const struct DTCOrder *order, int client)
+{
+    return client ? order->ClientOrderID : order->ServerOrderID;
+}
+
+/* Position of key in the index, or -1 */
+static int64_t index_find(const struct DTCOrderCache *cache, const struct DTCOrderIndexEntry *index, int client,
+                          const char key[ORDER_ID_LENGTH], uint32_t hash)
+{
+    uint32_t position = hash & cache->IndexMask;
+
+    while (index[position].Order != 0) {
+        if (index[position].Hash == hash
+                && memcmp(record_key(&cache->Orders[index[position].Order - 1], client), key, ORDER_ID_LENGTH) == 0)
+            return position;
+        position = (position + 1) & cache->IndexMask;
+    }
+    return -1;
+}
+
+static void index_insert(const struct DTCOrderCache *cache, struct DTCOrderIndexEntry *index, uint32_t hash, uint32_t order)
+{
+    uint32_t position = hash & cache->IndexMask;
+
+    while (index[position].Order != 0)
+        position = (position + 1) & cache->IndexMask;
+
+    index[position].Hash = hash;
+    index[position].Order = order;
+}
+
+/* Removes the entry at position and moves later entries of its probe run back into the gap */
+static void index_erase(const struct DTCOrderCache *cache, struct DTCOrderIndexEntry *index, uint32_t position)
+{
+    uint32_t next = position;
+
+    for (;;) {
+        uint32_t home;
+
+        next = (next + 1) & cache->IndexMask;
+        if (index[next].Order == 0)
+            break;
+
+        /* An entry may only move back if the gap lies between its home slot and where it is now */
+        home = index[next].Hash & cache->IndexMask;
+        if (((next - home) & cache->IndexMask) >= ((next - position) & cache->IndexMask)) {
+            index[position] = index[next];
+            position = next;
+        }
+    }
+    index[position].Order = 0;
+}
+
+static uint32_t record_number(const struct DTCOrderCache *cache, const struct DTCOrder *order)
+{
+    return (uint32_t)(order - cache->Orders) + 1;
+}
+
+static void unindex(struct DTCOrderCache *cache, struct DTCOrder *order, int client)
+{
+    struct DTCOrderIndexEntry *index = client ? cache->ByClientID : cache->ByServerID;
+    const char *key = record_key(order, client);
+    int64_t position;
+
+    if (key[0] == '\0')
+        return;
+
+    position = index_find(cache, index, client, key, hash_key(key));
+    if (position >= 0)
+        index_erase(cache, index, (uint32_t)position);
+}
+
+/* Moves order to a new key, which no other order may have */
+static void rekey(struct DTCOrderCache *cache, struct DTCOrder *order, int client, const char key[ORDER_ID_LENGTH])
+{
+    char *field = client ? order->ClientOrderID : order->ServerOrderID;
+
+    unindex(cache, order, client);
+    memcpy(field, key, ORDER_ID_LENGTH);
+    if (key[0] != '\0')
+        index_insert(cache, client ? cache->ByClientID : cache->ByServerID, hash_key(key), record_number(cache, order));
+}
+
+static struct DTCOrder *find(const struct DTCOrderCache *cache, int client, const char key[ORDER_ID_LENGTH])
+{
+    const struct DTCOrderIndexEntry *index = client ? cache->ByClientID : cache->ByServerID;
+    int64_t position;
+
+    if (key[0] == '\0')
+        return NULL;
+
+    position = index_find(cache, index, client, key, hash_key(key));
+    return position >= 0 ? &cache->Orders[index[position].Order - 1] : NULL;
+}
+
+static struct DTCOrder *allocate(struct DTCOrderCache *cache)
+{
+    struct DTCOrder *order;
+
+    if (cache->FreeList != 0) {
+        order = &cache->Orders[cache->FreeList - 1];
+        cache->FreeList = order->NextFree;
+    } else if (cache->Used < cache->Capacity) {
+        order = &cache->Orders[cache->Used++];
+    } else {
+        return NULL;
+    }
+
+    memset(order, 0, sizeof(struct DTCOrder));
+    order->InUse = 1;
+    cache->Count++;
+    return order;
+}
+
+int DTCOrderCache_init(struct DTCOrderCache *cache, uint32_t capacity)
+{
+    uint32_t size = 16;
+
+    memset(cache, 0, sizeof(struct DTCOrderCache));
+    if (capacity == 0 || capacity > (UINT32_MAX >> 2)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    while (size < 2 * capacity)
+        size <<= 1;
+
+    cache->Orders = (struct DTCOrder *)malloc((size_t)capacity * sizeof(struct DTCOrder));
+    cache->ByServerID = (struct DTCOrderIndexEntry *)calloc(size, sizeof(struct DTCOrderIndexEntry));
+    cache->ByClientID = (struct DTCOrderIndexEntry *)calloc(size, sizeof(struct DTCOrderIndexEntry));
+    if (cache->Orders == NULL || cache->ByServerID == NULL || cache->ByClientID == NULL) {
+        DTCOrderCache_free(cache);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    cache->Capacity = capacity;
+    cache->IndexMask = size - 1;
+    return 0;
+}
+
+void DTCOrderCache_free(struct DTCOrderCache *cache)
+{
+    free(cache->Orders);
+    free(cache->ByServerID);
+    free(cache->ByClientID);
+    memset(cache, 0, sizeof(struct DTCOrderCache));
+}
+
+void DTCOrderCache_clear(struct DTCOrderCache *cache)
+{
+    memset(cache->ByServerID, 0, ((size_t)cache->IndexMask + 1) * sizeof(struct DTCOrderIndexEntry));
+    memset(cache->ByClientID, 0, ((size_t)cache->IndexMask + 1) * sizeof(struct DTCOrderIndexEntry));
+    cache->Count = 0;
+    cache->Used = 0;
+    cache->FreeList = 0;
+}
+
+struct DTCOrder *DTCOrderCache_find_server(const struct DTCOrderCache *cache, const char *server_order_id)
+{
+    char key[ORDER_ID_LENGTH];
+
+    make_key(key, server_order_id);
+    return find(cache, 0, key);
+}
+
+struct DTCOrder *DTCOrderCache_find_client(const struct DTCOrderCache *cache, const char *client_order_id)
+{
+    char key[ORDER_ID_LENGTH];
+
+    make_key(key, client_order_id);
+    return find(cache, 1, key);
+}
+
+void DTCOrderCache_remove(struct DTCOrderCache *cache, struct DTCOrder *order)
+{
+    if (!order->InUse)
+        return;
+
+    unindex(cache, order, 0);
+    unindex(cache, order, 1);
+    order->InUse = 0;
+    order->NextFree = cache->FreeList;
+    cache->FreeList = record_number(cache, order);
+    cache->Count--;
+}
+
+/* Fields of the same size as in the message, only overwritten when set */
+static void copy_field(char *to, const char *from, size_t size)
+{
+    if (from[0] != '\0')
+        memcpy(to, from, size);
+}
+
+/* Reports carry DBL_MAX, 0 or an empty string for fields they do not set */
+static void copy_double(double *to, double from)
+{
+    if (from != DBL_MAX)
+        *to = from;
+}
+
+static void copy_enum(int32_t *to, int32_t from)
+{
+    if (from != 0)
+        *to = from;
+}
+
+static void copy_time(t_DateTime *to, t_DateTime from)
+{
+    if (from != 0)
+        *to = from;
+}
+
+int DTCOrderCache_apply(struct DTCOrderCache *cache, const struct s_OrderUpdateReport *report, struct DTCOrder **order)
+{
+    char server_id[ORDER_ID_LENGTH];
+    char previous_id[ORDER_ID_LENGTH];
+    char client_id[ORDER_ID_LENGTH];
+    struct DTCOrder *current;
+    struct DTCOrder *replaced = NULL;
+    int result = DTC_ORDER_CACHE_UPDATED;
+
+    if (order != NULL)
+        *order = NULL;
+    if (report->NoneOrders)
+        return DTC_ORDER_CACHE_IGNORED;
+
+    make_key(server_id, report->ServerOrderID);
+    make_key(previous_id, report->PreviousServerOrderID);
+    make_key(client_id, report->ClientOrderID);
+    if (server_id[0] == '\0' && client_id[0] == '\0')
+        return DTC_ORDER_CACHE_NO_ID;
+
+    if (previous_id[0] != '\0' && memcmp(previous_id, server_id, ORDER_ID_LENGTH) != 0)
+        replaced = find(cache, 0, previous_id);
+
+    current = find(cache, 0, server_id);
+    if (current == NULL) {
+        current = replaced;
+        replaced = NULL;
+    }
+    if (current == NULL) {
+        current = find(cache, 1, client_id);
+
+        /* A finished order whose ClientOrderID is being reused for a new one */
+        if (current != NULL && current->ServerOrderID[0] != '\0' && DTCOrder_is_finished(current))
+            current = NULL;
+    }
+
+    if (current == NULL) {
+        current = allocate(cache);
+        if (current == NULL)
+            return DTC_ORDER_CACHE_FULL;
+        result = DTC_ORDER_CACHE_ADDED;
+    }
+
+    /* Both ends of a replace chain are known, the update for the new ID arrived first */
+    if (replaced != NULL && replaced != current)
+        DTCOrderCache_remove(cache, replaced);
+
+    if (server_id[0] != '\0' && memcmp(current->ServerOrderID, server_id, ORDER_ID_LENGTH) != 0) {
+        if (current->ServerOrderID[0] != '\0') {
+            memcpy(current->PreviousServerOrderID, current->ServerOrderID, ORDER_ID_LENGTH);
+            current->ReplaceCount++;
+        } else if (previous_id[0] != '\0') {
+            memcpy(current->PreviousServerOrderID, previous_id, ORDER_ID_LENGTH);
+        }
+        rekey(cache, current, 0, server_id);
+    }
+
+    if (client_id[0] != '\0' && memcmp(current->ClientOrderID, client_id, ORDER_ID_LENGTH) != 0) {
+        struct DTCOrder *other = find(cache, 1, client_id);
+
+        /* A replacement order took over the ClientOrderID */
+        if (other != NULL)
+            rekey(cache, other, 1, empty_key);
+        rekey(cache, current, 1, client_id);
+    }
+
+    copy_field(current->ExchangeOrderID, report->ExchangeOrderID, ORDER_ID_LENGTH);
+    copy_field(current->Symbol, report->Symbol, SYMBOL_LENGTH);
+    copy_field(current->Exchange, report->Exchange, EXCHANGE_LENGTH);
+    copy_field(current->TradeAccount, report->TradeAccount, TRADE_ACCOUNT_LENGTH);
+
+    if (report->OrderStatus != ORDER_STATUS_UNSPECIFIED)
+        current->OrderStatus = report->OrderStatus;
+    copy_enum(&current->ExecutionType, report->ExecutionType);
+
+    /* A rejected cancel or replace leaves the order as it was */
+    if (report->ExecutionType != ET_ORDER_CANCEL_REJECT && report->ExecutionType != ET_ORDER_CANCEL_REPLACE_REJECT) {
+        copy_enum(&current->OrderType, report->OrderType);
+        copy_enum(&current->BuySell, report->BuySell);
+        copy_enum(&current->TimeInForce, report->TimeInForce);
+        copy_double(&current->Price1, report->Price1);
+        copy_double(&current->Price2, report->Price2);
+        copy_time(&current->GoodTillDateTimeUnix, report->GoodTillDateTimeUnix);
+        copy_double(&current->OrderQuantity, report->OrderQuantity);
+        copy_double(&current->FilledQuantity, report->FilledQuantity);
+        copy_double(&current->RemainingQuantity, report->RemainingQuantity);
+        copy_double(&current->AverageFillPrice, report->AverageFillPrice);
+    }
+
+    if (report->ExecutionType == ET_FILLED || report->ExecutionType == ET_PARTIAL_FILL) {
+        copy_double(&current->LastFillPrice, report->LastFillPrice);
+        copy_double(&current->LastFillQuantity, report->LastFillQuantity);
+        copy_time(&current->LastFillDateTimeUnix, report->LastFillDateTimeUnix);
+    }
+
+    if (order != NULL)
+        *order = current;
+    return result;
+}
+
+int DTCOrderCache_submit(struct DTCOrderCache *cache, const struct s_SubmitNewSingleOrder *submit, struct DTCOrder **order)
+{
+    char client_id[ORDER_ID_LENGTH];
+    struct DTCOrder *current;
+    struct DTCOrder *other;
+
+    if (order != NULL)
+        *order = NULL;
+
+    make_key(client_id, submit->ClientOrderID);
+    if (client_id[0] == '\0')
+        return DTC_ORDER_CACHE_NO_ID;
+
+    /* As in DTCOrderCache_apply(), a finished order gives up its ClientOrderID for reuse */
+    other = find(cache, 1, client_id);
+    if (other != NULL && !(other->ServerOrderID[0] != '\0' && DTCOrder_is_finished(other)))
+        return DTC_ORDER_CACHE_DUPLICATE;
+
+    current = allocate(cache);
+    if (current == NULL)
+        return DTC_ORDER_CACHE_FULL;
+
+    if (other != NULL)
+        rekey(cache, other, 1, empty_key);
+    rekey(cache, current, 1, client_id);
+    copy_field(current->Symbol, submit->Symbol, SYMBOL_LENGTH);
+    copy_field(current->Exchange, submit->Exchange, EXCHANGE_LENGTH);
+    copy_field(current->TradeAccount, submit->TradeAccount, TRADE_ACCOUNT_LENGTH);
+    current->OrderStatus = ORDER_STATUS_ORDERSENT;
+    current->OrderType = submit->OrderType;
+    current->BuySell = submit->BuySell;
+    current->TimeInForce = submit->TimeInForce;
+    current->Price1 = submit->Price1;
+    current->Price2 = submit->Price2;
+    current->GoodTillDateTimeUnix = submit->GoodTillDateTimeUnix;
+    current->OrderQuantity = submit->OrderQuantity;
+    current->RemainingQuantity = submit->OrderQuantity;
+
+    if (order != NULL)
+        *order = current;
+    return DTC_ORDER_CACHE_ADDED;
+}
+
+struct DTCOrder *DTCOrderCache_next(const struct DTCOrderCache *cache, const struct DTCOrder *order)
+{
+    uint32_t i = order != NULL ? record_number(cache, order) : 0;
+
+    for (; i < cache->Used; i++) {
+        if (cache->Orders[i].InUse)
+            return &cache->Orders[i];
+    }
+    return NULL;
+}
+
+int DTCOrder_is_finished(const struct DTCOrder *order)
+{
+    return order->OrderStatus == ORDER_STATUS_FILLED
+        || order->OrderStatus == ORDER_STATUS_CANCELED
+        || order->OrderStatus == ORDER_STATUS_REJECTED;
+}
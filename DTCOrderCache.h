@@ -0,0 +1,121 @@
+#ifndef __DTC_ORDER_CACHE_H__
+#define __DTC_ORDER_CACHE_H__
+
+/*
+ * Order state rebuilt from OrderUpdateReport messages.
+ *
+ * Order records come from a pool allocated once at init and are found by
+ * ServerOrderID or ClientOrderID through two open addressing hash tables.
+ * Keys are the fixed ORDER_ID_LENGTH byte fields, zero padded after the
+ * first NUL, so hashing and comparing never look for a terminator or
+ * allocate. Removal shifts the following entries back instead of leaving
+ * tombstones, so lookups stay short under heavy order churn.
+ *
+ * An update is matched by ServerOrderID, then by PreviousServerOrderID and
+ * then by ClientOrderID, which covers orders submitted through
+ * DTCOrderCache_submit() before the server assigned an ID. When a
+ * cancel/replace gives the order a new ServerOrderID the record is moved to
+ * the new key and keeps the old one in PreviousServerOrderID. Finished
+ * orders stay in the cache until DTCOrderCache_remove().
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "DTCProtocol.h"
+
+enum DTCOrderCacheResultEnum {
+    DTC_ORDER_CACHE_UPDATED = 0,
+    DTC_ORDER_CACHE_ADDED = 1,
+    DTC_ORDER_CACHE_IGNORED = 2,        /* OrderUpdateReport with NoneOrders set */
+    DTC_ORDER_CACHE_FULL = -1,          /* no free order record */
+    DTC_ORDER_CACHE_NO_ID = -2,         /* neither ServerOrderID nor ClientOrderID set */
+    DTC_ORDER_CACHE_DUPLICATE = -3      /* ClientOrderID in use by an order that is not finished */
+};
+
+struct DTCOrder
+{
+    char ServerOrderID[ORDER_ID_LENGTH];
+    char ClientOrderID[ORDER_ID_LENGTH];
+    char PreviousServerOrderID[ORDER_ID_LENGTH];    /* before the last cancel/replace */
+    char ExchangeOrderID[ORDER_ID_LENGTH];
+    char Symbol[SYMBOL_LENGTH];
+    char Exchange[EXCHANGE_LENGTH];
+    char TradeAccount[TRADE_ACCOUNT_LENGTH];
+    int32_t OrderStatus;        /* OrderStatusEnum */
+    int32_t ExecutionType;      /* ExecutionTypeEnum of the last update */
+    int32_t OrderType;          /* OrderTypeEnum */
+    int32_t BuySell;            /* BuySellEnum */
+    int32_t TimeInForce;        /* TimeInForceEnum */
+    double Price1;
+    double Price2;
+    t_DateTime GoodTillDateTimeUnix;
+    double OrderQuantity;
+    double FilledQuantity;
+    double RemainingQuantity;
+    double AverageFillPrice;
+    double LastFillPrice;
+    double LastFillQuantity;
+    t_DateTime LastFillDateTimeUnix;
+    uint32_t ReplaceCount;      /* completed cancel/replaces */
+
+    /* Pool bookkeeping */
+    uint32_t NextFree;          /* record index + 1, 0 at the end of the free list */
+    uint8_t InUse;
+};
+
+struct DTCOrderIndexEntry
+{
+    uint32_t Hash;
+    uint32_t Order;             /* record index + 1, 0 if empty */
+};
+
+struct DTCOrderCache
+{
+    struct DTCOrder *Orders;
+    uint32_t Capacity;
+    uint32_t Count;
+    uint32_t Used;              /* records ever handed out, the rest were never touched */
+    uint32_t FreeList;          /* record index + 1 */
+    uint32_t IndexMask;         /* index size - 1, at least twice the capacity */
+    struct DTCOrderIndexEntry *ByServerID;
+    struct DTCOrderIndexEntry *ByClientID;
+};
+
+/* Allocates room for capacity orders. Returns 0 or -1 with errno set. */
+int DTCOrderCache_init(struct DTCOrderCache *cache, uint32_t capacity);
+void DTCOrderCache_free(struct DTCOrderCache *cache);
+
+/* Forgets all orders, keeping the memory */
+void DTCOrderCache_clear(struct DTCOrderCache *cache);
+
+/* IDs are ORDER_ID_LENGTH byte fields or shorter NUL terminated strings */
+struct DTCOrder *DTCOrderCache_find_server(const struct DTCOrderCache *cache, const char *server_order_id);
+struct DTCOrder *DTCOrderCache_find_client(const struct DTCOrderCache *cache, const char *client_order_id);
+
+/*
+ * Applies an OrderUpdateReport, adding the order if it is not known yet.
+ * Sets *order, if not NULL, to the order's record or NULL. Returns a
+ * DTCOrderCacheResultEnum value.
+ */
+int DTCOrderCache_apply(struct DTCOrderCache *cache, const struct s_OrderUpdateReport *report, struct DTCOrder **order);
+
+/* Adds an order sent to the server with ORDER_STATUS_ORDERSENT, as DTCOrderCache_apply() */
+int DTCOrderCache_submit(struct DTCOrderCache *cache, const struct s_SubmitNewSingleOrder *submit, struct DTCOrder **order);
+
+void DTCOrderCache_remove(struct DTCOrderCache *cache, struct DTCOrder *order);
+
+/* Iterates over all orders, start with NULL */
+struct DTCOrder *DTCOrderCache_next(const struct DTCOrderCache *cache, const struct DTCOrder *order);
+
+/* Filled, canceled or rejected */
+int DTCOrder_is_finished(const struct DTCOrder *order);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DTC_ORDER_CACHE_H__ */
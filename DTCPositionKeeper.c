@@ -0,0 +1,311 @@
+#include "DTCPositionKeeper.h"
+
+#include <errno.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KEY_LENGTH (TRADE_ACCOUNT_LENGTH + SYMBOL_LENGTH + EXCHANGE_LENGTH)
+
+/* Account, symbol and exchange back to back, each zero padded like the position fields */
+struct position_key
+{
+    char Bytes[KEY_LENGTH];
+};
+
+static void copy_padded(char *to, const char *from, size_t size)
+{
+    size_t i;
+
+    for (i = 0; i < size && from[i] != '\0'; i++)
+        to[i] = from[i];
+    for (; i < size; i++)
+        to[i] = '\0';
+}
+
+static uint32_t make_key(struct position_key *key, const char *trade_account, const char *symbol, const char *exchange)
+{
+    uint64_t hash = 0;
+    size_t i;
+
+    copy_padded(key->Bytes, trade_account, TRADE_ACCOUNT_LENGTH);
+    copy_padded(key->Bytes + TRADE_ACCOUNT_LENGTH, symbol, SYMBOL_LENGTH);
+    copy_padded(key->Bytes + TRADE_ACCOUNT_LENGTH + SYMBOL_LENGTH, exchange, EXCHANGE_LENGTH);
+
+    for (i = 0; i < KEY_LENGTH; i += sizeof(uint64_t)) {
+        uint64_t word;
+
+        memcpy(&word, key->Bytes + i, sizeof(word));
+        hash = (hash ^ word) * UINT64_C(0x9E3779B97F4A7C15);
+        hash ^= hash >> 32;
+    }
+    return (uint32_t)hash;
+}
+
+static int key_matches(const struct DTCPosition *position, const struct position_key *key)
+{
+    return memcmp(position->TradeAccount, key->Bytes, TRADE_ACCOUNT_LENGTH) == 0
+        && memcmp(position->Symbol, key->Bytes + TRADE_ACCOUNT_LENGTH, SYMBOL_LENGTH) == 0
+        && memcmp(position->Exchange, key->Bytes + TRADE_ACCOUNT_LENGTH + SYMBOL_LENGTH, EXCHANGE_LENGTH) == 0;
+}
+
+int DTCPositionKeeper_init(struct DTCPositionKeeper *keeper, uint32_t capacity)
+{
+    uint32_t size = 16;
+
+    memset(keeper, 0, sizeof(struct DTCPositionKeeper));
+    if (capacity == 0 || capacity > (UINT32_MAX >> 2)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    while (size < 2 * capacity)
+        size <<= 1;
+
+    keeper->Positions = (struct DTCPosition *)malloc((size_t)capacity * sizeof(struct DTCPosition));
+    keeper->Index = (struct DTCPositionIndexEntry *)calloc(size, sizeof(struct DTCPositionIndexEntry));
+    if (keeper->Positions == NULL || keeper->Index == NULL) {
+        DTCPositionKeeper_free(keeper);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    keeper->Capacity = capacity;
+    keeper->IndexMask = size - 1;
+    return 0;
+}
+
+void DTCPositionKeeper_free(struct DTCPositionKeeper *keeper)
+{
+    free(keeper->Positions);
+    free(keeper->Index);
+    keeper->Positions = NULL;
+    keeper->Index = NULL;
+    keeper->Capacity = 0;
+    keeper->Count = 0;
+}
+
+static void mark(struct DTCPosition *position)
+{
+    if (position->Bid > 0 && position->Ask > 0)
+        position->MarkPrice = (position->Bid + position->Ask) / 2;
+    else if (position->Bid > 0)
+        position->MarkPrice = position->Bid;
+    else if (position->Ask > 0)
+        position->MarkPrice = position->Ask;
+
+    if (position->MarkPrice != 0 && position->Quantity != 0)
+        position->OpenProfitLoss = (position->MarkPrice - position->AveragePrice) * position->Quantity * position->Multiplier;
+    else
+        position->OpenProfitLoss = 0;
+}
+
+void DTCPositionKeeper_set_symbol_id(struct DTCPositionKeeper *keeper, struct DTCPosition *position, uint16_t symbol_id)
+{
+    uint32_t number = (uint32_t)(position - keeper->Positions) + 1;
+    uint32_t *link;
+
+    if (position->MarketDataSymbolID == symbol_id)
+        return;
+
+    if (position->MarketDataSymbolID != 0) {
+        for (link = &keeper->SymbolHead[position->MarketDataSymbolID]; *link != number;
+                link = &keeper->Positions[*link - 1].NextForSymbol)
+            ;
+        *link = position->NextForSymbol;
+    }
+
+    position->MarketDataSymbolID = symbol_id;
+    position->NextForSymbol = 0;
+    position->Bid = 0;
+    position->Ask = 0;
+    if (symbol_id != 0) {
+        position->NextForSymbol = keeper->SymbolHead[symbol_id];
+        keeper->SymbolHead[symbol_id] = number;
+    }
+}
+
+struct DTCPosition *DTCPositionKeeper_get(struct DTCPositionKeeper *keeper, const char *trade_account,
+                                          const char *symbol, const char *exchange, int create)
+{
+    struct position_key key;
+    struct DTCPosition *position;
+    uint32_t hash = make_key(&key, trade_account, symbol, exchange);
+    uint32_t slot = hash & keeper->IndexMask;
+
+    while (keeper->Index[slot].Position != 0) {
+        position = &keeper->Positions[keeper->Index[slot].Position - 1];
+        if (keeper->Index[slot].Hash == hash && key_matches(position, &key))
+            return position;
+        slot = (slot + 1) & keeper->IndexMask;
+    }
+
+    if (!create || keeper->Count == keeper->Capacity)
+        return NULL;
+
+    position = &keeper->Positions[keeper->Count++];
+    memset(position, 0, sizeof(struct DTCPosition));
+    memcpy(position->TradeAccount, key.Bytes, TRADE_ACCOUNT_LENGTH);
+    memcpy(position->Symbol, key.Bytes + TRADE_ACCOUNT_LENGTH, SYMBOL_LENGTH);
+    memcpy(position->Exchange, key.Bytes + TRADE_ACCOUNT_LENGTH + SYMBOL_LENGTH, EXCHANGE_LENGTH);
+    position->Multiplier = 1;
+
+    keeper->Index[slot].Hash = hash;
+    keeper->Index[slot].Position = keeper->Count;
+
+    if (keeper->ResolveSymbol != NULL)
+        DTCPositionKeeper_set_symbol_id(keeper, position, keeper->ResolveSymbol(keeper->Context, position->Symbol, position->Exchange));
+    return position;
+}
+
+int DTCPositionKeeper_add_fill(struct DTCPositionKeeper *keeper, const char *trade_account, const char *symbol,
+                               const char *exchange, int32_t buy_sell, double price, double quantity, t_DateTime date_time)
+{
+    struct DTCPosition *position;
+    double signed_quantity;
+    double before;
+
+    /* DBL_MAX is an unset price or quantity */
+    if (quantity <= 0 || quantity == DBL_MAX || price == DBL_MAX || (buy_sell != BUY && buy_sell != SELL))
+        return DTC_POSITION_IGNORED;
+
+    position = DTCPositionKeeper_get(keeper, trade_account, symbol, exchange, 1);
+    if (position == NULL)
+        return DTC_POSITION_FULL;
+
+    before = position->Quantity;
+    signed_quantity = buy_sell == BUY ? quantity : -quantity;
+    position->Quantity = before + signed_quantity;
+
+    if (before == 0 || (before > 0) == (signed_quantity > 0)) {
+        /* Opening or adding */
+        position->AveragePrice = (position->AveragePrice * fabs(before) + price * quantity)
+            / fabs(position->Quantity);
+    } else {
+        /* Reducing, possibly through flat to the other side */
+        double closed = quantity < fabs(before) ? quantity : fabs(before);
+
+        position->RealizedProfitLoss += closed * (price - position->AveragePrice) * (before > 0 ? 1 : -1) * position->Multiplier;
+        if (position->Quantity == 0)
+            position->AveragePrice = 0;
+        else if ((position->Quantity > 0) != (before > 0))
+            position->AveragePrice = price;
+    }
+
+    position->FillCount++;
+    if (date_time > position->LastFillDateTime)
+        position->LastFillDateTime = date_time;
+    mark(position);
+    return DTC_POSITION_OK;
+}
+
+int DTCPositionKeeper_apply_position_report(struct DTCPositionKeeper *keeper, const struct s_PositionReport *msg)
+{
+    struct DTCPosition *position;
+
+    if (msg->NonePositions)
+        return DTC_POSITION_IGNORED;
+
+    position = DTCPositionKeeper_get(keeper, msg->TradeAccount, msg->Symbol, msg->Exchange, 1);
+    if (position == NULL)
+        return DTC_POSITION_FULL;
+
+    position->Quantity = msg->PositionQuantity;
+    position->AveragePrice = msg->PositionQuantity != 0 ? msg->AveragePrice : 0;
+    mark(position);
+    return DTC_POSITION_OK;
+}
+
+int DTCPositionKeeper_apply_fill_report(struct DTCPositionKeeper *keeper, const struct s_HistoricalOrderFillReport *msg)
+{
+    if (msg->NoneOrderFills)
+        return DTC_POSITION_IGNORED;
+
+    return DTCPositionKeeper_add_fill(keeper, msg->TradeAccount, msg->Symbol, msg->Exchange, msg->BuySell,
+                                      msg->FillPrice, msg->FillQuantity, msg->FillDateTimeUnix);
+}
+
+int DTCPositionKeeper_apply_order_update(struct DTCPositionKeeper *keeper, const struct s_OrderUpdateReport *msg)
+{
+    if (msg->NoneOrders || (msg->ExecutionType != ET_FILLED && msg->ExecutionType != ET_PARTIAL_FILL))
+        return DTC_POSITION_IGNORED;
+
+    return DTCPositionKeeper_add_fill(keeper, msg->TradeAccount, msg->Symbol, msg->Exchange, msg->BuySell,
+                                      msg->LastFillPrice, msg->LastFillQuantity, msg->LastFillDateTimeUnix);
+}
+
+static void apply_prices(struct DTCPositionKeeper *keeper, uint16_t symbol_id, int has_bid, double bid, int has_ask, double ask)
+{
+    uint32_t number;
+
+    if (symbol_id == 0)
+        return;
+
+    for (number = keeper->SymbolHead[symbol_id]; number != 0; number = keeper->Positions[number - 1].NextForSymbol) {
+        struct DTCPosition *position = &keeper->Positions[number - 1];
+
+        if (has_bid)
+            position->Bid = bid;
+        if (has_ask)
+            position->Ask = ask;
+        mark(position);
+    }
+}
+
+void DTCPositionKeeper_apply_quote(struct DTCPositionKeeper *keeper, const struct s_QuoteIncrementalUpdate *msg)
+{
+    apply_prices(keeper, msg->MarketDataSymbolID, msg->BidPrice != DBL_MAX, msg->BidPrice, msg->AskPrice != DBL_MAX, msg->AskPrice);
+}
+
+void DTCPositionKeeper_apply_quote_compact(struct DTCPositionKeeper *keeper, const struct s_QuoteIncrementalUpdateCompact *msg)
+{
+    apply_prices(keeper, msg->MarketDataSymbolID, msg->BidPrice != FLT_MAX, msg->BidPrice, msg->AskPrice != FLT_MAX, msg->AskPrice);
+}
+
+int DTCPositionKeeper_apply(struct DTCPositionKeeper *keeper, const struct DTCMessageHeader *msg)
+{
+    switch (msg->Type) {
+    case POSITION_REPORT:
+        return DTCPositionKeeper_apply_position_report(keeper, (const struct s_PositionReport *)msg);
+    case HISTORICAL_ORDER_FILL_REPORT:
+        return DTCPositionKeeper_apply_fill_report(keeper, (const struct s_HistoricalOrderFillReport *)msg);
+    case ORDER_UPDATE_REPORT:
+        return DTCPositionKeeper_apply_order_update(keeper, (const struct s_OrderUpdateReport *)msg);
+    case QUOTE_INCREMENTAL_UPDATE:
+        DTCPositionKeeper_apply_quote(keeper, (const struct s_QuoteIncrementalUpdate *)msg);
+        return DTC_POSITION_OK;
+    case QUOTE_INCREMENTAL_UPDATE_COMPACT:
+        DTCPositionKeeper_apply_quote_compact(keeper, (const struct s_QuoteIncrementalUpdateCompact *)msg);
+        return DTC_POSITION_OK;
+    default:
+        return DTC_POSITION_UNHANDLED_TYPE;
+    }
+}
+
+void DTCPositionKeeper_account_totals(const struct DTCPositionKeeper *keeper, const char *trade_account,
+                                      double *realized, double *open)
+{
+    char account[TRADE_ACCOUNT_LENGTH];
+    uint32_t i;
+
+    copy_padded(account, trade_account, TRADE_ACCOUNT_LENGTH);
+    *realized = 0;
+    *open = 0;
+
+    for (i = 0; i < keeper->Count; i++) {
+        const struct DTCPosition *position = &keeper->Positions[i];
+
+        if (memcmp(position->TradeAccount, account, TRADE_ACCOUNT_LENGTH) == 0) {
+            *realized += position->RealizedProfitLoss;
+            *open += position->OpenProfitLoss;
+        }
+    }
+}
+
+struct DTCPosition *DTCPositionKeeper_next(const struct DTCPositionKeeper *keeper, const struct DTCPosition *position)
+{
+    uint32_t i = position != NULL ? (uint32_t)(position - keeper->Positions) + 1 : 0;
+
+    return i < keeper->Count ? &keeper->Positions[i] : NULL;
+}
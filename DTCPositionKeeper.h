@@ -0,0 +1,124 @@
+#ifndef __DTC_POSITION_KEEPER_H__
+#define __DTC_POSITION_KEEPER_H__
+
+/*
+ * Positions and profit/loss per TradeAccount and symbol, kept up to date
+ * from PositionReport, HistoricalOrderFillReport and the fills in
+ * OrderUpdateReport messages.
+ *
+ * A fill changes only its own position: the quantity, the average price of
+ * the open quantity and the realized profit/loss of the quantity it closed.
+ * A PositionReport from the server replaces quantity and average price.
+ * Positions are pooled and found through an open addressing hash table on
+ * the account, symbol and exchange.
+ *
+ * Fills are not matched on UniqueFillExecutionID, so the caller must pass
+ * each fill once: a period covered by HistoricalOrderFillReport replies must
+ * not also be fed from live OrderUpdateReport fills, or the reverse.
+ *
+ * Positions are marked to the middle of the quote of their
+ * MarketDataSymbolID, or the one side quoted. Each symbol ID heads a list
+ * of the positions on it, so a quote update touches only those. Symbol IDs
+ * are assigned by the client; ResolveSymbol, if set, is asked for the ID of
+ * each new position, or it can be set with DTCPositionKeeper_set_symbol_id().
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "DTCProtocol.h"
+
+enum DTCPositionResultEnum {
+    DTC_POSITION_OK = 0,
+    DTC_POSITION_IGNORED = 1,           /* no position or fill in the message */
+    DTC_POSITION_FULL = -1,             /* no free position record */
+    DTC_POSITION_UNHANDLED_TYPE = -2
+};
+
+/* Returns the MarketDataSymbolID to mark a symbol with, 0 for none */
+typedef uint16_t (*DTCSymbolResolver)(void *context, const char *symbol, const char *exchange);
+
+struct DTCPosition
+{
+    char TradeAccount[TRADE_ACCOUNT_LENGTH];
+    char Symbol[SYMBOL_LENGTH];
+    char Exchange[EXCHANGE_LENGTH];
+    uint16_t MarketDataSymbolID;        /* 0 if not marked to market */
+
+    double Quantity;                    /* negative when short */
+    double AveragePrice;                /* of the open quantity */
+    double RealizedProfitLoss;
+    double Multiplier;                  /* currency per point and unit, 1 unless set */
+    uint32_t FillCount;
+    t_DateTime LastFillDateTime;
+
+    double Bid;                         /* last quote, 0 until quoted */
+    double Ask;
+    double MarkPrice;
+    double OpenProfitLoss;              /* at MarkPrice */
+
+    uint32_t NextForSymbol;             /* position index + 1 of the next one on the same symbol ID */
+};
+
+struct DTCPositionIndexEntry
+{
+    uint32_t Hash;
+    uint32_t Position;                  /* position index + 1, 0 if empty */
+};
+
+struct DTCPositionKeeper
+{
+    struct DTCPosition *Positions;
+    uint32_t Capacity;
+    uint32_t Count;
+    uint32_t IndexMask;
+    struct DTCPositionIndexEntry *Index;
+    DTCSymbolResolver ResolveSymbol;    /* may be NULL */
+    void *Context;
+    uint32_t SymbolHead[DTC_SYMBOL_ID_COUNT];   /* first position index + 1 on each symbol ID */
+};
+
+/* Allocates room for capacity positions. Returns 0 or -1 with errno set. */
+int DTCPositionKeeper_init(struct DTCPositionKeeper *keeper, uint32_t capacity);
+void DTCPositionKeeper_free(struct DTCPositionKeeper *keeper);
+
+/* Returns the position, creating a flat one if create is set, or NULL */
+struct DTCPosition *DTCPositionKeeper_get(struct DTCPositionKeeper *keeper, const char *trade_account,
+                                          const char *symbol, const char *exchange, int create);
+
+/* Marks position with the quotes of symbol_id from now on, 0 to stop */
+void DTCPositionKeeper_set_symbol_id(struct DTCPositionKeeper *keeper, struct DTCPosition *position, uint16_t symbol_id);
+
+/* Adds a fill of quantity at price, buy_sell is a BuySellEnum value.
+ * Returns DTC_POSITION_IGNORED if price or quantity is unset (DBL_MAX). */
+int DTCPositionKeeper_add_fill(struct DTCPositionKeeper *keeper, const char *trade_account, const char *symbol,
+                               const char *exchange, int32_t buy_sell, double price, double quantity, t_DateTime date_time);
+
+int DTCPositionKeeper_apply_position_report(struct DTCPositionKeeper *keeper, const struct s_PositionReport *msg);
+int DTCPositionKeeper_apply_fill_report(struct DTCPositionKeeper *keeper, const struct s_HistoricalOrderFillReport *msg);
+
+/* Only ET_FILLED and ET_PARTIAL_FILL reports carry a fill */
+int DTCPositionKeeper_apply_order_update(struct DTCPositionKeeper *keeper, const struct s_OrderUpdateReport *msg);
+
+/* Quote prices still at the DBL_MAX/FLT_MAX unset value leave that side unchanged */
+void DTCPositionKeeper_apply_quote(struct DTCPositionKeeper *keeper, const struct s_QuoteIncrementalUpdate *msg);
+void DTCPositionKeeper_apply_quote_compact(struct DTCPositionKeeper *keeper, const struct s_QuoteIncrementalUpdateCompact *msg);
+
+/* Applies any of the messages above. Returns a DTCPositionResultEnum value. */
+int DTCPositionKeeper_apply(struct DTCPositionKeeper *keeper, const struct DTCMessageHeader *msg);
+
+/* Sums the realized and open profit/loss of an account's positions */
+void DTCPositionKeeper_account_totals(const struct DTCPositionKeeper *keeper, const char *trade_account,
+                                      double *realized, double *open);
+
+/* Iterates over all positions, start with NULL */
+struct DTCPosition *DTCPositionKeeper_next(const struct DTCPositionKeeper *keeper, const struct DTCPosition *position);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DTC_POSITION_KEEPER_H__ */
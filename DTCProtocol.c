@@ -1,6 +1,8 @@
 #include "DTCProtocol.h"
 
-#include <assert.h>
+#include <float.h>
+#include <stddef.h>
+#include <string.h>
 
 void LogonRequest_init(struct s_LogonRequest *msg)
 {
@@ -86,11 +88,11 @@ void MarketDataSnapshot_init(struct s_MarketDataSnapshot *msg)
     msg->Size = sizeof(struct s_MarketDataSnapshot);
 }
 
-void s_FundamentalDataRequest(s_FundamentalDataRequest *msg)
+void FundamentalDataRequest_init(struct s_FundamentalDataRequest *msg)
 {
-    memset(msg, 0,sizeof(struct s_FundamentalDataRequest));
-    msg->Type=FUNDAMENTAL_DATA_REQUEST;
-    msg->Size=sizeof(struct s_FundamentalDataRequest);
+    memset(msg, 0, sizeof(struct s_FundamentalDataRequest));
+    msg->Type = FUNDAMENTAL_DATA_REQUEST;
+    msg->Size = sizeof(struct s_FundamentalDataRequest);
 }
 
 void FundamentalDataResponse_init(struct s_FundamentalDataResponse *msg)
@@ -367,11 +369,11 @@ void SymbolsForUnderlyingRequest_init(struct s_SymbolsForUnderlyingRequest *msg)
     msg->Size = sizeof(struct s_SymbolsForUnderlyingRequest);
 }
 
-void SymbolSearchByDescriptionRequest(s_SymbolSearchByDescriptionRequest *msg)
+void SymbolSearchByDescriptionRequest_init(struct s_SymbolSearchByDescriptionRequest *msg)
 {
     memset(msg, 0, sizeof(struct s_SymbolSearchByDescriptionRequest));
-    msg->Type=SYMBOL_SEARCH_BY_DESCRIPTION;
-    msg->Size=sizeof(struct s_SymbolSearchByDescriptionRequest);
+    msg->Type = SYMBOL_SEARCH_BY_DESCRIPTION;
+    msg->Size = sizeof(struct s_SymbolSearchByDescriptionRequest);
 }
 
 void SecurityDefinitionForSymbolRequest_init(struct s_SecurityDefinitionForSymbolRequest *msg)
@@ -445,217 +447,124 @@ void HistoricalPriceDataTickRecordResponse_init(struct s_HistoricalPriceDataTick
     msg->Size = sizeof(struct s_HistoricalPriceDataTickRecordResponse);
 }
 
+#define MESSAGE_DESCRIPTOR(type, name, direction) \
+    [type] = { type, sizeof(struct s_##name), direction, #type },
+
+static const struct DTCMessageDescriptor message_descriptors[DTC_MESSAGE_TYPE_COUNT] = {
+    DTC_MESSAGE_LIST(MESSAGE_DESCRIPTOR)
+};
+
+#define MESSAGE_SIZE(type, name, direction) [type] = sizeof(struct s_##name),
+#define MESSAGE_DIRECTION(type, name, direction) [type] = direction,
+
+/* Compact copies of the size and direction columns for the per-frame lookups */
+static const uint16_t message_sizes[DTC_MESSAGE_TYPE_COUNT] = {
+    DTC_MESSAGE_LIST(MESSAGE_SIZE)
+};
+
+static const uint8_t message_directions[DTC_MESSAGE_TYPE_COUNT] = {
+    DTC_MESSAGE_LIST(MESSAGE_DIRECTION)
+};
+
+static int message_size_for_direction(uint16_t msg_type, int direction)
+{
+    if (msg_type >= DTC_MESSAGE_TYPE_COUNT)
+        return 0;
+
+    /* Mask instead of branching on the direction bit */
+    return message_sizes[msg_type] & -(int)((message_directions[msg_type] & direction) != 0);
+}
+
 int get_request_message_size(uint16_t msg_type)
 {
-    int msg_size;
-
-    switch (msg_type) {
-    case LOGON_REQUEST:
-        msg_size = sizeof(s_LogonRequest);
-        break;
-    case LOGOFF_REQUEST:
-        msg_size = sizeof(s_LogoffRequest);
-        break;
-    case HEARTBEAT:
-        msg_size = sizeof(s_Heartbeat);
-        break;
-    case MARKET_DATA_REQUEST:
-        msg_size = sizeof(s_MarketDataRequest);
-        break;
-    case MARKET_DEPTH_REQUEST:
-        msg_size = sizeof(s_MarketDepthRequest);
-        break;
-    case FUNDAMENTAL_DATA_REQUEST:
-        msg_size = sizeof(s_FundamentalDataRequest);
-        break;
-    case SUBMIT_NEW_SINGLE_ORDER:
-        msg_size = sizeof(s_SubmitNewSingleOrder);
-        break;
-    case SUBMIT_NEW_OCO_ORDER:
-        msg_size = sizeof(s_SubmitNewOCOOrder);
-        break;
-    case CANCEL_REPLACE_ORDER:
-        msg_size = sizeof(s_CancelReplaceOrder);
-        break;
-    case CANCEL_ORDER:
-        msg_size = sizeof(s_CancelOrder);
-        break;
-    case OPEN_ORDERS_REQUEST:
-        msg_size = sizeof(s_OpenOrdersRequest);
-        break;
-    case HISTORICAL_ORDER_FILLS_REQUEST:
-        msg_size = sizeof(s_HistoricalOrderFillsRequest);
-        break;
-    case CURRENT_POSITIONS_REQUEST:
-        msg_size = sizeof(s_CurrentPositionsRequest);
-        break;
-    case ACCOUNTS_REQUEST:
-        msg_size = sizeof(s_AccountsRequest);
-        break;
-    case EXCHANGE_LIST_REQUEST:
-        msg_size = sizeof(s_ExchangeListRequest);
-        break;
-    case SYMBOLS_FOR_EXCHANGE_REQUEST:
-        msg_size = sizeof(s_SymbolsForExchangeRequest);
-        break;
-    case UNDERLYING_SYMBOLS_FOR_EXCHANGE_REQUEST:
-        msg_size = sizeof(s_UnderlyingSymbolsForExchangeRequest);
-        break;
-    case SYMBOLS_FOR_UNDERLYING_REQUEST:
-        msg_size = sizeof(s_SymbolsForUnderlyingRequest);
-        break;
-    case SECURITY_DEFINITION_FOR_SYMBOL_REQUEST:
-        msg_size = sizeof(s_SecurityDefinitionForSymbolRequest);
-        break;
-    case SYMBOL_SEARCH_BY_DESCRIPTION:
-        msg_size = sizeof(s_SymbolSearchByDescriptionRequest);
-        break;
-    case HISTORICAL_PRICE_DATA_REQUEST:
-        msg_size = sizeof(s_HistoricalPriceDataRequest);
-        break;
-    default:
-        msg_size = 0;
-        assert(msg_size != 0);
-        break;
-    }
-    return msg_size;
+    return message_size_for_direction(msg_type, DTC_CLIENT_TO_SERVER);
 }
 
 int get_respone_message_size(uint16_t msg_type)
 {
-    int msg_size;
-
-    switch(msg_type) {
-    // Authentication and connection monitoring
-    case LOGON_RESPONSE:
-        msg_size = sizeof(s_LogonResponse);
-        break;
-    case HEARTBEAT:
-        msg_size = sizeof(s_Heartbeat);
-        break;
-    case DISCONNECT_FROM_SERVER_NO_RECONNECT:
-        msg_size = sizeof(s_DisconnectFromServer);
-        break;
-    // Market data
-    case MARKET_DATA_FEED_STATUS:
-        msg_size = sizeof(s_MarketDataFeedStatus);
-        break;
-    case MARKET_DATA_REJECT:
-        msg_size = sizeof(s_MarketDataReject);
-        break;
-    case MARKET_DATA_SNAPSHOT:
-        msg_size = sizeof(s_MarketDataSnapshot);
-        break;
-    case MARKET_DEPTH_FULL_UPDATE_20:
-        msg_size = sizeof(s_MarketDepthFullUpdate20);
-        break;
-    case MARKET_DEPTH_INCREMENTAL_UPDATE:
-        msg_size = sizeof(s_MarketDepthIncrementalUpdate);
-        break;
-    case TRADE_INCREMENTAL_UPDATE:
-        msg_size = sizeof(s_TradeIncrementalUpdate);
-        break;
-    case QUOTE_INCREMENTAL_UPDATE:
-        msg_size = sizeof(s_QuoteIncrementalUpdate);
-        break;
-    case FUNDAMENTAL_DATA_RESPONSE:
-        msg_size = sizeof(s_FundamentalDataResponse);
-        break;
-    case TRADE_INCREMENTAL_UPDATE_COMPACT:
-        msg_size = sizeof(s_TradeIncrementalUpdateCompact);
-        break;
-    case DAILY_VOLUME_INCREMENTAL_UPDATE:
-        msg_size = sizeof(s_DailyVolumeIncrementalUpdate);
-        break;
-    case DAILY_HIGH_INCREMENTAL_UPDATE:
-        msg_size = sizeof(s_DailyHighIncrementalUpdate);
-        break;
-    case DAILY_LOW_INCREMENTAL_UPDATE:
-        msg_size = sizeof(s_DailyLowIncrementalUpdate);
-        break;
-    case MARKET_DATA_FEED_SYMBOL_STATUS:
-        msg_size = sizeof(s_MarketDataFeedSymbolStatus);
-        break;
-    case QUOTE_INCREMENTAL_UPDATE_COMPACT:
-        msg_size = sizeof(s_QuoteIncrementalUpdateCompact);
-        break;
-    case MARKET_DEPTH_INCREMENTAL_UPDATE_COMPACT:
-        msg_size = sizeof(s_MarketDepthIncrementalUpdateCompact);
-        break;
-    case SETTLEMENT_INCREMENTAL_UPDATE:
-        msg_size = sizeof(s_SettlementIncrementalUpdate);
-        break;
-    case DAILY_OPEN_INCREMENTAL_UPDATE:
-        msg_size = sizeof(s_DailyOpenIncrementalUpdate);
-        break;
-    case MARKET_DEPTH_REJECT:
-        msg_size = sizeof(s_MarketDepthReject);
-        break;
-    case MARKET_DEPTH_SNAPSHOT_LEVEL:
-        msg_size = sizeof(s_MarketDepthSnapshotLevel);
-        break;
-    case MARKET_DEPTH_FULL_UPDATE_10:
-        msg_size = sizeof(s_MarketDepthFullUpdate10);
-        break;
-    case OPEN_INTEREST_INCREMENTAL_UPDATE:
-        msg_size = sizeof(s_OpenInterestIncrementalUpdate);
-        break;
-    // Trading related
-    case ORDER_UPDATE_REPORT:
-        msg_size = sizeof(s_OrderUpdateReport);
-        break;
-    case OPEN_ORDERS_REQUEST_REJECT:
-        msg_size = sizeof(s_OpenOrdersRequestReject);
-        break;
-    case HISTORICAL_ORDER_FILL_REPORT:
-        msg_size = sizeof(s_HistoricalOrderFillReport);
-        break;
-    case POSITION_REPORT:
-        msg_size = sizeof(s_PositionReport);
-        break;
-    case CURRENT_POSITIONS_REQUEST_REJECT:
-        msg_size = sizeof(s_CurrentPositionsRequestReject);
-        break;
-    // Account list
-    case ACCOUNT_LIST_RESPONSE:
-        msg_size = sizeof(s_AccountListResponse);
-        break;
-    // Symbol discovery and security definitions
-    case EXCHANGE_LIST_RESPONSE:
-        msg_size = sizeof(s_ExchangeListResponse);
-        break;
-    case SECURITY_DEFINITION_RESPONSE:
-        msg_size = sizeof(s_SecurityDefinitionResponse);
-        break;
-    // Account balance
-    case ACCOUNT_BALANCE_UPDATE:
-        msg_size = sizeof(s_AccountBalanceUpdate);
-        break;
-    // Logging
-    case USER_MESSAGE:
-        msg_size = sizeof(s_UserMessage);
-        break;
-    case GENERAL_LOG_MESSAGE:
-        msg_size = sizeof(s_GeneralLogMessage);
-        break;
-    // Historical price data
-    case HISTORICAL_PRICE_DATA_HEADER_RESPONSE:
-        msg_size = sizeof(s_HistoricalPriceDataHeaderResponse);
-        break;
-    case HISTORICAL_PRICE_DATA_REJECT:
-        msg_size = sizeof(s_HistoricalPriceDataReject);
-        break;
-    case HISTORICAL_PRICE_DATA_RECORD_RESPONSE:
-        msg_size = sizeof(s_HistoricalPriceDataRecordResponse);
-        break;
-    case HISTORICAL_PRICE_DATA_TICK_RECORD_RESPONSE:
-        msg_size = sizeof(s_HistoricalPriceDataTickRecordResponse);
-        break;
-    default:
-        msg_size = 0;
-        assert(msg_size != 0);
-        break;
-    }
-
-    return msg_size;
+    return message_size_for_direction(msg_type, DTC_SERVER_TO_CLIENT);
+}
+
+const struct DTCMessageDescriptor *get_message_descriptor(uint16_t msg_type)
+{
+    if (msg_type >= DTC_MESSAGE_TYPE_COUNT || message_sizes[msg_type] == 0)
+        return NULL;
+
+    return &message_descriptors[msg_type];
+}
+
+int validate_message(const struct DTCMessageHeader *msg, int direction)
+{
+    uint16_t msg_type = msg->Type;
+
+    if (msg_type >= DTC_MESSAGE_TYPE_COUNT || message_sizes[msg_type] == 0)
+        return DTC_MESSAGE_UNKNOWN_TYPE;
+
+    if ((message_directions[msg_type] & direction) == 0)
+        return DTC_MESSAGE_WRONG_DIRECTION;
+
+    if (msg->Size < message_sizes[msg_type])
+        return DTC_MESSAGE_TRUNCATED;
+
+    return DTC_MESSAGE_VALID;
+}
+
+#define SYMBOL_ID_OFFSET(type, name) [type] = offsetof(struct s_##name, MarketDataSymbolID),
+
+/* Offset of MarketDataSymbolID in the message types that carry one, else 0 */
+static const uint16_t symbol_id_offsets[DTC_MESSAGE_TYPE_COUNT] = {
+    SYMBOL_ID_OFFSET(MARKET_DATA_FEED_SYMBOL_STATUS, MarketDataFeedSymbolStatus)
+    SYMBOL_ID_OFFSET(MARKET_DATA_REQUEST, MarketDataRequest)
+    SYMBOL_ID_OFFSET(MARKET_DEPTH_REQUEST, MarketDepthRequest)
+    SYMBOL_ID_OFFSET(MARKET_DATA_REJECT, MarketDataReject)
+    SYMBOL_ID_OFFSET(MARKET_DATA_SNAPSHOT, MarketDataSnapshot)
+    SYMBOL_ID_OFFSET(FUNDAMENTAL_DATA_REQUEST, FundamentalDataRequest)
+    SYMBOL_ID_OFFSET(FUNDAMENTAL_DATA_RESPONSE, FundamentalDataResponse)
+    SYMBOL_ID_OFFSET(MARKET_DEPTH_FULL_UPDATE_20, MarketDepthFullUpdate20)
+    SYMBOL_ID_OFFSET(MARKET_DEPTH_FULL_UPDATE_10, MarketDepthFullUpdate10)
+    SYMBOL_ID_OFFSET(MARKET_DEPTH_SNAPSHOT_LEVEL, MarketDepthSnapshotLevel)
+    SYMBOL_ID_OFFSET(MARKET_DEPTH_INCREMENTAL_UPDATE, MarketDepthIncrementalUpdate)
+    SYMBOL_ID_OFFSET(MARKET_DEPTH_INCREMENTAL_UPDATE_COMPACT, MarketDepthIncrementalUpdateCompact)
+    SYMBOL_ID_OFFSET(SETTLEMENT_INCREMENTAL_UPDATE, SettlementIncrementalUpdate)
+    SYMBOL_ID_OFFSET(DAILY_OPEN_INCREMENTAL_UPDATE, DailyOpenIncrementalUpdate)
+    SYMBOL_ID_OFFSET(MARKET_DEPTH_REJECT, MarketDepthReject)
+    SYMBOL_ID_OFFSET(TRADE_INCREMENTAL_UPDATE, TradeIncrementalUpdate)
+    SYMBOL_ID_OFFSET(QUOTE_INCREMENTAL_UPDATE, QuoteIncrementalUpdate)
+    SYMBOL_ID_OFFSET(QUOTE_INCREMENTAL_UPDATE_COMPACT, QuoteIncrementalUpdateCompact)
+    SYMBOL_ID_OFFSET(TRADE_INCREMENTAL_UPDATE_COMPACT, TradeIncrementalUpdateCompact)
+    SYMBOL_ID_OFFSET(DAILY_VOLUME_INCREMENTAL_UPDATE, DailyVolumeIncrementalUpdate)
+    SYMBOL_ID_OFFSET(OPEN_INTEREST_INCREMENTAL_UPDATE, OpenInterestIncrementalUpdate)
+    SYMBOL_ID_OFFSET(DAILY_HIGH_INCREMENTAL_UPDATE, DailyHighIncrementalUpdate)
+    SYMBOL_ID_OFFSET(DAILY_LOW_INCREMENTAL_UPDATE, DailyLowIncrementalUpdate)
+};
+
+int get_market_data_symbol_id(const struct DTCMessageHeader *msg)
+{
+    uint16_t offset;
+    uint16_t symbol_id;
+
+    if (msg->Type >= DTC_MESSAGE_TYPE_COUNT)
+        return -1;
+
+    offset = symbol_id_offsets[msg->Type];
+    if (offset == 0 || msg->Size < offset + sizeof(symbol_id))
+        return -1;
+
+    memcpy(&symbol_id, (const unsigned char *)msg + offset, sizeof(symbol_id));
+    return symbol_id;
+}
+
+int set_market_data_symbol_id(struct DTCMessageHeader *msg, uint16_t symbol_id)
+{
+    uint16_t offset;
+
+    if (msg->Type >= DTC_MESSAGE_TYPE_COUNT)
+        return -1;
+
+    offset = symbol_id_offsets[msg->Type];
+    if (offset == 0 || msg->Size < offset + sizeof(symbol_id))
+        return -1;
+
+    memcpy((unsigned char *)msg + offset, &symbol_id, sizeof(symbol_id));
+    return 0;
 }
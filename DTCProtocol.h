@@ -415,8 +415,8 @@ struct DTCMessageHeader {
     MESSAGE_HEAD;
 };
 
-#define GET_MESSAGE_TYPE(x) (struct DTCMessageHeader*)(x)->Type
-#define GET_MESSAGE_SIZE(x) (struct DTCMessageHeader*)(x)->Size
+#define GET_MESSAGE_TYPE(x) (((const struct DTCMessageHeader*)(x))->Type)
+#define GET_MESSAGE_SIZE(x) (((const struct DTCMessageHeader*)(x))->Size)
 
 struct s_LogonRequest
 {
@@ -1058,10 +1058,121 @@ struct s_HistoricalPriceDataTickRecordResponse
     char FinalRecord;
 };
 
+/*
+ * Every message type as X(TypeID, Name, Direction), where the message struct is
+ * struct s_<Name> and its initializer is <Name>_init(). Direction is a
+ * DTCMessageDirectionEnum value.
+ */
+#define DTC_MESSAGE_LIST(X) \
+    X(LOGON_REQUEST, LogonRequest, DTC_CLIENT_TO_SERVER) \
+    X(LOGON_RESPONSE, LogonResponse, DTC_SERVER_TO_CLIENT) \
+    X(HEARTBEAT, Heartbeat, DTC_BIDIRECTIONAL) \
+    X(DISCONNECT_FROM_SERVER_NO_RECONNECT, DisconnectFromServer, DTC_SERVER_TO_CLIENT) \
+    X(LOGOFF_REQUEST, LogoffRequest, DTC_CLIENT_TO_SERVER) \
+    X(MARKET_DATA_FEED_STATUS, MarketDataFeedStatus, DTC_SERVER_TO_CLIENT) \
+    X(MARKET_DATA_REQUEST, MarketDataRequest, DTC_CLIENT_TO_SERVER) \
+    X(MARKET_DEPTH_REQUEST, MarketDepthRequest, DTC_CLIENT_TO_SERVER) \
+    X(MARKET_DATA_REJECT, MarketDataReject, DTC_SERVER_TO_CLIENT) \
+    X(MARKET_DATA_SNAPSHOT, MarketDataSnapshot, DTC_SERVER_TO_CLIENT) \
+    X(MARKET_DEPTH_FULL_UPDATE_20, MarketDepthFullUpdate20, DTC_SERVER_TO_CLIENT) \
+    X(MARKET_DEPTH_INCREMENTAL_UPDATE, MarketDepthIncrementalUpdate, DTC_SERVER_TO_CLIENT) \
+    X(TRADE_INCREMENTAL_UPDATE, TradeIncrementalUpdate, DTC_SERVER_TO_CLIENT) \
+    X(QUOTE_INCREMENTAL_UPDATE, QuoteIncrementalUpdate, DTC_SERVER_TO_CLIENT) \
+    X(FUNDAMENTAL_DATA_REQUEST, FundamentalDataRequest, DTC_CLIENT_TO_SERVER) \
+    X(FUNDAMENTAL_DATA_RESPONSE, FundamentalDataResponse, DTC_SERVER_TO_CLIENT) \
+    X(TRADE_INCREMENTAL_UPDATE_COMPACT, TradeIncrementalUpdateCompact, DTC_SERVER_TO_CLIENT) \
+    X(DAILY_VOLUME_INCREMENTAL_UPDATE, DailyVolumeIncrementalUpdate, DTC_SERVER_TO_CLIENT) \
+    X(DAILY_HIGH_INCREMENTAL_UPDATE, DailyHighIncrementalUpdate, DTC_SERVER_TO_CLIENT) \
+    X(DAILY_LOW_INCREMENTAL_UPDATE, DailyLowIncrementalUpdate, DTC_SERVER_TO_CLIENT) \
+    X(MARKET_DATA_FEED_SYMBOL_STATUS, MarketDataFeedSymbolStatus, DTC_SERVER_TO_CLIENT) \
+    X(QUOTE_INCREMENTAL_UPDATE_COMPACT, QuoteIncrementalUpdateCompact, DTC_SERVER_TO_CLIENT) \
+    X(MARKET_DEPTH_INCREMENTAL_UPDATE_COMPACT, MarketDepthIncrementalUpdateCompact, DTC_SERVER_TO_CLIENT) \
+    X(SETTLEMENT_INCREMENTAL_UPDATE, SettlementIncrementalUpdate, DTC_SERVER_TO_CLIENT) \
+    X(DAILY_OPEN_INCREMENTAL_UPDATE, DailyOpenIncrementalUpdate, DTC_SERVER_TO_CLIENT) \
+    X(MARKET_DEPTH_REJECT, MarketDepthReject, DTC_SERVER_TO_CLIENT) \
+    X(MARKET_DEPTH_SNAPSHOT_LEVEL, MarketDepthSnapshotLevel, DTC_SERVER_TO_CLIENT) \
+    X(MARKET_DEPTH_FULL_UPDATE_10, MarketDepthFullUpdate10, DTC_SERVER_TO_CLIENT) \
+    X(OPEN_INTEREST_INCREMENTAL_UPDATE, OpenInterestIncrementalUpdate, DTC_SERVER_TO_CLIENT) \
+    X(SUBMIT_NEW_SINGLE_ORDER, SubmitNewSingleOrder, DTC_CLIENT_TO_SERVER) \
+    X(SUBMIT_NEW_OCO_ORDER, SubmitNewOCOOrder, DTC_CLIENT_TO_SERVER) \
+    X(CANCEL_REPLACE_ORDER, CancelReplaceOrder, DTC_CLIENT_TO_SERVER) \
+    X(CANCEL_ORDER, CancelOrder, DTC_CLIENT_TO_SERVER) \
+    X(OPEN_ORDERS_REQUEST, OpenOrdersRequest, DTC_CLIENT_TO_SERVER) \
+    X(ORDER_UPDATE_REPORT, OrderUpdateReport, DTC_SERVER_TO_CLIENT) \
+    X(OPEN_ORDERS_REQUEST_REJECT, OpenOrdersRequestReject, DTC_SERVER_TO_CLIENT) \
+    X(HISTORICAL_ORDER_FILLS_REQUEST, HistoricalOrderFillsRequest, DTC_CLIENT_TO_SERVER) \
+    X(HISTORICAL_ORDER_FILL_REPORT, HistoricalOrderFillReport, DTC_SERVER_TO_CLIENT) \
+    X(CURRENT_POSITIONS_REQUEST, CurrentPositionsRequest, DTC_CLIENT_TO_SERVER) \
+    X(POSITION_REPORT, PositionReport, DTC_SERVER_TO_CLIENT) \
+    X(CURRENT_POSITIONS_REQUEST_REJECT, CurrentPositionsRequestReject, DTC_SERVER_TO_CLIENT) \
+    X(ACCOUNTS_REQUEST, AccountsRequest, DTC_CLIENT_TO_SERVER) \
+    X(ACCOUNT_LIST_RESPONSE, AccountListResponse, DTC_SERVER_TO_CLIENT) \
+    X(EXCHANGE_LIST_REQUEST, ExchangeListRequest, DTC_CLIENT_TO_SERVER) \
+    X(EXCHANGE_LIST_RESPONSE, ExchangeListResponse, DTC_SERVER_TO_CLIENT) \
+    X(SYMBOLS_FOR_EXCHANGE_REQUEST, SymbolsForExchangeRequest, DTC_CLIENT_TO_SERVER) \
+    X(UNDERLYING_SYMBOLS_FOR_EXCHANGE_REQUEST, UnderlyingSymbolsForExchangeRequest, DTC_CLIENT_TO_SERVER) \
+    X(SYMBOLS_FOR_UNDERLYING_REQUEST, SymbolsForUnderlyingRequest, DTC_CLIENT_TO_SERVER) \
+    X(SECURITY_DEFINITION_FOR_SYMBOL_REQUEST, SecurityDefinitionForSymbolRequest, DTC_CLIENT_TO_SERVER) \
+    X(SECURITY_DEFINITION_RESPONSE, SecurityDefinitionResponse, DTC_SERVER_TO_CLIENT) \
+    X(SYMBOL_SEARCH_BY_DESCRIPTION, SymbolSearchByDescriptionRequest, DTC_CLIENT_TO_SERVER) \
+    X(ACCOUNT_BALANCE_UPDATE, AccountBalanceUpdate, DTC_SERVER_TO_CLIENT) \
+    X(USER_MESSAGE, UserMessage, DTC_SERVER_TO_CLIENT) \
+    X(GENERAL_LOG_MESSAGE, GeneralLogMessage, DTC_SERVER_TO_CLIENT) \
+    X(HISTORICAL_PRICE_DATA_REQUEST, HistoricalPriceDataRequest, DTC_CLIENT_TO_SERVER) \
+    X(HISTORICAL_PRICE_DATA_HEADER_RESPONSE, HistoricalPriceDataHeaderResponse, DTC_SERVER_TO_CLIENT) \
+    X(HISTORICAL_PRICE_DATA_REJECT, HistoricalPriceDataReject, DTC_SERVER_TO_CLIENT) \
+    X(HISTORICAL_PRICE_DATA_RECORD_RESPONSE, HistoricalPriceDataRecordResponse, DTC_SERVER_TO_CLIENT) \
+    X(HISTORICAL_PRICE_DATA_TICK_RECORD_RESPONSE, HistoricalPriceDataTickRecordResponse, DTC_SERVER_TO_CLIENT)
+
+/* One past the highest message type ID */
+#define DTC_MESSAGE_TYPE_COUNT                      805
+
+/* MarketDataSymbolID is 16 bits, so every ID fits in a dense table */
+#define DTC_SYMBOL_ID_COUNT                         65536
+
+enum DTCMessageDirectionEnum {
+    DTC_DIRECTION_UNSET = 0,
+    DTC_CLIENT_TO_SERVER = 1,
+    DTC_SERVER_TO_CLIENT = 2,
+    DTC_BIDIRECTIONAL = 3
+};
+
+enum DTCMessageValidationEnum {
+    DTC_MESSAGE_VALID = 0,
+    DTC_MESSAGE_UNKNOWN_TYPE = -1,
+    DTC_MESSAGE_WRONG_DIRECTION = -2,
+    DTC_MESSAGE_TRUNCATED = -3
+};
+
+struct DTCMessageDescriptor
+{
+    uint16_t Type;
+    uint16_t Size;          /* sizeof the message struct, 0 for unknown types */
+    uint16_t Direction;     /* DTCMessageDirectionEnum */
+    const char *Name;
+};
+
 /* Public API */
+/* Message sizes for a direction, 0 for types not valid in that direction */
 int get_request_message_size(uint16_t msg_type);
 int get_respone_message_size(uint16_t msg_type);
 
+/* Returns NULL for unknown message types */
+const struct DTCMessageDescriptor *get_message_descriptor(uint16_t msg_type);
+
+/*
+ * Checks the header of a received message against the type table. Messages
+ * larger than the known struct are accepted so newer peers can append fields.
+ * Returns a DTCMessageValidationEnum value.
+ */
+int validate_message(const struct DTCMessageHeader *msg, int direction);
+
+/* MarketDataSymbolID of a market data message, or -1 for types without one */
+int get_market_data_symbol_id(const struct DTCMessageHeader *msg);
+
+/* Rewrites MarketDataSymbolID, returns -1 for types without one */
+int set_market_data_symbol_id(struct DTCMessageHeader *msg, uint16_t symbol_id);
+
 void LogonRequest_init(struct s_LogonRequest *msg);
 void LogonResponse_init(struct s_LogonResponse *msg);
 void LogoffRequest_init(struct s_LogoffRequest *msg);
@@ -1073,7 +1184,7 @@ void MarketDataRequest_init(struct s_MarketDataRequest *msg);
 void MarketDepthRequest_init(struct s_MarketDepthRequest *msg);
 void MarketDataReject_init(struct s_MarketDataReject *msg);
 void MarketDataSnapshot_init(struct s_MarketDataSnapshot *msg);
-void s_FundamentalDataRequest(s_FundamentalDataRequest *msg);
+void FundamentalDataRequest_init(struct s_FundamentalDataRequest *msg);
 void FundamentalDataResponse_init(struct s_FundamentalDataResponse *msg);
 void MarketDepthFullUpdate20_init(struct s_MarketDepthFullUpdate20 *msg);
 void MarketDepthFullUpdate10_init(struct s_MarketDepthFullUpdate10 *msg);
@@ -1110,7 +1221,7 @@ void ExchangeListResponse_init(struct s_ExchangeListResponse *msg);
 void SymbolsForExchangeRequest_init(struct s_SymbolsForExchangeRequest *msg);
 void UnderlyingSymbolsForExchangeRequest_init(struct s_UnderlyingSymbolsForExchangeRequest *msg);
 void SymbolsForUnderlyingRequest_init(struct s_SymbolsForUnderlyingRequest *msg);
-void SymbolSearchByDescriptionRequest(s_SymbolSearchByDescriptionRequest *msg);
+void SymbolSearchByDescriptionRequest_init(struct s_SymbolSearchByDescriptionRequest *msg);
 void SecurityDefinitionForSymbolRequest_init(struct s_SecurityDefinitionForSymbolRequest *msg);
 void SecurityDefinitionResponse_init(struct s_SecurityDefinitionResponse *msg);
 void AccountBalanceUpdate_init(struct s_AccountBalanceUpdate *msg);
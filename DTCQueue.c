@@ -0,0 +1,273 @@
+#include "DTCQueue.h"
+
+#include <string.h>
+
+/* Header of the marker that sends the reader back to the start of the buffer */
+static const struct DTCMessageHeader wrap_marker = { sizeof(struct DTCMessageHeader), 0 };
+
+static int is_wrap_marker(const struct DTCMessageHeader *msg)
+{
+    return msg->Type == 0;
+}
+
+void DTCSpscQueue_init(struct DTCSpscQueue *queue, void *buffer, size_t capacity)
+{
+    memset(queue, 0, sizeof(*queue));
+    queue->Buffer = (unsigned char *)buffer;
+    queue->Capacity = capacity;
+}
+
+void *DTCSpscQueue_reserve(struct DTCSpscQueue *queue, size_t size)
+{
+    size_t space = DTC_QUEUE_FRAME_SPACE(size);
+    size_t offset = queue->WriteTail & (queue->Capacity - 1);
+    size_t contiguous = queue->Capacity - offset;
+    size_t total = space > contiguous ? contiguous + space : space;
+
+    if (size < sizeof(struct DTCMessageHeader))
+        return NULL;
+
+    if (queue->WriteTail + total - queue->CachedHead > queue->Capacity) {
+        queue->CachedHead = __atomic_load_n(&queue->Head, __ATOMIC_ACQUIRE);
+        if (queue->WriteTail + total - queue->CachedHead > queue->Capacity)
+            return NULL;
+    }
+
+    if (space > contiguous) {
+        memcpy(queue->Buffer + offset, &wrap_marker, sizeof(wrap_marker));
+        queue->WriteTail += contiguous;
+        return queue->Buffer;
+    }
+    return queue->Buffer + offset;
+}
+
+void DTCSpscQueue_commit(struct DTCSpscQueue *queue, size_t size)
+{
+    queue->WriteTail += DTC_QUEUE_FRAME_SPACE(size);
+}
+
+int DTCSpscQueue_push(struct DTCSpscQueue *queue, const void *msg)
+{
+    const struct DTCMessageHeader *header = (const struct DTCMessageHeader *)msg;
+    void *frame = DTCSpscQueue_reserve(queue, header->Size);
+
+    if (frame == NULL)
+        return -1;
+
+    memcpy(frame, msg, header->Size);
+    DTCSpscQueue_commit(queue, header->Size);
+    return 0;
+}
+
+void DTCSpscQueue_publish(struct DTCSpscQueue *queue)
+{
+    __atomic_store_n(&queue->Tail, queue->WriteTail, __ATOMIC_RELEASE);
+}
+
+const struct DTCMessageHeader *DTCSpscQueue_peek(struct DTCSpscQueue *queue)
+{
+    for (;;) {
+        size_t offset;
+        const struct DTCMessageHeader *msg;
+
+        if (queue->ReadHead == queue->CachedTail) {
+            queue->CachedTail = __atomic_load_n(&queue->Tail, __ATOMIC_ACQUIRE);
+            if (queue->ReadHead == queue->CachedTail)
+                return NULL;
+        }
+
+        offset = queue->ReadHead & (queue->Capacity - 1);
+        msg = (const struct DTCMessageHeader *)(queue->Buffer + offset);
+        if (!is_wrap_marker(msg))
+            return msg;
+
+        queue->ReadHead += queue->Capacity - offset;
+    }
+}
+
+void DTCSpscQueue_pop(struct DTCSpscQueue *queue)
+{
+    const struct DTCMessageHeader *msg =
+        (const struct DTCMessageHeader *)(queue->Buffer + (queue->ReadHead & (queue->Capacity - 1)));
+
+    queue->ReadHead += DTC_QUEUE_FRAME_SPACE(msg->Size);
+}
+
+void DTCSpscQueue_release(struct DTCSpscQueue *queue)
+{
+    __atomic_store_n(&queue->Head, queue->ReadHead, __ATOMIC_RELEASE);
+}
+
+size_t DTCSpscQueue_consume(struct DTCSpscQueue *queue, DTCMessageHandler handler, void *context, size_t max)
+{
+    const struct DTCMessageHeader *msg;
+    size_t count = 0;
+
+    while (count < max && (msg = DTCSpscQueue_peek(queue)) != NULL) {
+        handler(context, msg);
+        DTCSpscQueue_pop(queue);
+        count++;
+    }
+
+    if (count > 0)
+        DTCSpscQueue_release(queue);
+    return count;
+}
+
+void DTCMpscQueue_init(struct DTCMpscQueue *queue, void *buffer, size_t capacity)
+{
+    memset(queue, 0, sizeof(*queue));
+    queue->Buffer = (unsigned char *)buffer;
+    queue->Capacity = capacity;
+    memset(buffer, 0, capacity);
+}
+
+/* The first four bytes of a frame, Size and Type, as one word */
+static uint32_t header_word(const void *msg)
+{
+    uint32_t word;
+
+    memcpy(&word, msg, sizeof(word));
+    return word;
+}
+
+/* Claims space contiguous bytes, writing a wrap marker first if needed */
+static unsigned char *mpsc_claim(struct DTCMpscQueue *queue, size_t space)
+{
+    size_t tail = __atomic_load_n(&queue->Tail, __ATOMIC_RELAXED);
+    size_t offset;
+    size_t contiguous;
+
+    for (;;) {
+        size_t head;
+        size_t total;
+
+        offset = tail & (queue->Capacity - 1);
+        contiguous = queue->Capacity - offset;
+        total = space > contiguous ? contiguous + space : space;
+
+        head = __atomic_load_n(&queue->Head, __ATOMIC_ACQUIRE);
+        if (tail + total - head > queue->Capacity)
+            return NULL;
+
+        if (__atomic_compare_exchange_n(&queue->Tail, &tail, tail + total, 1, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            break;
+    }
+
+    if (space > contiguous) {
+        __atomic_store_n((uint32_t *)(queue->Buffer + offset), header_word(&wrap_marker), __ATOMIC_RELEASE);
+        return queue->Buffer;
+    }
+    return queue->Buffer + offset;
+}
+
+/* Copies the body, then stores the header which makes the frame visible */
+static void mpsc_write(unsigned char *frame, const struct DTCMessageHeader *msg)
+{
+    memcpy(frame + sizeof(*msg), msg + 1, msg->Size - sizeof(*msg));
+    __atomic_store_n((uint32_t *)frame, header_word(msg), __ATOMIC_RELEASE);
+}
+
+static int valid_frame(const struct DTCMessageHeader *msg)
+{
+    return msg->Size >= sizeof(*msg) && !is_wrap_marker(msg);
+}
+
+int DTCMpscQueue_push(struct DTCMpscQueue *queue, const void *msg)
+{
+    const struct DTCMessageHeader *header = (const struct DTCMessageHeader *)msg;
+    unsigned char *frame;
+
+    if (!valid_frame(header))
+        return -1;
+
+    frame = mpsc_claim(queue, DTC_QUEUE_FRAME_SPACE(header->Size));
+    if (frame == NULL)
+        return -1;
+
+    mpsc_write(frame, header);
+    return 0;
+}
+
+int DTCMpscQueue_push_batch(struct DTCMpscQueue *queue, const struct DTCMessageHeader *const *msgs, size_t count)
+{
+    size_t space = 0;
+    unsigned char *frame;
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        if (!valid_frame(msgs[i]))
+            return -1;
+        space += DTC_QUEUE_FRAME_SPACE(msgs[i]->Size);
+    }
+
+    if (space == 0)
+        return 0;
+
+    frame = mpsc_claim(queue, space);
+    if (frame == NULL)
+        return -1;
+
+    for (i = 0; i < count; i++) {
+        mpsc_write(frame, msgs[i]);
+        frame += DTC_QUEUE_FRAME_SPACE(msgs[i]->Size);
+    }
+    return 0;
+}
+
+const struct DTCMessageHeader *DTCMpscQueue_peek(struct DTCMpscQueue *queue)
+{
+    for (;;) {
+        size_t offset = queue->ReadHead & (queue->Capacity - 1);
+        unsigned char *frame = queue->Buffer + offset;
+        const struct DTCMessageHeader *msg = (const struct DTCMessageHeader *)frame;
+
+        /* A frame is committed once its header is non-zero */
+        if (__atomic_load_n((uint32_t *)frame, __ATOMIC_ACQUIRE) == 0)
+            return NULL;
+
+        if (!is_wrap_marker(msg))
+            return msg;
+
+        queue->ReadHead += queue->Capacity - offset;
+    }
+}
+
+void DTCMpscQueue_pop(struct DTCMpscQueue *queue)
+{
+    const struct DTCMessageHeader *msg =
+        (const struct DTCMessageHeader *)(queue->Buffer + (queue->ReadHead & (queue->Capacity - 1)));
+
+    queue->ReadHead += DTC_QUEUE_FRAME_SPACE(msg->Size);
+}
+
+void DTCMpscQueue_release(struct DTCMpscQueue *queue)
+{
+    size_t length = queue->ReadHead - queue->Head;
+    size_t offset = queue->Head & (queue->Capacity - 1);
+    size_t first = queue->Capacity - offset;
+
+    /* Producers rely on unclaimed space reading as zero */
+    if (first > length)
+        first = length;
+    memset(queue->Buffer + offset, 0, first);
+    memset(queue->Buffer, 0, length - first);
+
+    __atomic_store_n(&queue->Head, queue->ReadHead, __ATOMIC_RELEASE);
+}
+
+size_t DTCMpscQueue_consume(struct DTCMpscQueue *queue, DTCMessageHandler handler, void *context, size_t max)
+{
+    const struct DTCMessageHeader *msg;
+    size_t count = 0;
+
+    while (count < max && (msg = DTCMpscQueue_peek(queue)) != NULL) {
+        handler(context, msg);
+        DTCMpscQueue_pop(queue);
+        count++;
+    }
+
+    if (count > 0)
+        DTCMpscQueue_release(queue);
+    return count;
+}
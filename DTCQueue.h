@@ -0,0 +1,129 @@
+#ifndef __DTC_QUEUE_H__
+#define __DTC_QUEUE_H__
+
+/*
+ * Lock-free queues of DTC frames for handing messages between threads, e.g.
+ * from a network thread to strategy threads.
+ *
+ * Frames are stored inline in a caller-owned power of two byte buffer and
+ * framed by their own Size field. Each frame starts on an 8 byte boundary
+ * so consumers can read the message structs in place. A frame that does not
+ * fit before the end of the buffer is preceded by a wrap marker, a header
+ * with Type 0, and is stored at the start.
+ *
+ * DTCSpscQueue has a single producer and a single consumer. The producer
+ * pushes any number of frames and makes them visible with one publish, the
+ * consumer hands them out and gives the space back with one release.
+ *
+ * DTCMpscQueue takes frames from any number of producer threads. Producers
+ * claim space with a compare-and-swap and commit a frame by storing its
+ * header last; the single consumer zeroes the space it releases so an
+ * unwritten header always reads as 0.
+ *
+ * The producer and consumer positions are on separate cache lines. The
+ * buffer must be 8 byte aligned and should hold at least two of the largest
+ * frames.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "DTCProtocol.h"
+#include "DTCDispatcher.h"
+
+#ifndef DTC_CACHE_LINE_SIZE
+#define DTC_CACHE_LINE_SIZE 64
+#endif
+
+/* Space a frame of size bytes takes in a queue */
+#define DTC_QUEUE_FRAME_SPACE(size) (((size_t)(size) + 7) & ~(size_t)7)
+
+struct DTCSpscQueue
+{
+    unsigned char *Buffer;
+    size_t Capacity;
+    unsigned char Pad0[DTC_CACHE_LINE_SIZE];
+
+    /* Producer */
+    size_t Tail;            /* published end of the frames */
+    size_t WriteTail;       /* end of the frames pushed so far */
+    size_t CachedHead;
+    unsigned char Pad1[DTC_CACHE_LINE_SIZE];
+
+    /* Consumer */
+    size_t Head;            /* released start of the frames */
+    size_t ReadHead;        /* start of the next frame to read */
+    size_t CachedTail;
+    unsigned char Pad2[DTC_CACHE_LINE_SIZE];
+};
+
+struct DTCMpscQueue
+{
+    unsigned char *Buffer;
+    size_t Capacity;
+    unsigned char Pad0[DTC_CACHE_LINE_SIZE];
+
+    /* Producers */
+    size_t Tail;            /* end of the claimed space */
+    unsigned char Pad1[DTC_CACHE_LINE_SIZE];
+
+    /* Consumer */
+    size_t Head;
+    size_t ReadHead;
+    unsigned char Pad2[DTC_CACHE_LINE_SIZE];
+};
+
+/* capacity is a power of two */
+void DTCSpscQueue_init(struct DTCSpscQueue *queue, void *buffer, size_t capacity);
+
+/*
+ * Producer: space for a frame of size bytes, or NULL if the queue is too
+ * full. The frame is written in place and added with DTCSpscQueue_commit().
+ */
+void *DTCSpscQueue_reserve(struct DTCSpscQueue *queue, size_t size);
+void DTCSpscQueue_commit(struct DTCSpscQueue *queue, size_t size);
+
+/* Producer: copies a frame in, returns -1 if the queue is too full */
+int DTCSpscQueue_push(struct DTCSpscQueue *queue, const void *msg);
+
+/* Producer: makes every frame pushed so far visible to the consumer */
+void DTCSpscQueue_publish(struct DTCSpscQueue *queue);
+
+/* Consumer: the next frame, or NULL if none has been published */
+const struct DTCMessageHeader *DTCSpscQueue_peek(struct DTCSpscQueue *queue);
+
+/* Consumer: moves past the frame returned by DTCSpscQueue_peek() */
+void DTCSpscQueue_pop(struct DTCSpscQueue *queue);
+
+/* Consumer: returns the space of all popped frames to the producer */
+void DTCSpscQueue_release(struct DTCSpscQueue *queue);
+
+/* Consumer: passes up to max frames to handler, then releases them. Returns the count. */
+size_t DTCSpscQueue_consume(struct DTCSpscQueue *queue, DTCMessageHandler handler, void *context, size_t max);
+
+/* capacity is a power of two; the buffer is zeroed */
+void DTCMpscQueue_init(struct DTCMpscQueue *queue, void *buffer, size_t capacity);
+
+/* Any thread: copies a frame in, returns -1 if the queue is too full */
+int DTCMpscQueue_push(struct DTCMpscQueue *queue, const void *msg);
+
+/*
+ * Any thread: copies count frames into one contiguous claim so they reach
+ * the consumer back to back. Either all are queued or, returning -1, none.
+ */
+int DTCMpscQueue_push_batch(struct DTCMpscQueue *queue, const struct DTCMessageHeader *const *msgs, size_t count);
+
+/* Consumer: the next committed frame, or NULL */
+const struct DTCMessageHeader *DTCMpscQueue_peek(struct DTCMpscQueue *queue);
+void DTCMpscQueue_pop(struct DTCMpscQueue *queue);
+void DTCMpscQueue_release(struct DTCMpscQueue *queue);
+size_t DTCMpscQueue_consume(struct DTCMpscQueue *queue, DTCMessageHandler handler, void *context, size_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DTC_QUEUE_H__ */
@@ -0,0 +1,142 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "DTCReplay.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+#include <time.h>
+
+static uint64_t monotonic_now(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+void DTCReplay_init(struct DTCReplay *replay, const struct DTCDispatcher *dispatcher)
+{
+    memset(replay, 0, sizeof(*replay));
+    replay->Dispatcher = dispatcher;
+}
+
+void DTCReplay_set_speed(struct DTCReplay *replay, double speed)
+{
+    replay->Speed = speed > 0 ? speed : 0;
+
+    /* Restart the pacing clock from the next frame */
+    replay->Started = 0;
+}
+
+void DTCReplay_select_type(struct DTCReplay *replay, uint16_t msg_type)
+{
+    if (msg_type >= DTC_MESSAGE_TYPE_COUNT)
+        return;
+
+    replay->SelectedTypes[msg_type] = 1;
+    replay->FilterTypes = 1;
+}
+
+void DTCReplay_select_symbol(struct DTCReplay *replay, uint16_t symbol_id)
+{
+    replay->SelectedSymbols[symbol_id >> 3] |= (uint8_t)(1u << (symbol_id & 7));
+    replay->FilterSymbols = 1;
+}
+
+static int is_selected(const struct DTCReplay *replay, const struct DTCMessageHeader *msg)
+{
+    if (replay->FilterTypes && (msg->Type >= DTC_MESSAGE_TYPE_COUNT || !replay->SelectedTypes[msg->Type]))
+        return 0;
+
+    if (replay->FilterSymbols) {
+        int symbol_id = get_market_data_symbol_id(msg);
+
+        if (symbol_id < 0 || !(replay->SelectedSymbols[symbol_id >> 3] & (1u << (symbol_id & 7))))
+            return 0;
+    }
+    return 1;
+}
+
+/* Sleeps until the frame recorded at recorded is due */
+static void pace(struct DTCReplay *replay, uint64_t recorded)
+{
+    struct timespec due;
+    uint64_t target;
+
+    if (!replay->Started) {
+        replay->Started = 1;
+        replay->RecordedOrigin = recorded;
+        replay->ReplayOrigin = monotonic_now();
+        return;
+    }
+
+    if (recorded <= replay->RecordedOrigin)
+        return;
+
+    target = replay->ReplayOrigin + (uint64_t)((double)(recorded - replay->RecordedOrigin) / replay->Speed);
+    if (monotonic_now() >= target)
+        return;
+
+    due.tv_sec = (time_t)(target / 1000000000u);
+    due.tv_nsec = (long)(target % 1000000000u);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &due, NULL) == EINTR && !replay->Stop)
+        ;
+}
+
+int DTCReplay_run_segment(struct DTCReplay *replay, const char *path)
+{
+    struct DTCJournalReader reader;
+    const struct DTCJournalRecord *record;
+
+    if (DTCJournalReader_open(&reader, path) != 0)
+        return -1;
+
+    while (!replay->Stop && (record = DTCJournalReader_next(&reader)) != NULL) {
+        const struct DTCMessageHeader *msg = DTC_JOURNAL_RECORD_MESSAGE(record);
+
+        replay->Records++;
+        if (!is_selected(replay, msg)) {
+            replay->Filtered++;
+            continue;
+        }
+
+        if (replay->Speed > 0)
+            pace(replay, record->ReceiveTime);
+
+        if (DTCDispatcher_dispatch(replay->Dispatcher, msg) == DTC_MESSAGE_VALID)
+            replay->Dispatched++;
+        else
+            replay->Rejected++;
+    }
+
+    DTCJournalReader_close(&reader);
+    return 0;
+}
+
+int DTCReplay_run(struct DTCReplay *replay, const char *prefix)
+{
+    char path[PATH_MAX];
+    uint32_t number;
+
+    for (number = 0; !replay->Stop; number++) {
+        if (DTCJournal_segment_path(path, sizeof(path), prefix, number) != 0) {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+
+        if (DTCReplay_run_segment(replay, path) != 0) {
+            if (errno == ENOENT && number > 0)
+                break;
+            return -1;
+        }
+    }
+    return (int)number;
+}
+
+void DTCReplay_stop(struct DTCReplay *replay)
+{
+    replay->Stop = 1;
+}
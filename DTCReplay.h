@@ -0,0 +1,75 @@
+#ifndef __DTC_REPLAY_H__
+#define __DTC_REPLAY_H__
+
+/*
+ * Replays journal segments written by DTCJournalWriter through a
+ * DTCDispatcher (POSIX).
+ *
+ * Frames are dispatched in place from the mapped segment, in recorded order,
+ * exactly as DTCDecoder would hand them over from a socket. Pacing follows
+ * the recorded receive timestamps: Speed 1 replays at the original pace,
+ * Speed N at N times that, and Speed 0 (the default) as fast as possible,
+ * where the loop does nothing but filter and dispatch.
+ *
+ * Optional filters pass only the selected message types and/or
+ * MarketDataSymbolIDs; with a symbol filter, messages without a symbol ID
+ * are skipped as well.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "DTCProtocol.h"
+#include "DTCDispatcher.h"
+#include "DTCJournal.h"
+
+struct DTCReplay
+{
+    const struct DTCDispatcher *Dispatcher;
+    double Speed;
+    volatile int Stop;
+
+    int FilterTypes;
+    int FilterSymbols;
+    uint8_t SelectedTypes[DTC_MESSAGE_TYPE_COUNT];
+    uint8_t SelectedSymbols[DTC_SYMBOL_ID_COUNT / 8];
+
+    /* Pacing: recorded time of the first frame and the monotonic time it was replayed */
+    int Started;
+    uint64_t RecordedOrigin;
+    uint64_t ReplayOrigin;
+
+    /* Statistics */
+    uint64_t Records;
+    uint64_t Dispatched;
+    uint64_t Filtered;
+    uint64_t Rejected;      /* unknown or truncated frames */
+};
+
+void DTCReplay_init(struct DTCReplay *replay, const struct DTCDispatcher *dispatcher);
+
+/* 0 for as fast as possible, 1 for the recorded pace */
+void DTCReplay_set_speed(struct DTCReplay *replay, double speed);
+
+/* Once a type or symbol has been selected only selected ones are replayed */
+void DTCReplay_select_type(struct DTCReplay *replay, uint16_t msg_type);
+void DTCReplay_select_symbol(struct DTCReplay *replay, uint16_t symbol_id);
+
+/* Replays one segment file. Returns 0, or -1 with errno set if it cannot be opened. */
+int DTCReplay_run_segment(struct DTCReplay *replay, const char *path);
+
+/*
+ * Replays <prefix>.000000, <prefix>.000001, ... up to the first missing
+ * segment. Returns the number of segments replayed or -1 with errno set.
+ */
+int DTCReplay_run(struct DTCReplay *replay, const char *prefix);
+
+/* Ends the replay after the current frame */
+void DTCReplay_stop(struct DTCReplay *replay);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DTC_REPLAY_H__ */
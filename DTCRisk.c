@@ -0,0 +1,249 @@
+#include "DTCRisk.h"
+
+#include <math.h>
+#include <string.h>
+
+void DTCRisk_init(struct DTCRisk *risk, const struct DTCRiskLimits *limits, const struct DTCMarketState *market,
+                  struct DTCPositionKeeper *positions, const struct DTCOrderCache *orders)
+{
+    memset(risk, 0, sizeof(struct DTCRisk));
+    risk->Limits = *limits;
+    risk->Market = market;
+    risk->Positions = positions;
+    risk->Orders = orders;
+
+    if (risk->Limits.MaxOrderBurst < 1)
+        risk->Limits.MaxOrderBurst = risk->Limits.MaxOrdersPerSecond >= 1 ? risk->Limits.MaxOrdersPerSecond : 1;
+}
+
+/* The price the collar applies to, 0 for none */
+static double limit_price(int32_t order_type, double price1, double price2)
+{
+    switch (order_type) {
+    case ORDER_TYPE_LIMIT:
+        return price1;
+    case ORDER_TYPE_STOP_LIMIT:
+        return price2;
+    default:
+        return 0;
+    }
+}
+
+static int check_price(const struct DTCRisk *risk, uint16_t symbol_id, int32_t order_type, int32_t buy_sell,
+                       double price1, double price2)
+{
+    double touch;
+    double price;
+
+    /* A stop order's price is a trigger and meant to be away from the market */
+    if (risk->Limits.PriceCollar <= 0 || risk->Market == NULL || order_type == ORDER_TYPE_STOP)
+        return DTC_RISK_ACCEPT;
+
+    touch = buy_sell == BUY ? risk->Market->Ask[symbol_id] : risk->Market->Bid[symbol_id];
+    if (touch <= 0)
+        return DTC_RISK_NO_MARKET;
+
+    price = limit_price(order_type, price1, price2);
+    if (price == 0)
+        return DTC_RISK_ACCEPT;
+
+    if (buy_sell == BUY ? price > touch * (1 + risk->Limits.PriceCollar) : price < touch * (1 - risk->Limits.PriceCollar))
+        return DTC_RISK_PRICE_COLLAR;
+    return DTC_RISK_ACCEPT;
+}
+
+static int check_position(const struct DTCRisk *risk, const char *trade_account, const char *symbol, const char *exchange,
+                          int32_t buy_sell, double quantity)
+{
+    const struct DTCPosition *position;
+    double current = 0;
+    double projected;
+
+    if (risk->Limits.MaxPosition <= 0 || risk->Positions == NULL)
+        return DTC_RISK_ACCEPT;
+
+    position = DTCPositionKeeper_get(risk->Positions, trade_account, symbol, exchange, 0);
+    if (position != NULL)
+        current = position->Quantity;
+
+    /* Orders that reduce the position are always allowed */
+    projected = current + (buy_sell == BUY ? quantity : -quantity);
+    if (fabs(projected) > risk->Limits.MaxPosition && fabs(projected) > fabs(current))
+        return DTC_RISK_POSITION_LIMIT;
+    return DTC_RISK_ACCEPT;
+}
+
+static int check_leg(const struct DTCRisk *risk, uint16_t symbol_id, const char *trade_account, const char *symbol,
+                     const char *exchange, int32_t order_type, int32_t buy_sell, double price1, double price2, double quantity)
+{
+    int result;
+
+    if ((buy_sell != BUY && buy_sell != SELL) || !(quantity > 0))
+        return DTC_RISK_INVALID_ORDER;
+    if (risk->Limits.MaxOrderQuantity > 0 && quantity > risk->Limits.MaxOrderQuantity)
+        return DTC_RISK_MAX_QUANTITY;
+
+    result = check_price(risk, symbol_id, order_type, buy_sell, price1, price2);
+    if (result != DTC_RISK_ACCEPT)
+        return result;
+
+    return check_position(risk, trade_account, symbol, exchange, buy_sell, quantity);
+}
+
+static struct DTCRiskAccount *find_account(struct DTCRisk *risk, const char *trade_account, uint64_t now)
+{
+    char key[TRADE_ACCOUNT_LENGTH];
+    uint32_t hash = 2166136261u;
+    uint32_t slot;
+    uint32_t probes;
+    size_t i;
+
+    for (i = 0; i < TRADE_ACCOUNT_LENGTH && trade_account[i] != '\0'; i++) {
+        key[i] = trade_account[i];
+        hash = (hash ^ (unsigned char)key[i]) * 16777619u;
+    }
+    for (; i < TRADE_ACCOUNT_LENGTH; i++)
+        key[i] = '\0';
+
+    slot = hash % DTC_RISK_MAX_ACCOUNTS;
+    for (probes = 0; probes < DTC_RISK_MAX_ACCOUNTS; probes++) {
+        struct DTCRiskAccount *account = &risk->Accounts[slot];
+
+        if (!account->InUse) {
+            memcpy(account->TradeAccount, key, TRADE_ACCOUNT_LENGTH);
+            account->InUse = 1;
+            account->Tokens = risk->Limits.MaxOrderBurst;
+            account->LastRefill = now;
+            risk->AccountCount++;
+            return account;
+        }
+        if (memcmp(account->TradeAccount, key, TRADE_ACCOUNT_LENGTH) == 0)
+            return account;
+        slot = (slot + 1) % DTC_RISK_MAX_ACCOUNTS;
+    }
+    return NULL;
+}
+
+/* Charges one message to the account's bucket, last so rejected orders cost nothing */
+static int take_token(struct DTCRisk *risk, const char *trade_account, uint64_t now)
+{
+    struct DTCRiskAccount *account;
+
+    if (risk->Limits.MaxOrdersPerSecond <= 0)
+        return DTC_RISK_ACCEPT;
+
+    account = find_account(risk, trade_account, now);
+    if (account == NULL)
+        return DTC_RISK_TOO_MANY_ACCOUNTS;
+
+    if (now > account->LastRefill) {
+        account->Tokens += (double)(now - account->LastRefill) * risk->Limits.MaxOrdersPerSecond / 1e9;
+        if (account->Tokens > risk->Limits.MaxOrderBurst)
+            account->Tokens = risk->Limits.MaxOrderBurst;
+        account->LastRefill = now;
+    }
+
+    if (account->Tokens < 1)
+        return DTC_RISK_RATE_LIMIT;
+    account->Tokens -= 1;
+    return DTC_RISK_ACCEPT;
+}
+
+static int finish(struct DTCRisk *risk, int result)
+{
+    risk->Checked++;
+    if (result != DTC_RISK_ACCEPT)
+        risk->Rejected++;
+    return result;
+}
+
+int DTCRisk_check_single(struct DTCRisk *risk, const struct s_SubmitNewSingleOrder *order, uint16_t symbol_id, uint64_t now)
+{
+    int result = check_leg(risk, symbol_id, order->TradeAccount, order->Symbol, order->Exchange, order->OrderType,
+                           order->BuySell, order->Price1, order->Price2, order->OrderQuantity);
+
+    if (result == DTC_RISK_ACCEPT)
+        result = take_token(risk, order->TradeAccount, now);
+    return finish(risk, result);
+}
+
+int DTCRisk_check_oco(struct DTCRisk *risk, const struct s_SubmitNewOCOOrder *order, uint16_t symbol_id, uint64_t now)
+{
+    int result = check_leg(risk, symbol_id, order->TradeAccount, order->Symbol, order->Exchange, order->OrderType_1,
+                           order->BuySell_1, order->Price1_1, order->Price2_1, order->OrderQuantity_1);
+
+    if (result == DTC_RISK_ACCEPT)
+        result = check_leg(risk, symbol_id, order->TradeAccount, order->Symbol, order->Exchange, order->OrderType_2,
+                           order->BuySell_2, order->Price1_2, order->Price2_2, order->OrderQuantity_2);
+    if (result == DTC_RISK_ACCEPT)
+        result = take_token(risk, order->TradeAccount, now);
+    return finish(risk, result);
+}
+
+int DTCRisk_check_cancel_replace(struct DTCRisk *risk, const struct s_CancelReplaceOrder *replace, uint16_t symbol_id, uint64_t now)
+{
+    const struct DTCOrder *original = NULL;
+    double quantity;
+    double price1;
+    double price2;
+    int result;
+
+    if (risk->Orders != NULL) {
+        original = DTCOrderCache_find_server(risk->Orders, replace->ServerOrderID);
+        if (original == NULL)
+            original = DTCOrderCache_find_client(risk->Orders, replace->ClientOrderID);
+        if (original == NULL)
+            return finish(risk, DTC_RISK_UNKNOWN_ORDER);
+    }
+
+    /* Without the original order only the new quantity can be checked */
+    if (original == NULL) {
+        result = DTC_RISK_ACCEPT;
+        if (risk->Limits.MaxOrderQuantity > 0 && replace->OrderQuantity > risk->Limits.MaxOrderQuantity)
+            result = DTC_RISK_MAX_QUANTITY;
+        if (result == DTC_RISK_ACCEPT)
+            result = take_token(risk, replace->TradeAccount, now);
+        return finish(risk, result);
+    }
+
+    quantity = replace->OrderQuantity != 0 ? replace->OrderQuantity : original->OrderQuantity;
+    price1 = replace->Price1 != 0 ? replace->Price1 : original->Price1;
+    price2 = replace->Price2 != 0 ? replace->Price2 : original->Price2;
+
+    if (risk->Limits.MaxOrderQuantity > 0 && quantity > risk->Limits.MaxOrderQuantity) {
+        result = DTC_RISK_MAX_QUANTITY;
+    } else {
+        /* Only what is left after the fills so far can still add to the position */
+        result = check_leg(risk, symbol_id, original->TradeAccount, original->Symbol, original->Exchange,
+                           original->OrderType, original->BuySell, price1, price2, quantity - original->FilledQuantity);
+    }
+    if (result == DTC_RISK_ACCEPT)
+        result = take_token(risk, original->TradeAccount, now);
+    return finish(risk, result);
+}
+
+const char *DTCRisk_reason(int result)
+{
+    switch (result) {
+    case DTC_RISK_ACCEPT:
+        return "Accepted";
+    case DTC_RISK_INVALID_ORDER:
+        return "Invalid side or quantity";
+    case DTC_RISK_MAX_QUANTITY:
+        return "Order quantity above the maximum";
+    case DTC_RISK_NO_MARKET:
+        return "No market to check the price against";
+    case DTC_RISK_PRICE_COLLAR:
+        return "Price outside the collar";
+    case DTC_RISK_POSITION_LIMIT:
+        return "Position limit exceeded";
+    case DTC_RISK_RATE_LIMIT:
+        return "Order rate limit exceeded";
+    case DTC_RISK_UNKNOWN_ORDER:
+        return "Order to replace not found";
+    case DTC_RISK_TOO_MANY_ACCOUNTS:
+        return "Too many trade accounts";
+    default:
+        return "Unknown risk check result";
+    }
+}
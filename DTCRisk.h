@@ -0,0 +1,102 @@
+#ifndef __DTC_RISK_H__
+#define __DTC_RISK_H__
+
+/*
+ * Pre-trade risk checks for orders about to be sent.
+ *
+ * Every order goes through the same fixed sequence of checks in one
+ * function, cheapest first: quantity, price collar against the top of book,
+ * position limit and order rate. A limit of 0 turns its check off, so
+ * nothing is called through a pointer and nothing is allocated per order.
+ *
+ * Prices come from a DTCMarketState, positions from a DTCPositionKeeper and
+ * the orders being replaced from a DTCOrderCache; checks whose source is
+ * NULL are skipped. The position limit applies to the filled position plus
+ * the order, per TradeAccount and symbol. The rate limit is a token bucket
+ * per TradeAccount charged only for accepted messages; accounts are kept in
+ * a fixed table of DTC_RISK_MAX_ACCOUNTS.
+ *
+ * The collar applies to the limit price of LIMIT and STOP_LIMIT orders: a
+ * buy may be at most PriceCollar (a fraction) above the ask, a sell at most
+ * as far below the bid. Market orders only need a quote on the other side.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "DTCProtocol.h"
+#include "DTCMarketState.h"
+#include "DTCOrderCache.h"
+#include "DTCPositionKeeper.h"
+
+#ifndef DTC_RISK_MAX_ACCOUNTS
+#define DTC_RISK_MAX_ACCOUNTS 256
+#endif
+
+enum DTCRiskResultEnum {
+    DTC_RISK_ACCEPT = 0,
+    DTC_RISK_INVALID_ORDER = -1,        /* BuySell unset or quantity not positive */
+    DTC_RISK_MAX_QUANTITY = -2,
+    DTC_RISK_NO_MARKET = -3,            /* no quote to check the price against */
+    DTC_RISK_PRICE_COLLAR = -4,
+    DTC_RISK_POSITION_LIMIT = -5,
+    DTC_RISK_RATE_LIMIT = -6,
+    DTC_RISK_UNKNOWN_ORDER = -7,        /* cancel/replace of an order not in the cache */
+    DTC_RISK_TOO_MANY_ACCOUNTS = -8
+};
+
+struct DTCRiskLimits
+{
+    double MaxOrderQuantity;
+    double PriceCollar;                 /* fraction of the touch, e.g. 0.05 */
+    double MaxPosition;                 /* absolute, per account and symbol */
+    double MaxOrdersPerSecond;
+    double MaxOrderBurst;               /* bucket size, MaxOrdersPerSecond if 0 */
+};
+
+struct DTCRiskAccount
+{
+    char TradeAccount[TRADE_ACCOUNT_LENGTH];
+    uint8_t InUse;
+    double Tokens;
+    uint64_t LastRefill;                /* nanoseconds */
+};
+
+struct DTCRisk
+{
+    struct DTCRiskLimits Limits;
+    const struct DTCMarketState *Market;
+    struct DTCPositionKeeper *Positions;
+    const struct DTCOrderCache *Orders;
+    uint64_t Checked;
+    uint64_t Rejected;
+    uint32_t AccountCount;
+    struct DTCRiskAccount Accounts[DTC_RISK_MAX_ACCOUNTS];
+};
+
+/* Any of market, positions and orders may be NULL */
+void DTCRisk_init(struct DTCRisk *risk, const struct DTCRiskLimits *limits, const struct DTCMarketState *market,
+                  struct DTCPositionKeeper *positions, const struct DTCOrderCache *orders);
+
+/*
+ * Each check takes the MarketDataSymbolID of the order's symbol and the time
+ * in nanoseconds, e.g. DTCLatency_now(), and returns a DTCRiskResultEnum
+ * value.
+ */
+int DTCRisk_check_single(struct DTCRisk *risk, const struct s_SubmitNewSingleOrder *order, uint16_t symbol_id, uint64_t now);
+
+/* Only one leg can fill, so each is checked on its own; the pair counts as one message */
+int DTCRisk_check_oco(struct DTCRisk *risk, const struct s_SubmitNewOCOOrder *order, uint16_t symbol_id, uint64_t now);
+
+/* Prices and a quantity of 0 keep those of the order being replaced */
+int DTCRisk_check_cancel_replace(struct DTCRisk *risk, const struct s_CancelReplaceOrder *replace, uint16_t symbol_id, uint64_t now);
+
+/* Text for the reject, e.g. for InfoText */
+const char *DTCRisk_reason(int result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DTC_RISK_H__ */
@@ -0,0 +1,647 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "DTCServer.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#define MAX_EVENTS 256
+
+static time_t monotonic_seconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec;
+}
+
+void DTCServerConfig_init(struct DTCServerConfig *config)
+{
+    memset(config, 0, sizeof(struct DTCServerConfig));
+    config->Backlog = 1024;
+    config->SendBufferSize = 256 * 1024;
+    config->DefaultHeartbeatInterval = 10;
+}
+
+static int open_listen_socket(const struct DTCServerConfig *config)
+{
+    struct sockaddr_in addr;
+    int one = 1;
+    int fd;
+
+    fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(config->Port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    if (config->BindAddress != NULL && inet_pton(AF_INET, config->BindAddress, &addr.sin_addr) != 1) {
+        errno = EINVAL;
+        goto fail;
+    }
+
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0)
+        goto fail;
+    if (config->ReusePort && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0)
+        goto fail;
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+        goto fail;
+    if (listen(fd, config->Backlog) < 0)
+        goto fail;
+
+    return fd;
+
+fail:
+    close(fd);
+    return -1;
+}
+
+int DTCServer_init(struct DTCServer *server, const struct DTCServerConfig *config)
+{
+    struct itimerspec tick;
+    struct epoll_event ev;
+
+    server->Config = *config;
+    server->Stop = 0;
+    server->Connections = NULL;
+    server->Unflushed = NULL;
+    server->ConnectionCount = 0;
+    server->Latency = NULL;
+    server->ListenFd = -1;
+    server->EpollFd = -1;
+    server->TimerFd = -1;
+    server->SpareFd = -1;
+
+    if (config->MeasureLatency) {
+        server->Latency = (struct DTCLatency *)malloc(sizeof(struct DTCLatency));
+        if (server->Latency == NULL)
+            return -1;
+        DTCLatency_init(server->Latency);
+    }
+
+    server->ListenFd = open_listen_socket(config);
+    if (server->ListenFd < 0)
+        goto fail;
+
+    server->SpareFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    if (server->SpareFd < 0)
+        goto fail;
+
+    server->EpollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (server->EpollFd < 0)
+        goto fail;
+
+    /* One second tick drives heartbeats and timeouts */
+    server->TimerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (server->TimerFd < 0)
+        goto fail;
+
+    memset(&tick, 0, sizeof(tick));
+    tick.it_interval.tv_sec = 1;
+    tick.it_value.tv_sec = 1;
+    if (timerfd_settime(server->TimerFd, 0, &tick, NULL) < 0)
+        goto fail;
+
+    /* The listening socket and the timer are told apart from connections by data.ptr */
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = NULL;
+    if (epoll_ctl(server->EpollFd, EPOLL_CTL_ADD, server->ListenFd, &ev) < 0)
+        goto fail;
+
+    ev.events = EPOLLIN;
+    ev.data.ptr = &server->TimerFd;
+    if (epoll_ctl(server->EpollFd, EPOLL_CTL_ADD, server->TimerFd, &ev) < 0)
+        goto fail;
+
+    return 0;
+
+fail:
+    DTCServer_close(server);
+    return -1;
+}
+
+void DTCServerConnection_close(struct DTCServerConnection *conn)
+{
+    struct DTCServer *server = conn->Server;
+
+    if (conn->Closing)
+        return;
+
+    conn->Closing = 1;
+    if (server->Config.Callbacks.on_disconnect != NULL)
+        server->Config.Callbacks.on_disconnect(server->Config.Context, conn);
+
+    epoll_ctl(server->EpollFd, EPOLL_CTL_DEL, conn->Fd, NULL);
+    close(conn->Fd);
+    conn->Fd = -1;
+}
+
+int DTCServerConnection_detach(struct DTCServerConnection *conn)
+{
+    struct DTCServer *server = conn->Server;
+    int fd;
+
+    if (conn->Closing || DTCServerConnection_flush(conn) != 0) {
+        errno = EBADF;
+        return -1;
+    }
+    if (DTCOutputRing_pending(&conn->Output) != 0) {
+        errno = EAGAIN;
+        return -1;
+    }
+
+    fd = conn->Fd;
+    conn->Closing = 1;
+    if (server->Config.Callbacks.on_disconnect != NULL)
+        server->Config.Callbacks.on_disconnect(server->Config.Context, conn);
+
+    epoll_ctl(server->EpollFd, EPOLL_CTL_DEL, fd, NULL);
+    conn->Fd = -1;
+    return fd;
+}
+
+/* Unlinks and frees connections closed while handling the last batch of events */
+static void reap_connections(struct DTCServer *server)
+{
+    struct DTCServerConnection *conn = server->Connections;
+
+    while (conn != NULL) {
+        struct DTCServerConnection *next = conn->Next;
+
+        if (conn->Closing) {
+            if (conn->Prev != NULL)
+                conn->Prev->Next = conn->Next;
+            else
+                server->Connections = conn->Next;
+            if (conn->Next != NULL)
+                conn->Next->Prev = conn->Prev;
+            server->ConnectionCount--;
+            free(conn);
+        }
+        conn = next;
+    }
+}
+
+void DTCServer_close(struct DTCServer *server)
+{
+    struct DTCServerConnection *conn;
+
+    for (conn = server->Connections; conn != NULL; conn = conn->Next)
+        DTCServerConnection_close(conn);
+    server->Unflushed = NULL;
+    reap_connections(server);
+
+    if (server->SpareFd >= 0)
+        close(server->SpareFd);
+    server->SpareFd = -1;
+
+    if (server->TimerFd >= 0)
+        close(server->TimerFd);
+    if (server->EpollFd >= 0)
+        close(server->EpollFd);
+    if (server->ListenFd >= 0)
+        close(server->ListenFd);
+
+    server->TimerFd = -1;
+    server->EpollFd = -1;
+    server->ListenFd = -1;
+
+    free(server->Latency);
+    server->Latency = NULL;
+}
+
+void DTCServer_stop(struct DTCServer *server)
+{
+    server->Stop = 1;
+}
+
+int DTCServerConnection_flush(struct DTCServerConnection *conn)
+{
+    struct DTCSlice slices[2];
+    struct iovec iov[2];
+    struct msghdr hdr;
+    int count;
+    int i;
+
+    while (!conn->Closing) {
+        ssize_t written;
+        size_t total = 0;
+
+        count = DTCOutputRing_slices(&conn->Output, slices);
+        if (count == 0)
+            return 0;
+
+        for (i = 0; i < count; i++) {
+            iov[i].iov_base = slices[i].Data;
+            iov[i].iov_len = slices[i].Length;
+            total += slices[i].Length;
+        }
+
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.msg_iov = iov;
+        hdr.msg_iovlen = count;
+
+        written = sendmsg(conn->Fd, &hdr, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return 0;
+            DTCServerConnection_close(conn);
+            return -1;
+        }
+
+        DTCOutputRing_consume(&conn->Output, (size_t)written);
+        conn->LastSend = monotonic_seconds();
+
+        if (conn->ResponseQueued != 0 && DTCOutputRing_pending(&conn->Output) == 0) {
+            DTCLatency_record_since(conn->Server->Latency, DTC_LATENCY_DISPATCH_TO_SEND, conn->ResponseType,
+                                    conn->ResponseQueued);
+            conn->ResponseQueued = 0;
+        }
+
+        /* Socket buffer full, EPOLLOUT resumes the flush */
+        if ((size_t)written < total)
+            return 0;
+    }
+    return -1;
+}
+
+int DTCServerConnection_send(struct DTCServerConnection *conn, const void *msg)
+{
+    uint16_t size = ((const struct DTCMessageHeader *)msg)->Size;
+    void *out;
+
+    if (conn->Closing)
+        return -1;
+
+    out = DTCOutputRing_reserve(&conn->Output, size);
+    if (out == NULL) {
+        DTCServerConnection_flush(conn);
+        out = DTCOutputRing_reserve(&conn->Output, size);
+        if (out == NULL)
+            return -1;
+    }
+
+    memcpy(out, msg, size);
+    DTCOutputRing_commit(&conn->Output, size);
+
+    /* A response from a handler, timed until the write that empties the output ring */
+    if (conn->Dispatched != 0 && conn->ResponseQueued == 0) {
+        conn->ResponseQueued = conn->Dispatched;
+        conn->ResponseType = conn->DispatchedType;
+    }
+
+    if (DTCOutputRing_pending(&conn->Output) > conn->Server->Config.SendBufferSize / 2)
+        return DTCServerConnection_flush(conn);
+
+    if (!conn->Unflushed) {
+        conn->Unflushed = 1;
+        conn->NextUnflushed = conn->Server->Unflushed;
+        conn->Server->Unflushed = conn;
+    }
+    return 0;
+}
+
+/* Writes the output queued during this pass of the event loop, before closed connections are reaped */
+static void flush_connections(struct DTCServer *server)
+{
+    while (server->Unflushed != NULL) {
+        struct DTCServerConnection *conn = server->Unflushed;
+
+        server->Unflushed = conn->NextUnflushed;
+        conn->Unflushed = 0;
+        if (!conn->Closing)
+            DTCServerConnection_flush(conn);
+    }
+}
+
+static void handle_logon(struct DTCServerConnection *conn, const struct s_LogonRequest *request)
+{
+    struct DTCServer *server = conn->Server;
+    struct s_LogonResponse response;
+
+    LogonResponse_init(&response);
+    response.Result = LOGON_SUCCESS;
+
+    if (server->Config.Callbacks.on_logon != NULL)
+        server->Config.Callbacks.on_logon(server->Config.Context, conn, request, &response);
+
+    conn->HeartbeatInterval = request->HeartbeatIntervalInSeconds > 0
+        ? request->HeartbeatIntervalInSeconds : server->Config.DefaultHeartbeatInterval;
+
+    DTCServerConnection_send(conn, &response);
+
+    if (response.Result != LOGON_SUCCESS) {
+        /* Best effort, the reject goes out only if the socket takes it now */
+        DTCServerConnection_flush(conn);
+        DTCServerConnection_close(conn);
+        return;
+    }
+    conn->LoggedOn = 1;
+}
+
+/* received is the DTCLatency_now() time of the read with MeasureLatency, else 0 */
+static void handle_frames(struct DTCServerConnection *conn, uint64_t received)
+{
+    struct DTCServer *server = conn->Server;
+    const struct DTCMessageHeader *msg;
+    int result = DTC_DECODE_NEED_MORE;
+
+    while (!conn->Closing && (result = DTCDecoder_next(&conn->Decoder, &msg)) == DTC_DECODE_MESSAGE) {
+        uint64_t decoded = received != 0 ? DTCLatency_now() : 0;
+        int valid = validate_message(msg, DTC_CLIENT_TO_SERVER);
+
+        if (valid == DTC_MESSAGE_TRUNCATED) {
+            DTCServerConnection_close(conn);
+            return;
+        }
+
+        if (!conn->LoggedOn) {
+            if (msg->Type != LOGON_REQUEST || valid != DTC_MESSAGE_VALID) {
+                DTCServerConnection_close(conn);
+                return;
+            }
+            handle_logon(conn, (const struct s_LogonRequest *)msg);
+            continue;
+        }
+
+        switch (msg->Type) {
+        case HEARTBEAT:
+            break;
+        case LOGOFF_REQUEST:
+            DTCServerConnection_close(conn);
+            return;
+        default:
+            /* Unknown types are skipped so newer clients can connect */
+            if (valid != DTC_MESSAGE_VALID)
+                break;
+
+            if (received != 0) {
+                /*
+                 * The handler runs right after decoding, so DECODE_TO_DISPATCH is left out.
+                 * DISPATCH_TO_SEND is recorded when the responses are written, see
+                 * DTCServerConnection_send().
+                 */
+                DTCLatency_record(server->Latency, DTC_LATENCY_RECEIVE_TO_DECODE, msg->Type, decoded - received);
+                conn->Dispatched = decoded;
+                conn->DispatchedType = msg->Type;
+                server->Config.Callbacks.on_message(server->Config.Context, conn, msg);
+                conn->Dispatched = 0;
+            } else {
+                server->Config.Callbacks.on_message(server->Config.Context, conn, msg);
+            }
+            break;
+        }
+    }
+
+    if (result == DTC_DECODE_ERROR)
+        DTCServerConnection_close(conn);
+}
+
+static void read_connection(struct DTCServerConnection *conn)
+{
+    struct DTCServer *server = conn->Server;
+
+    /* Edge triggered, read until the socket is drained */
+    while (!conn->Closing) {
+        ssize_t n = recv(conn->Fd, server->ReceiveBuffer, sizeof(server->ReceiveBuffer), 0);
+
+        if (n > 0) {
+            conn->LastReceive = monotonic_seconds();
+            DTCDecoder_feed(&conn->Decoder, server->ReceiveBuffer, (size_t)n);
+            handle_frames(conn, server->Latency != NULL ? DTCLatency_now() : 0);
+        } else if (n == 0) {
+            DTCServerConnection_close(conn);
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        } else if (errno != EINTR) {
+            DTCServerConnection_close(conn);
+        }
+    }
+}
+
+static void accept_connections(struct DTCServer *server)
+{
+    for (;;) {
+        struct DTCServerConnection *conn;
+        struct epoll_event ev;
+        int one = 1;
+        int fd;
+
+        fd = accept4(server->ListenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+
+            /*
+             * Out of descriptors. The edge triggered listener would not report
+             * the waiting connections again, so free the spare descriptor to
+             * accept and drop them until the backlog is empty.
+             */
+            if ((errno == EMFILE || errno == ENFILE) && server->SpareFd >= 0) {
+                close(server->SpareFd);
+                fd = accept4(server->ListenFd, NULL, NULL, SOCK_CLOEXEC);
+                if (fd >= 0)
+                    close(fd);
+                server->SpareFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+                if (fd >= 0)
+                    continue;
+            }
+            /* EAGAIN, or still out of descriptors; the timer tick tries again */
+            return;
+        }
+
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        /* The output ring lives directly behind the connection */
+        conn = (struct DTCServerConnection *)malloc(sizeof(struct DTCServerConnection) + server->Config.SendBufferSize);
+        if (conn == NULL) {
+            close(fd);
+            continue;
+        }
+
+        conn->Server = server;
+        conn->Fd = fd;
+        conn->LoggedOn = 0;
+        conn->Closing = 0;
+        conn->Unflushed = 0;
+        conn->NextUnflushed = NULL;
+        conn->HeartbeatInterval = server->Config.DefaultHeartbeatInterval;
+        conn->LastReceive = monotonic_seconds();
+        conn->LastSend = conn->LastReceive;
+        conn->Dispatched = 0;
+        conn->ResponseQueued = 0;
+        conn->DispatchedType = 0;
+        conn->ResponseType = 0;
+        conn->UserData = NULL;
+        DTCOutputRing_init(&conn->Output, conn + 1, server->Config.SendBufferSize);
+        DTCDecoder_init(&conn->Decoder);
+
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.ptr = conn;
+        if (epoll_ctl(server->EpollFd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            close(fd);
+            free(conn);
+            continue;
+        }
+
+        conn->Prev = NULL;
+        conn->Next = server->Connections;
+        if (server->Connections != NULL)
+            server->Connections->Prev = conn;
+        server->Connections = conn;
+        server->ConnectionCount++;
+    }
+}
+
+static void check_heartbeats(struct DTCServer *server)
+{
+    struct DTCServerConnection *conn;
+    struct s_Heartbeat heartbeat;
+    uint64_t expirations;
+    time_t now = monotonic_seconds();
+
+    while (read(server->TimerFd, &expirations, sizeof(expirations)) > 0)
+        ;
+
+    /* Connections left waiting after running out of descriptors are not reported again */
+    accept_connections(server);
+
+    Heartbeat_init(&heartbeat);
+    heartbeat.CurrentDateTime = (t_DateTime)time(NULL);
+
+    for (conn = server->Connections; conn != NULL; conn = conn->Next) {
+        if (conn->Closing)
+            continue;
+
+        /* Peers are dropped after two missed heartbeat intervals, the same before logon */
+        if (now - conn->LastReceive > 2 * (time_t)conn->HeartbeatInterval) {
+            DTCServerConnection_close(conn);
+            continue;
+        }
+
+        if (conn->LoggedOn && now - conn->LastSend >= conn->HeartbeatInterval)
+            DTCServerConnection_send(conn, &heartbeat);
+    }
+}
+
+int DTCServer_run(struct DTCServer *server)
+{
+    struct epoll_event events[MAX_EVENTS];
+
+    while (!server->Stop) {
+        int n = epoll_wait(server->EpollFd, events, MAX_EVENTS, 1000);
+        int i;
+
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+
+        for (i = 0; i < n; i++) {
+            struct DTCServerConnection *conn;
+
+            if (events[i].data.ptr == NULL) {
+                accept_connections(server);
+                continue;
+            }
+            if (events[i].data.ptr == &server->TimerFd) {
+                check_heartbeats(server);
+                continue;
+            }
+
+            conn = (struct DTCServerConnection *)events[i].data.ptr;
+            if (conn->Closing)
+                continue;
+
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+                read_connection(conn);
+            if ((events[i].events & EPOLLOUT) && !conn->Closing)
+                DTCServerConnection_flush(conn);
+        }
+
+        flush_connections(server);
+        reap_connections(server);
+    }
+    return 0;
+}
+
+static void *server_thread(void *arg)
+{
+    DTCServer_run((struct DTCServer *)arg);
+    return NULL;
+}
+
+int DTCServerGroup_start(struct DTCServerGroup *group, const struct DTCServerConfig *config, int count)
+{
+    struct DTCServerConfig thread_config = *config;
+    int i;
+
+    group->Count = 0;
+    group->Servers = (struct DTCServer *)calloc(count, sizeof(struct DTCServer));
+    group->Threads = (pthread_t *)calloc(count, sizeof(pthread_t));
+    if (group->Servers == NULL || group->Threads == NULL)
+        goto fail;
+
+    thread_config.ReusePort = 1;
+
+    for (i = 0; i < count; i++) {
+        cpu_set_t cpus;
+
+        if (DTCServer_init(&group->Servers[i], &thread_config) < 0)
+            goto fail;
+
+        if (pthread_create(&group->Threads[i], NULL, server_thread, &group->Servers[i]) != 0) {
+            DTCServer_close(&group->Servers[i]);
+            goto fail;
+        }
+        group->Count++;
+
+        /* Pinning is best effort, e.g. fewer CPUs than reactors */
+        CPU_ZERO(&cpus);
+        CPU_SET(i % CPU_SETSIZE, &cpus);
+        pthread_setaffinity_np(group->Threads[i], sizeof(cpus), &cpus);
+    }
+    return 0;
+
+fail:
+    DTCServerGroup_stop(group);
+    return -1;
+}
+
+void DTCServerGroup_stop(struct DTCServerGroup *group)
+{
+    int i;
+
+    for (i = 0; i < group->Count; i++)
+        DTCServer_stop(&group->Servers[i]);
+
+    for (i = 0; i < group->Count; i++) {
+        pthread_join(group->Threads[i], NULL);
+        DTCServer_close(&group->Servers[i]);
+    }
+
+    free(group->Servers);
+    free(group->Threads);
+    group->Servers = NULL;
+    group->Threads = NULL;
+    group->Count = 0;
+}
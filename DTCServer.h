@@ -0,0 +1,148 @@
+#ifndef __DTC_SERVER_H__
+#define __DTC_SERVER_H__
+
+/*
+ * Epoll based DTC server reactor (Linux).
+ *
+ * One reactor owns a listening socket and an edge-triggered epoll set. It
+ * accepts connections, performs the LogonRequest/LogonResponse handshake,
+ * sends and checks heartbeats at the negotiated HeartbeatIntervalInSeconds
+ * and passes every other decoded frame to the on_message callback.
+ *
+ * A DTCServerGroup runs one reactor per thread, each with its own listening
+ * socket bound with SO_REUSEPORT so the kernel spreads connections across
+ * them and no state is shared between threads.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <pthread.h>
+#include <time.h>
+
+#include "DTCProtocol.h"
+#include "DTCDecoder.h"
+#include "DTCEncoder.h"
+#include "DTCLatency.h"
+
+struct DTCServer;
+struct DTCServerConnection;
+
+struct DTCServerCallbacks
+{
+    /*
+     * Called with the response initialised to LOGON_SUCCESS. Set Result and
+     * the other response fields as needed; a connection whose Result is not
+     * LOGON_SUCCESS is closed once the response has been sent. May be NULL.
+     */
+    void (*on_logon)(void *context, struct DTCServerConnection *conn, const struct s_LogonRequest *request, struct s_LogonResponse *response);
+
+    /* Every frame after logon except HEARTBEAT and LOGOFF_REQUEST */
+    void (*on_message)(void *context, struct DTCServerConnection *conn, const struct DTCMessageHeader *msg);
+
+    /* Called before the connection is freed. May be NULL. */
+    void (*on_disconnect)(void *context, struct DTCServerConnection *conn);
+};
+
+struct DTCServerConfig
+{
+    const char *BindAddress;        /* NULL for all interfaces */
+    uint16_t Port;
+    int Backlog;
+    int ReusePort;                  /* bind with SO_REUSEPORT */
+    uint32_t SendBufferSize;        /* per connection output ring */
+    int32_t DefaultHeartbeatInterval;   /* used when the client asks for 0 */
+    int MeasureLatency;             /* record DTCLatency stages for frames passed to on_message, see DTCLatency.h */
+    struct DTCServerCallbacks Callbacks;
+    void *Context;
+};
+
+struct DTCServerConnection
+{
+    struct DTCServer *Server;
+    struct DTCServerConnection *Prev;
+    struct DTCServerConnection *Next;
+    struct DTCServerConnection *NextUnflushed;   /* with Unflushed set, in DTCServer.Unflushed */
+    int Unflushed;
+    int Fd;
+    int LoggedOn;
+    int Closing;
+    int32_t HeartbeatInterval;
+    time_t LastReceive;
+    time_t LastSend;
+    uint64_t Dispatched;            /* with MeasureLatency, DTCLatency_now() while on_message runs, else 0 */
+    uint64_t ResponseQueued;        /* Dispatched of the oldest response not yet written, 0 if none */
+    uint16_t DispatchedType;
+    uint16_t ResponseType;
+    void *UserData;
+    struct DTCOutputRing Output;
+    struct DTCDecoder Decoder;
+};
+
+struct DTCServer
+{
+    struct DTCServerConfig Config;
+    int ListenFd;
+    int EpollFd;
+    int TimerFd;
+    int SpareFd;                    /* given up to accept and drop connections when out of descriptors */
+    volatile int Stop;
+    struct DTCServerConnection *Connections;
+    struct DTCServerConnection *Unflushed;  /* connections with output queued since the last flush */
+    uint32_t ConnectionCount;
+    struct DTCLatency *Latency;     /* with MeasureLatency, merge from other threads with DTCLatency_merge() */
+    unsigned char ReceiveBuffer[65536];
+};
+
+struct DTCServerGroup
+{
+    struct DTCServer *Servers;
+    pthread_t *Threads;
+    int Count;
+};
+
+/* Fills in the defaults for all settings but Port and the callbacks */
+void DTCServerConfig_init(struct DTCServerConfig *config);
+
+/* Returns 0 on success or -1 with errno set */
+int DTCServer_init(struct DTCServer *server, const struct DTCServerConfig *config);
+void DTCServer_close(struct DTCServer *server);
+
+/* Runs the event loop until DTCServer_stop() is called */
+int DTCServer_run(struct DTCServer *server);
+void DTCServer_stop(struct DTCServer *server);
+
+/*
+ * Queues a complete message. Queued output is written once per event loop
+ * pass, so messages sent while handling a batch of events go out together,
+ * or at once when more than half of the output ring is in use. Returns -1
+ * if the output ring is full.
+ */
+int DTCServerConnection_send(struct DTCServerConnection *conn, const void *msg);
+
+/* Writes queued output, returns -1 if the connection failed */
+int DTCServerConnection_flush(struct DTCServerConnection *conn);
+
+/* Closes the connection once the current event has been handled */
+void DTCServerConnection_close(struct DTCServerConnection *conn);
+
+/*
+ * Hands the socket over to the caller, e.g. a DTCHistoricalExecutor, and
+ * drops the connection as DTCServerConnection_close() would. Returns the
+ * descriptor, or -1 with errno EAGAIN while queued output is still unsent.
+ */
+int DTCServerConnection_detach(struct DTCServerConnection *conn);
+
+/*
+ * Starts count reactors on their own threads with SO_REUSEPORT, pinning
+ * thread i to CPU i. Returns 0 on success or -1 with errno set.
+ */
+int DTCServerGroup_start(struct DTCServerGroup *group, const struct DTCServerConfig *config, int count);
+void DTCServerGroup_stop(struct DTCServerGroup *group);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DTC_SERVER_H__ */
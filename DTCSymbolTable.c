@@ -0,0 +1,452 @@
+#include "DTCSymbolTable.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INDEX_MASK (DTC_SYMBOL_INDEX_SIZE - 1)
+#define KEY_WORDS (DTC_SYMBOL_KEY_LENGTH / sizeof(uint64_t))
+
+/* Both fields must stay whole words so keys compare as words */
+typedef char key_length_is_whole_words[DTC_SYMBOL_KEY_LENGTH % sizeof(uint64_t) == 0 ? 1 : -1];
+
+static void make_key(char key[DTC_SYMBOL_KEY_LENGTH], const char *symbol, const char *exchange)
+{
+    size_t i = 0;
+
+    for (; i < SYMBOL_LENGTH && symbol[i] != '\0'; i++)
+        key[i] = symbol[i];
+    for (; i < SYMBOL_LENGTH; i++)
+        key[i] = '\0';
+
+    if (exchange != NULL)
+        for (; i < DTC_SYMBOL_KEY_LENGTH && exchange[i - SYMBOL_LENGTH] != '\0'; i++)
+            key[i] = exchange[i - SYMBOL_LENGTH];
+    for (; i < DTC_SYMBOL_KEY_LENGTH; i++)
+        key[i] = '\0';
+}
+
+static uint32_t hash_key(const char key[DTC_SYMBOL_KEY_LENGTH])
+{
+    uint64_t hash = 0;
+    size_t i;
+
+    for (i = 0; i < KEY_WORDS; i++) {
+        uint64_t word;
+
+        memcpy(&word, key + i * sizeof(word), sizeof(word));
+        hash = (hash ^ word) * UINT64_C(0x9E3779B97F4A7C15);
+        hash ^= hash >> 32;
+    }
+    return (uint32_t)hash;
+}
+
+/* Branch free over the whole key, which the compiler turns into vector compares */
+static int same_key(const char *a, const char *b)
+{
+    uint64_t difference = 0;
+    size_t i;
+
+    for (i = 0; i < KEY_WORDS; i++) {
+        uint64_t x;
+        uint64_t y;
+
+        memcpy(&x, a + i * sizeof(x), sizeof(x));
+        memcpy(&y, b + i * sizeof(y), sizeof(y));
+        difference |= x ^ y;
+    }
+    return difference == 0;
+}
+
+/* Position of key in the index, or -1 */
+static int32_t index_find(const struct DTCSymbolTable *table, const char key[DTC_SYMBOL_KEY_LENGTH], uint32_t hash)
+{
+    uint32_t position = hash & INDEX_MASK;
+
+    while (table->Index[position] != 0) {
+        uint16_t id = table->Index[position];
+
+        if (table->Hash[id] == hash && same_key(table->Names[id], key))
+            return (int32_t)position;
+        position = (position + 1) & INDEX_MASK;
+    }
+    return -1;
+}
+
+/* Removes the entry at position and moves later entries of its probe run back into the gap */
+static void index_erase(struct DTCSymbolTable *table, uint32_t position)
+{
+    uint32_t next = position;
+
+    for (;;) {
+        uint32_t home;
+
+        next = (next + 1) & INDEX_MASK;
+        if (table->Index[next] == 0)
+            break;
+
+        home = table->Hash[table->Index[next]] & INDEX_MASK;
+        if (((next - home) & INDEX_MASK) >= ((next - position) & INDEX_MASK)) {
+            table->Index[position] = table->Index[next];
+            position = next;
+        }
+    }
+    table->Index[position] = 0;
+}
+
+static void released_append(struct DTCSymbolTable *table, uint16_t id)
+{
+    table->ReleasedPrev[id] = table->ReleasedTail;
+    table->ReleasedNext[id] = 0;
+    if (table->ReleasedTail != 0)
+        table->ReleasedNext[table->ReleasedTail] = id;
+    else
+        table->ReleasedHead = id;
+    table->ReleasedTail = id;
+}
+
+static void released_unlink(struct DTCSymbolTable *table, uint16_t id)
+{
+    uint16_t prev = table->ReleasedPrev[id];
+    uint16_t next = table->ReleasedNext[id];
+
+    if (prev != 0)
+        table->ReleasedNext[prev] = next;
+    else
+        table->ReleasedHead = next;
+    if (next != 0)
+        table->ReleasedPrev[next] = prev;
+    else
+        table->ReleasedTail = prev;
+    table->ReleasedPrev[id] = 0;
+    table->ReleasedNext[id] = 0;
+}
+
+/* A never used ID, else the least recently released one with its old name dropped */
+static uint16_t allocate(struct DTCSymbolTable *table)
+{
+    uint16_t id;
+    int32_t position;
+
+    if (table->NextUnused < DTC_SYMBOL_ID_COUNT)
+        return (uint16_t)table->NextUnused++;
+
+    id = table->ReleasedHead;
+    if (id == 0)
+        return 0;
+
+    released_unlink(table, id);
+    position = index_find(table, table->Names[id], table->Hash[id]);
+    if (position >= 0)
+        index_erase(table, (uint32_t)position);
+    memset(table->Names[id], 0, DTC_SYMBOL_KEY_LENGTH);
+    table->Generation[id]++;
+    table->Count--;
+    return id;
+}
+
+void DTCSymbolTable_init(struct DTCSymbolTable *table)
+{
+    memset(table, 0, sizeof(struct DTCSymbolTable));
+    table->NextUnused = 1;
+}
+
+uint16_t DTCSymbolTable_find(const struct DTCSymbolTable *table, const char *symbol, const char *exchange)
+{
+    char key[DTC_SYMBOL_KEY_LENGTH];
+    int32_t position;
+
+    if (symbol[0] == '\0')
+        return 0;
+
+    make_key(key, symbol, exchange);
+    position = index_find(table, key, hash_key(key));
+    return position >= 0 ? table->Index[position] : 0;
+}
+
+uint16_t DTCSymbolTable_intern(struct DTCSymbolTable *table, const char *symbol, const char *exchange)
+{
+    char key[DTC_SYMBOL_KEY_LENGTH];
+    uint32_t hash;
+    int32_t found;
+    uint32_t position;
+    uint16_t id;
+
+    if (symbol[0] == '\0')
+        return 0;
+
+    make_key(key, symbol, exchange);
+    hash = hash_key(key);
+    found = index_find(table, key, hash);
+    if (found >= 0)
+        return table->Index[found];
+
+    id = allocate(table);
+    if (id == 0)
+        return 0;
+
+    memcpy(table->Names[id], key, DTC_SYMBOL_KEY_LENGTH);
+    table->Hash[id] = hash;
+    table->RefCount[id] = 0;
+    released_append(table, id);
+    table->Count++;
+
+    /* The index is twice the ID space, so there is always a free slot */
+    position = hash & INDEX_MASK;
+    while (table->Index[position] != 0)
+        position = (position + 1) & INDEX_MASK;
+    table->Index[position] = id;
+    return id;
+}
+
+void DTCSymbolTable_acquire(struct DTCSymbolTable *table, uint16_t symbol_id)
+{
+    if (symbol_id == 0 || table->Names[symbol_id][0] == '\0')
+        return;
+
+    if (table->RefCount[symbol_id]++ == 0)
+        released_unlink(table, symbol_id);
+}
+
+void DTCSymbolTable_release(struct DTCSymbolTable *table, uint16_t symbol_id)
+{
+    if (symbol_id == 0 || table->RefCount[symbol_id] == 0)
+        return;
+
+    if (--table->RefCount[symbol_id] == 0)
+        released_append(table, symbol_id);
+}
+
+const char *DTCSymbolTable_symbol(const struct DTCSymbolTable *table, uint16_t symbol_id)
+{
+    return table->Names[symbol_id];
+}
+
+const char *DTCSymbolTable_exchange(const struct DTCSymbolTable *table, uint16_t symbol_id)
+{
+    return table->Names[symbol_id] + SYMBOL_LENGTH;
+}
+
+static uint32_t map_home(const struct DTCSymbolMap *map, uint16_t client_id)
+{
+    return ((uint32_t)client_id * 0x9E3779B1u >> 16) & map->Mask;
+}
+
+/* Position of client_id in the map, or of the empty slot where it would go */
+static uint32_t map_position(const struct DTCSymbolMap *map, uint16_t client_id)
+{
+    uint32_t position = map_home(map, client_id);
+
+    while (map->Entries[position].ClientID != 0 && map->Entries[position].ClientID != client_id)
+        position = (position + 1) & map->Mask;
+    return position;
+}
+
+static int map_grow(struct DTCSymbolMap *map)
+{
+    struct DTCSymbolMap grown;
+    uint32_t i;
+
+    grown.Mask = map->Mask * 2 + 1;
+    grown.Count = map->Count;
+    grown.Entries = (struct DTCSymbolMapEntry *)calloc((size_t)grown.Mask + 1, sizeof(struct DTCSymbolMapEntry));
+    if (grown.Entries == NULL)
+        return -1;
+
+    for (i = 0; i <= map->Mask; i++)
+        if (map->Entries[i].ClientID != 0)
+            grown.Entries[map_position(&grown, map->Entries[i].ClientID)] = map->Entries[i];
+
+    free(map->Entries);
+    *map = grown;
+    return 0;
+}
+
+static int map_insert(struct DTCSymbolMap *map, uint16_t client_id, int kind, uint16_t server_id)
+{
+    uint32_t position;
+
+    /* Kept at most half full; 65535 client IDs fit in 2^17 slots */
+    if ((map->Count + 1) * 2 > map->Mask + 1 && map_grow(map) < 0)
+        return -1;
+
+    position = map_position(map, client_id);
+    map->Entries[position].ClientID = client_id;
+    map->Entries[position].ServerID[kind] = server_id;
+    map->Count++;
+    return 0;
+}
+
+static void map_erase(struct DTCSymbolMap *map, uint32_t position)
+{
+    uint32_t next = position;
+
+    for (;;) {
+        uint32_t home;
+
+        next = (next + 1) & map->Mask;
+        if (map->Entries[next].ClientID == 0)
+            break;
+
+        home = map_home(map, map->Entries[next].ClientID);
+        if (((next - home) & map->Mask) >= ((next - position) & map->Mask)) {
+            map->Entries[position] = map->Entries[next];
+            position = next;
+        }
+    }
+    memset(&map->Entries[position], 0, sizeof(struct DTCSymbolMapEntry));
+    map->Count--;
+}
+
+int DTCSymbolMap_init(struct DTCSymbolMap *map, uint32_t capacity)
+{
+    uint32_t size = 16;
+
+    while (size < capacity * 2 && size < 2 * DTC_SYMBOL_ID_COUNT)
+        size *= 2;
+
+    map->Count = 0;
+    map->Mask = size - 1;
+    map->Entries = (struct DTCSymbolMapEntry *)calloc(size, sizeof(struct DTCSymbolMapEntry));
+    if (map->Entries == NULL) {
+        errno = ENOMEM;
+        return -1;
+    }
+    return 0;
+}
+
+void DTCSymbolMap_free(struct DTCSymbolMap *map)
+{
+    free(map->Entries);
+    map->Entries = NULL;
+    map->Mask = 0;
+    map->Count = 0;
+}
+
+uint16_t DTCSymbolMap_find(const struct DTCSymbolMap *map, int kind, uint16_t client_id)
+{
+    if (client_id == 0)
+        return 0;
+    return map->Entries[map_position(map, client_id)].ServerID[kind];
+}
+
+static int map_empty(const struct DTCSymbolMapEntry *entry)
+{
+    int kind;
+
+    for (kind = 0; kind < DTC_SYMBOL_KIND_COUNT; kind++)
+        if (entry->ServerID[kind] != 0)
+            return 0;
+    return 1;
+}
+
+static int subscribe(struct DTCSymbolTable *table, struct DTCSymbolMap *map, int kind, uint16_t client_id,
+                     const char *symbol, const char *exchange, uint16_t *server_id)
+{
+    uint32_t position;
+    uint16_t id;
+    uint16_t previous;
+
+    id = DTCSymbolTable_intern(table, symbol, exchange);
+    if (id == 0)
+        return DTC_SYMBOL_TABLE_FULL;
+    *server_id = id;
+
+    position = map_position(map, client_id);
+    previous = map->Entries[position].ServerID[kind];
+    if (previous == id)
+        return DTC_SYMBOL_OK;
+
+    DTCSymbolTable_acquire(table, id);
+    if (map->Entries[position].ClientID != 0) {
+        map->Entries[position].ServerID[kind] = id;
+        if (previous != 0)
+            DTCSymbolTable_release(table, previous);
+    } else if (map_insert(map, client_id, kind, id) < 0) {
+        DTCSymbolTable_release(table, id);
+        return DTC_SYMBOL_NO_MEMORY;
+    }
+    return DTC_SYMBOL_OK;
+}
+
+int DTCSymbolTable_request(struct DTCSymbolTable *table, struct DTCSymbolMap *map, int kind, int32_t action,
+                           uint16_t client_id, const char *symbol, const char *exchange, uint16_t *server_id)
+{
+    uint32_t position;
+    uint16_t id;
+
+    *server_id = 0;
+    if (kind < 0 || kind >= DTC_SYMBOL_KIND_COUNT)
+        return DTC_SYMBOL_BAD_REQUEST;
+
+    switch (action) {
+    case SUBSCRIBE:
+        if (client_id == 0 || symbol[0] == '\0')
+            return DTC_SYMBOL_BAD_REQUEST;
+        return subscribe(table, map, kind, client_id, symbol, exchange, server_id);
+
+    case UNSUBSCRIBE:
+        if (client_id == 0)
+            return DTC_SYMBOL_BAD_REQUEST;
+        position = map_position(map, client_id);
+        id = map->Entries[position].ServerID[kind];
+        if (id == 0)
+            return DTC_SYMBOL_NOT_SUBSCRIBED;
+        map->Entries[position].ServerID[kind] = 0;
+        if (map_empty(&map->Entries[position]))
+            map_erase(map, position);
+        DTCSymbolTable_release(table, id);
+        *server_id = id;
+        return DTC_SYMBOL_OK;
+
+    case SNAPSHOT:
+        if (symbol[0] == '\0') {
+            /* A snapshot of something already subscribed may name it by ID alone, of either kind */
+            id = DTCSymbolMap_find(map, kind, client_id);
+            if (id == 0)
+                id = DTCSymbolMap_find(map, kind == DTC_SYMBOL_MARKET_DATA ? DTC_SYMBOL_MARKET_DEPTH : DTC_SYMBOL_MARKET_DATA,
+                                       client_id);
+            if (id == 0)
+                return DTC_SYMBOL_BAD_REQUEST;
+        } else {
+            id = DTCSymbolTable_intern(table, symbol, exchange);
+            if (id == 0)
+                return DTC_SYMBOL_TABLE_FULL;
+        }
+        *server_id = id;
+        return DTC_SYMBOL_OK;
+
+    default:
+        return DTC_SYMBOL_BAD_REQUEST;
+    }
+}
+
+int DTCSymbolTable_market_data_request(struct DTCSymbolTable *table, struct DTCSymbolMap *map,
+                                       const struct s_MarketDataRequest *request, uint16_t *server_id)
+{
+    return DTCSymbolTable_request(table, map, DTC_SYMBOL_MARKET_DATA, request->RequestActionValue,
+                                  request->MarketDataSymbolID, request->Symbol, request->Exchange, server_id);
+}
+
+int DTCSymbolTable_market_depth_request(struct DTCSymbolTable *table, struct DTCSymbolMap *map,
+                                        const struct s_MarketDepthRequest *request, uint16_t *server_id)
+{
+    return DTCSymbolTable_request(table, map, DTC_SYMBOL_MARKET_DEPTH, request->RequestActionValue,
+                                  request->MarketDataSymbolID, request->Symbol, request->Exchange, server_id);
+}
+
+void DTCSymbolTable_release_map(struct DTCSymbolTable *table, struct DTCSymbolMap *map)
+{
+    uint32_t i;
+    int kind;
+
+    for (i = 0; i <= map->Mask; i++) {
+        if (map->Entries[i].ClientID == 0)
+            continue;
+        for (kind = 0; kind < DTC_SYMBOL_KIND_COUNT; kind++)
+            if (map->Entries[i].ServerID[kind] != 0)
+                DTCSymbolTable_release(table, map->Entries[i].ServerID[kind]);
+        memset(&map->Entries[i], 0, sizeof(struct DTCSymbolMapEntry));
+    }
+    map->Count = 0;
+}
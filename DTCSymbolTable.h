@@ -0,0 +1,134 @@
+#ifndef __DTC_SYMBOL_TABLE_H__
+#define __DTC_SYMBOL_TABLE_H__
+
+/*
+ * Server side interning of Symbol and Exchange into MarketDataSymbolIDs.
+ *
+ * Every distinct symbol and exchange pair gets one server wide ID that
+ * stays the same while anybody is subscribed. Each connection keeps a
+ * DTCSymbolMap from the IDs its client chose in MarketDataRequest and
+ * MarketDepthRequest to the server IDs, so an UNSUBSCRIBE, which may carry
+ * only the client's ID, finds its symbol without a string lookup.
+ *
+ * The two request types are kept apart: a map entry has a server ID and a
+ * table reference for each kind, so quotes and depth on the same client ID
+ * are subscribed, moved and dropped independently.
+ *
+ * Names are stored as fixed width, zero padded Symbol plus Exchange fields
+ * and compared word by word after a 32 bit hash match, in an open
+ * addressing index with no tombstones. Lookups never allocate.
+ *
+ * An ID whose last subscriber left keeps its name, so a client that
+ * reconnects and resubscribes gets the same ID back with one lookup. IDs
+ * are only recycled once all 65535 have been handed out, least recently
+ * released first. Recycling bumps the ID's Generation so holders of a stale
+ * ID can tell.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "DTCProtocol.h"
+
+#define DTC_SYMBOL_KEY_LENGTH   (SYMBOL_LENGTH + EXCHANGE_LENGTH)
+#define DTC_SYMBOL_INDEX_SIZE   (2 * DTC_SYMBOL_ID_COUNT)
+
+enum DTCSymbolResultEnum {
+    DTC_SYMBOL_OK = 0,
+    DTC_SYMBOL_TABLE_FULL = -1,         /* every ID is subscribed */
+    DTC_SYMBOL_NOT_SUBSCRIBED = -2,     /* UNSUBSCRIBE of an ID the client did not subscribe */
+    DTC_SYMBOL_BAD_REQUEST = -3,        /* no Symbol, MarketDataSymbolID 0 or unknown RequestAction */
+    DTC_SYMBOL_NO_MEMORY = -4
+};
+
+/* Index into DTCSymbolMapEntry.ServerID */
+enum DTCSymbolKindEnum {
+    DTC_SYMBOL_MARKET_DATA = 0,         /* MarketDataRequest */
+    DTC_SYMBOL_MARKET_DEPTH = 1,        /* MarketDepthRequest */
+    DTC_SYMBOL_KIND_COUNT = 2
+};
+
+struct DTCSymbolMapEntry
+{
+    uint16_t ClientID;                  /* 0 if empty */
+    uint16_t ServerID[DTC_SYMBOL_KIND_COUNT];   /* 0 where the kind is not subscribed */
+};
+
+/* One connection's client to server IDs */
+struct DTCSymbolMap
+{
+    struct DTCSymbolMapEntry *Entries;
+    uint32_t Mask;
+    uint32_t Count;
+};
+
+/* Several megabytes; allocate it statically or on the heap */
+struct DTCSymbolTable
+{
+    uint32_t Count;                     /* interned names */
+    uint32_t NextUnused;                /* IDs from here up were never handed out */
+    uint16_t ReleasedHead;              /* least recently released unreferenced ID */
+    uint16_t ReleasedTail;
+    uint32_t RefCount[DTC_SYMBOL_ID_COUNT];
+    uint32_t Generation[DTC_SYMBOL_ID_COUNT];
+    uint32_t Hash[DTC_SYMBOL_ID_COUNT];
+    uint16_t ReleasedPrev[DTC_SYMBOL_ID_COUNT];
+    uint16_t ReleasedNext[DTC_SYMBOL_ID_COUNT];
+    uint16_t Index[DTC_SYMBOL_INDEX_SIZE];          /* ID, 0 if empty */
+    char Names[DTC_SYMBOL_ID_COUNT][DTC_SYMBOL_KEY_LENGTH];
+};
+
+void DTCSymbolTable_init(struct DTCSymbolTable *table);
+
+/*
+ * Symbol and exchange are SYMBOL_LENGTH and EXCHANGE_LENGTH byte fields or
+ * shorter NUL terminated strings; exchange may be NULL.
+ */
+
+/* ID of an interned name, or 0 */
+uint16_t DTCSymbolTable_find(const struct DTCSymbolTable *table, const char *symbol, const char *exchange);
+
+/* ID of the name, interning it unreferenced if new. Returns 0 if the table is full or symbol empty. */
+uint16_t DTCSymbolTable_intern(struct DTCSymbolTable *table, const char *symbol, const char *exchange);
+
+void DTCSymbolTable_acquire(struct DTCSymbolTable *table, uint16_t symbol_id);
+void DTCSymbolTable_release(struct DTCSymbolTable *table, uint16_t symbol_id);
+
+/* The name of an interned ID, not NUL terminated when the field is full */
+const char *DTCSymbolTable_symbol(const struct DTCSymbolTable *table, uint16_t symbol_id);
+const char *DTCSymbolTable_exchange(const struct DTCSymbolTable *table, uint16_t symbol_id);
+
+/*
+ * Handles a RequestActionEnum action of one DTCSymbolKindEnum kind from one
+ * connection. SUBSCRIBE maps client_id to the symbol's ID for that kind and
+ * holds a reference, replacing an earlier symbol of the same kind on the
+ * same client_id. UNSUBSCRIBE drops it again; symbol may be empty. SNAPSHOT
+ * only looks the symbol up, interning it if new. Sets *server_id to the
+ * server ID involved and returns a DTCSymbolResultEnum value.
+ */
+int DTCSymbolTable_request(struct DTCSymbolTable *table, struct DTCSymbolMap *map, int kind, int32_t action,
+                           uint16_t client_id, const char *symbol, const char *exchange, uint16_t *server_id);
+
+int DTCSymbolTable_market_data_request(struct DTCSymbolTable *table, struct DTCSymbolMap *map,
+                                       const struct s_MarketDataRequest *request, uint16_t *server_id);
+int DTCSymbolTable_market_depth_request(struct DTCSymbolTable *table, struct DTCSymbolMap *map,
+                                        const struct s_MarketDepthRequest *request, uint16_t *server_id);
+
+/* Drops every subscription of a connection, e.g. on disconnect, and empties the map */
+void DTCSymbolTable_release_map(struct DTCSymbolTable *table, struct DTCSymbolMap *map);
+
+/* Returns 0 or -1 with errno set. The map grows as needed. */
+int DTCSymbolMap_init(struct DTCSymbolMap *map, uint32_t capacity);
+void DTCSymbolMap_free(struct DTCSymbolMap *map);
+
+/* Server ID a client's MarketDataSymbolID is subscribed to for kind, or 0 */
+uint16_t DTCSymbolMap_find(const struct DTCSymbolMap *map, int kind, uint16_t client_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DTC_SYMBOL_TABLE_H__ */
@@ -0,0 +1,150 @@
+#include "DTCTickPrice.h"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+/* TickSize is a float, its nearest whole numbers are within this fraction */
+#define TICK_TOLERANCE 1e-6
+
+/* Keeps integer prices of ordinary instruments well inside 53 bits */
+#define MAX_DIVISOR 1e9
+
+static int is_whole(double value, double *rounded)
+{
+    *rounded = floor(value + 0.5);
+    return *rounded >= 1 && fabs(value - *rounded) <= *rounded * TICK_TOLERANCE;
+}
+
+int DTCTickScale_init(struct DTCTickScale *scale, double tick_size)
+{
+    double rounded;
+    double power;
+
+    memset(scale, 0, sizeof(struct DTCTickScale));
+    if (!(tick_size > 0))
+        return -1;
+
+    if (is_whole(1 / tick_size, &rounded) && rounded <= MAX_DIVISOR) {
+        scale->Divisor = rounded;
+        scale->TickUnits = 1;
+        scale->TickSize = 1 / rounded;
+        return 0;
+    }
+
+    for (power = 1; power <= MAX_DIVISOR; power *= 10) {
+        if (is_whole(tick_size * power, &rounded)) {
+            scale->Divisor = power;
+            scale->TickUnits = (int64_t)rounded;
+            scale->TickSize = rounded / power;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int DTCTickScale_init_fundamental_data(struct DTCTickScale *scale, const struct s_FundamentalDataResponse *msg)
+{
+    return DTCTickScale_init(scale, msg->TickSize);
+}
+
+int DTCTickScale_init_security_definition(struct DTCTickScale *scale, const struct s_SecurityDefinitionResponse *msg)
+{
+    return DTCTickScale_init(scale, msg->TickSize);
+}
+
+/* llround() of a value outside the int64_t range, or of NaN, is undefined */
+static int in_range(double scaled)
+{
+    return fabs(scaled) < (double)DTC_TICK_MAX_INTEGER;
+}
+
+int DTCTickScale_to_integer(const struct DTCTickScale *scale, double price, int64_t *integer)
+{
+    double scaled = price * scale->Divisor;
+
+    if (price == DBL_MAX || !in_range(scaled))
+        return -1;
+    *integer = (int64_t)llround(scaled);
+    return 0;
+}
+
+double DTCTickScale_to_price(const struct DTCTickScale *scale, int64_t integer)
+{
+    return (double)integer / scale->Divisor;
+}
+
+double DTCTickScale_round(const struct DTCTickScale *scale, double price)
+{
+    double scaled = price * scale->Divisor / (double)scale->TickUnits;
+
+    if (price == DBL_MAX || !in_range(scaled))
+        return price;
+    return DTCTickScale_to_price(scale, (int64_t)llround(scaled) * scale->TickUnits);
+}
+
+static int to_integer32(const struct DTCTickScale *scale, double price, int32_t *integer)
+{
+    int64_t value;
+
+    if (scale->Divisor == 0 || DTCTickScale_to_integer(scale, price, &value) < 0)
+        return -1;
+
+    if (value < INT32_MIN || value > INT32_MAX)
+        return -1;
+
+    *integer = (int32_t)value;
+    return 0;
+}
+
+int DTCTickScale_encode_order(const struct DTCTickScale *scale, struct s_SubmitNewSingleOrder *order)
+{
+    int32_t price1;
+    int32_t price2;
+
+    if (to_integer32(scale, order->Price1, &price1) < 0 || to_integer32(scale, order->Price2, &price2) < 0) {
+        order->Price1AsInteger = 0;
+        order->Price2AsInteger = 0;
+        order->Divisor = 0;
+        return -1;
+    }
+
+    order->Price1AsInteger = price1;
+    order->Price2AsInteger = price2;
+    order->Divisor = (float)scale->Divisor;
+    return 0;
+}
+
+int DTCTickScale_encode_cancel_replace(const struct DTCTickScale *scale, struct s_CancelReplaceOrder *replace)
+{
+    int32_t price1;
+    int32_t price2;
+
+    if (to_integer32(scale, replace->Price1, &price1) < 0 || to_integer32(scale, replace->Price2, &price2) < 0) {
+        replace->Price1AsInteger = 0;
+        replace->Price2AsInteger = 0;
+        replace->Divisor = 0;
+        return -1;
+    }
+
+    replace->Price1AsInteger = price1;
+    replace->Price2AsInteger = price2;
+    replace->Divisor = (float)scale->Divisor;
+    return 0;
+}
+
+void DTCTickPrice_decode_order(struct s_SubmitNewSingleOrder *order)
+{
+    if (order->Divisor != 0) {
+        order->Price1 = (double)order->Price1AsInteger / (double)order->Divisor;
+        order->Price2 = (double)order->Price2AsInteger / (double)order->Divisor;
+    }
+}
+
+void DTCTickPrice_decode_cancel_replace(struct s_CancelReplaceOrder *replace)
+{
+    if (replace->Divisor != 0) {
+        replace->Price1 = (double)replace->Price1AsInteger / (double)replace->Divisor;
+        replace->Price2 = (double)replace->Price2AsInteger / (double)replace->Divisor;
+    }
+}
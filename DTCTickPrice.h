@@ -0,0 +1,70 @@
+#ifndef __DTC_TICK_PRICE_H__
+#define __DTC_TICK_PRICE_H__
+
+/*
+ * Integer prices derived from a symbol's TickSize, as carried by the
+ * Price1AsInteger, Price2AsInteger and Divisor fields of order messages.
+ *
+ * An integer price is the price times Divisor. Divisor is 1 / TickSize when
+ * that is a whole number (0.25 gives 4, 1/32 gives 32) so integer prices
+ * count ticks, and otherwise the power of ten that makes TickSize a whole
+ * number (0.3 gives 10, with ticks 3 units apart). TickSize arrives as a
+ * float, so 0.1f still gives 10.
+ *
+ * The conversions are exact both ways: DTCTickScale_to_price() returns the
+ * double nearest to integer / Divisor, the same value a division anywhere
+ * else produces, and DTCTickScale_to_integer() rounds it back to the same
+ * integer. Prices that are not on the tick grid round to the nearest unit.
+ * Integer prices are kept below DTC_TICK_MAX_INTEGER in magnitude, where
+ * every integer is an exact double; larger prices, infinities, NaN and the
+ * DBL_MAX unset value do not convert.
+ *
+ * The tick size comes from FundamentalDataResponse or
+ * SecurityDefinitionResponse, see DTCTickScale_init_fundamental_data() and
+ * DTCTickScale_init_security_definition().
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "DTCProtocol.h"
+
+#define DTC_TICK_MAX_INTEGER    (INT64_C(1) << 53)
+
+struct DTCTickScale
+{
+    double TickSize;
+    double Divisor;             /* 0 if the scale is not set */
+    int64_t TickUnits;          /* integer units per tick, 1 unless Divisor is a power of ten */
+};
+
+/* Returns 0, or -1 if tick_size is not positive or too fine, leaving Divisor 0 */
+int DTCTickScale_init(struct DTCTickScale *scale, double tick_size);
+int DTCTickScale_init_fundamental_data(struct DTCTickScale *scale, const struct s_FundamentalDataResponse *msg);
+int DTCTickScale_init_security_definition(struct DTCTickScale *scale, const struct s_SecurityDefinitionResponse *msg);
+
+/* Returns 0, or -1 if the price does not convert, leaving *integer unchanged */
+int DTCTickScale_to_integer(const struct DTCTickScale *scale, double price, int64_t *integer);
+double DTCTickScale_to_price(const struct DTCTickScale *scale, int64_t integer);
+
+/* Rounds price to the nearest tick; a price that does not convert is returned as it is */
+double DTCTickScale_round(const struct DTCTickScale *scale, double price);
+
+/*
+ * Fills in Price1AsInteger, Price2AsInteger and Divisor from Price1 and
+ * Price2. Returns 0, or -1 if a price does not fit 32 bits, leaving the
+ * integer fields and Divisor 0 so the receiver uses the double prices.
+ */
+int DTCTickScale_encode_order(const struct DTCTickScale *scale, struct s_SubmitNewSingleOrder *order);
+int DTCTickScale_encode_cancel_replace(const struct DTCTickScale *scale, struct s_CancelReplaceOrder *replace);
+
+/* Sets Price1 and Price2 from the integer fields if the sender set Divisor */
+void DTCTickPrice_decode_order(struct s_SubmitNewSingleOrder *order);
+void DTCTickPrice_decode_cancel_replace(struct s_CancelReplaceOrder *replace);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DTC_TICK_PRICE_H__ */
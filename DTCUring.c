@@ -0,0 +1,606 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "DTCUring.h"
+
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Operation kinds, kept in the low bits of user_data */
+#define OP_RECV         0
+#define OP_SEND         1
+#define OP_ACCEPT       2
+#define OP_CANCEL       3
+#define OP_MASK         3
+
+#define BUFFER_GROUP    0
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *params)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags, void *arg, size_t arg_size)
+{
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, arg_size);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args)
+{
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+/* Publishes the pending submissions and optionally waits for completions */
+static int submit(struct DTCUring *uring, unsigned wait_for, const struct timespec *timeout)
+{
+    struct io_uring_getevents_arg arg;
+    struct __kernel_timespec ts;
+    unsigned to_submit = uring->SqPending - *uring->SqTail;
+    unsigned flags = 0;
+    void *enter_arg = NULL;
+    size_t enter_arg_size = 0;
+    int ret;
+
+    if (to_submit == 0 && wait_for == 0)
+        return 0;
+
+    __atomic_store_n(uring->SqTail, uring->SqPending, __ATOMIC_RELEASE);
+
+    if (wait_for != 0)
+        flags |= IORING_ENTER_GETEVENTS;
+
+    if (timeout != NULL) {
+        memset(&arg, 0, sizeof(arg));
+        ts.tv_sec = timeout->tv_sec;
+        ts.tv_nsec = timeout->tv_nsec;
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+        flags |= IORING_ENTER_EXT_ARG;
+        enter_arg = &arg;
+        enter_arg_size = sizeof(arg);
+    }
+
+    ret = sys_io_uring_enter(uring->RingFd, to_submit, wait_for, flags, enter_arg, enter_arg_size);
+    if (ret < 0 && (errno == ETIME || errno == EINTR))
+        return 0;
+    return ret < 0 ? -1 : 0;
+}
+
+static struct io_uring_sqe *get_sqe(struct DTCUring *uring)
+{
+    unsigned head = __atomic_load_n(uring->SqHead, __ATOMIC_ACQUIRE);
+    unsigned index;
+    struct io_uring_sqe *sqe;
+
+    if (uring->SqPending - head >= uring->SqEntries) {
+        /* Queue full, hand what is there to the kernel first */
+        if (submit(uring, 0, NULL) < 0)
+            return NULL;
+        head = __atomic_load_n(uring->SqHead, __ATOMIC_ACQUIRE);
+        if (uring->SqPending - head >= uring->SqEntries)
+            return NULL;
+    }
+
+    index = uring->SqPending & uring->SqMask;
+    sqe = &uring->Sqes[index];
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    uring->SqArray[index] = index;
+    uring->SqPending++;
+    return sqe;
+}
+
+static void recycle_buffer(struct DTCUring *uring, uint16_t bid)
+{
+    unsigned short tail = uring->BufferRing->tail;
+    struct io_uring_buf *buf = &uring->BufferRing->bufs[tail & (uring->BufferCount - 1)];
+
+    buf->addr = (uint64_t)(uintptr_t)(uring->Buffers + (size_t)bid * uring->BufferSize);
+    buf->len = uring->BufferSize;
+    buf->bid = bid;
+    __atomic_store_n(&uring->BufferRing->tail, (unsigned short)(tail + 1), __ATOMIC_RELEASE);
+}
+
+static int setup_rings(struct DTCUring *uring, unsigned entries)
+{
+    struct io_uring_params params;
+    unsigned char *sq;
+    unsigned char *cq;
+
+    memset(&params, 0, sizeof(params));
+    uring->RingFd = sys_io_uring_setup(entries, &params);
+    if (uring->RingFd < 0)
+        return -1;
+
+    uring->SqRingMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    uring->CqRingMapSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (uring->CqRingMapSize > uring->SqRingMapSize)
+            uring->SqRingMapSize = uring->CqRingMapSize;
+        uring->CqRingMapSize = 0;
+    }
+
+    uring->SqRingMap = mmap(NULL, uring->SqRingMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                            uring->RingFd, IORING_OFF_SQ_RING);
+    if (uring->SqRingMap == MAP_FAILED) {
+        uring->SqRingMap = NULL;
+        return -1;
+    }
+
+    if (uring->CqRingMapSize != 0) {
+        uring->CqRingMap = mmap(NULL, uring->CqRingMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                uring->RingFd, IORING_OFF_CQ_RING);
+        if (uring->CqRingMap == MAP_FAILED) {
+            uring->CqRingMap = NULL;
+            return -1;
+        }
+    }
+
+    uring->SqesMapSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    uring->Sqes = (struct io_uring_sqe *)mmap(NULL, uring->SqesMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                              uring->RingFd, IORING_OFF_SQES);
+    if (uring->Sqes == MAP_FAILED) {
+        uring->Sqes = NULL;
+        return -1;
+    }
+
+    sq = (unsigned char *)uring->SqRingMap;
+    cq = uring->CqRingMap != NULL ? (unsigned char *)uring->CqRingMap : sq;
+
+    uring->SqHead = (unsigned *)(sq + params.sq_off.head);
+    uring->SqTail = (unsigned *)(sq + params.sq_off.tail);
+    uring->SqArray = (unsigned *)(sq + params.sq_off.array);
+    uring->SqMask = *(unsigned *)(sq + params.sq_off.ring_mask);
+    uring->SqEntries = params.sq_entries;
+    uring->SqPending = *uring->SqTail;
+
+    uring->CqHead = (unsigned *)(cq + params.cq_off.head);
+    uring->CqTail = (unsigned *)(cq + params.cq_off.tail);
+    uring->CqMask = *(unsigned *)(cq + params.cq_off.ring_mask);
+    uring->Cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    return 0;
+}
+
+static int setup_buffers(struct DTCUring *uring, uint32_t buffer_count, uint32_t buffer_size)
+{
+    struct io_uring_buf_reg reg;
+    uint32_t i;
+
+    uring->BufferCount = buffer_count;
+    uring->BufferSize = buffer_size;
+
+    uring->BufferRingMapSize = buffer_count * sizeof(struct io_uring_buf);
+    uring->BufferRing = (struct io_uring_buf_ring *)mmap(NULL, uring->BufferRingMapSize, PROT_READ | PROT_WRITE,
+                                                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (uring->BufferRing == MAP_FAILED) {
+        uring->BufferRing = NULL;
+        return -1;
+    }
+
+    uring->Buffers = (unsigned char *)mmap(NULL, (size_t)buffer_count * buffer_size, PROT_READ | PROT_WRITE,
+                                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (uring->Buffers == MAP_FAILED) {
+        uring->Buffers = NULL;
+        return -1;
+    }
+
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)uring->BufferRing;
+    reg.ring_entries = buffer_count;
+    reg.bgid = BUFFER_GROUP;
+    if (sys_io_uring_register(uring->RingFd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+        return -1;
+
+    for (i = 0; i < buffer_count; i++)
+        recycle_buffer(uring, (uint16_t)i);
+
+    return 0;
+}
+
+/* Takes the next completion, waiting up to a second for one. Returns -1 if none came. */
+static int reap(struct DTCUring *uring, struct io_uring_cqe *cqe)
+{
+    struct timespec timeout;
+    unsigned head = *uring->CqHead;
+
+    timeout.tv_sec = 1;
+    timeout.tv_nsec = 0;
+    if (head == __atomic_load_n(uring->CqTail, __ATOMIC_ACQUIRE)
+        && (submit(uring, 1, &timeout) < 0 || head == __atomic_load_n(uring->CqTail, __ATOMIC_ACQUIRE)))
+        return -1;
+
+    *cqe = uring->Cqes[head & uring->CqMask];
+    __atomic_store_n(uring->CqHead, head + 1, __ATOMIC_RELEASE);
+    if (cqe->flags & IORING_CQE_F_BUFFER)
+        recycle_buffer(uring, (uint16_t)(cqe->flags >> IORING_CQE_BUFFER_SHIFT));
+    return 0;
+}
+
+/*
+ * Multishot receive came in Linux 6.0, after the buffer rings (5.19) the
+ * setup already needs, and an older kernel fails every such receive with
+ * EINVAL. Arms one on a socket pair and checks it delivers and stays armed.
+ */
+static int probe_multishot_recv(struct DTCUring *uring)
+{
+    struct io_uring_sqe *sqe;
+    struct io_uring_cqe cqe;
+    int fds[2];
+    int supported = 0;
+
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0)
+        return -1;
+
+    if (write(fds[1], "", 1) == 1 && (sqe = get_sqe(uring)) != NULL) {
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = fds[0];
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = BUFFER_GROUP;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->user_data = OP_CANCEL;
+
+        if (reap(uring, &cqe) == 0) {
+            supported = cqe.res == 1 && (cqe.flags & IORING_CQE_F_MORE);
+
+            /* End the receive with end of file and wait for its last completion */
+            shutdown(fds[0], SHUT_RDWR);
+            while ((cqe.flags & IORING_CQE_F_MORE) && reap(uring, &cqe) == 0)
+                ;
+        }
+    }
+
+    close(fds[0]);
+    close(fds[1]);
+    if (!supported) {
+        errno = EOPNOTSUPP;
+        return -1;
+    }
+    return 0;
+}
+
+int DTCUring_init(struct DTCUring *uring, unsigned entries, uint32_t buffer_count, uint32_t buffer_size,
+                  const struct DTCUringCallbacks *callbacks, void *context)
+{
+    memset(uring, 0, sizeof(struct DTCUring));
+    uring->RingFd = -1;
+    uring->ListenFd = -1;
+    uring->Callbacks = *callbacks;
+    uring->Context = context;
+
+    /* Buffer IDs are 16 bit */
+    if (buffer_count == 0 || (buffer_count & (buffer_count - 1)) != 0 || buffer_count > 32768) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (setup_rings(uring, entries) < 0 || setup_buffers(uring, buffer_count, buffer_size) < 0
+        || probe_multishot_recv(uring) < 0) {
+        int saved = errno;
+        DTCUring_close(uring);
+        errno = saved;
+        return -1;
+    }
+    return 0;
+}
+
+void DTCUring_close(struct DTCUring *uring)
+{
+    if (uring->Buffers != NULL)
+        munmap(uring->Buffers, (size_t)uring->BufferCount * uring->BufferSize);
+    if (uring->BufferRing != NULL)
+        munmap(uring->BufferRing, uring->BufferRingMapSize);
+    if (uring->Sqes != NULL)
+        munmap(uring->Sqes, uring->SqesMapSize);
+    if (uring->CqRingMap != NULL)
+        munmap(uring->CqRingMap, uring->CqRingMapSize);
+    if (uring->SqRingMap != NULL)
+        munmap(uring->SqRingMap, uring->SqRingMapSize);
+    if (uring->RingFd >= 0)
+        close(uring->RingFd);
+
+    uring->Buffers = NULL;
+    uring->BufferRing = NULL;
+    uring->Sqes = NULL;
+    uring->CqRingMap = NULL;
+    uring->SqRingMap = NULL;
+    uring->RingFd = -1;
+}
+
+int DTCUring_supported(void)
+{
+    static const struct DTCUringCallbacks no_callbacks;
+    struct DTCUring uring;
+
+    if (DTCUring_init(&uring, 4, 2, 64, &no_callbacks, NULL) < 0)
+        return 0;
+
+    DTCUring_close(&uring);
+    return 1;
+}
+
+static int arm_accept(struct DTCUring *uring)
+{
+    struct io_uring_sqe *sqe = get_sqe(uring);
+
+    if (sqe == NULL)
+        return -1;
+
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = uring->ListenFd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = (uint64_t)(uintptr_t)uring | OP_ACCEPT;
+    return 0;
+}
+
+static int arm_recv(struct DTCUringConnection *conn)
+{
+    struct io_uring_sqe *sqe = get_sqe(conn->Uring);
+
+    if (sqe == NULL)
+        return -1;
+
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = conn->Fd;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BUFFER_GROUP;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->user_data = (uint64_t)(uintptr_t)conn | OP_RECV;
+    conn->RecvArmed = 1;
+    return 0;
+}
+
+/* One send per connection is in flight at a time so the byte order is kept */
+static void queue_send(struct DTCUringConnection *conn)
+{
+    struct DTCSlice slices[2];
+    struct io_uring_sqe *sqe;
+
+    if (DTCOutputRing_slices(&conn->Output, slices) == 0)
+        return;
+
+    sqe = get_sqe(conn->Uring);
+    if (sqe == NULL)
+        return;
+
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = conn->Fd;
+    sqe->addr = (uint64_t)(uintptr_t)slices[0].Data;
+    sqe->len = (uint32_t)slices[0].Length;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = (uint64_t)(uintptr_t)conn | OP_SEND;
+    conn->SendInFlight = 1;
+}
+
+int DTCUring_add_listener(struct DTCUring *uring, int listen_fd)
+{
+    uring->ListenFd = listen_fd;
+    return arm_accept(uring);
+}
+
+void DTCUringConnection_init(struct DTCUringConnection *conn, int fd, void *send_buffer, size_t send_buffer_size)
+{
+    conn->Uring = NULL;
+    conn->NextSend = NULL;
+    conn->Fd = fd;
+    conn->Closing = 0;
+    conn->RecvArmed = 0;
+    conn->SendInFlight = 0;
+    conn->SendQueued = 0;
+    conn->UserData = NULL;
+    DTCOutputRing_init(&conn->Output, send_buffer, send_buffer_size);
+    DTCDecoder_init(&conn->Decoder);
+}
+
+int DTCUring_add_connection(struct DTCUring *uring, struct DTCUringConnection *conn)
+{
+    conn->Uring = uring;
+    return arm_recv(conn);
+}
+
+int DTCUringConnection_send(struct DTCUringConnection *conn, const void *msg)
+{
+    uint16_t size = ((const struct DTCMessageHeader *)msg)->Size;
+    void *out;
+
+    if (conn->Closing)
+        return -1;
+
+    out = DTCOutputRing_reserve(&conn->Output, size);
+    if (out == NULL)
+        return -1;
+
+    memcpy(out, msg, size);
+    DTCOutputRing_commit(&conn->Output, size);
+
+    if (!conn->SendInFlight && !conn->SendQueued) {
+        conn->SendQueued = 1;
+        conn->NextSend = conn->Uring->SendList;
+        conn->Uring->SendList = conn;
+    }
+    return 0;
+}
+
+/* Hands the connection back once no operation refers to it any more */
+static void release_if_idle(struct DTCUringConnection *conn)
+{
+    struct DTCUring *uring = conn->Uring;
+
+    if (!conn->Closing || conn->RecvArmed || conn->SendInFlight || conn->SendQueued)
+        return;
+
+    close(conn->Fd);
+    conn->Fd = -1;
+    if (uring->Callbacks.on_close != NULL)
+        uring->Callbacks.on_close(uring->Context, conn);
+}
+
+void DTCUringConnection_close(struct DTCUringConnection *conn)
+{
+    struct io_uring_sqe *sqe;
+
+    if (conn->Closing)
+        return;
+
+    /* Unsent output is discarded */
+    conn->Closing = 1;
+    shutdown(conn->Fd, SHUT_RDWR);
+
+    if (conn->RecvArmed && (sqe = get_sqe(conn->Uring)) != NULL) {
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = (uint64_t)(uintptr_t)conn | OP_RECV;
+        sqe->user_data = OP_CANCEL;
+    }
+
+    /* Released from the send list on the next poll, never from inside a handler */
+    if (!conn->SendQueued) {
+        conn->SendQueued = 1;
+        conn->NextSend = conn->Uring->SendList;
+        conn->Uring->SendList = conn;
+    }
+}
+
+static void handle_recv(struct DTCUring *uring, struct DTCUringConnection *conn, const struct io_uring_cqe *cqe)
+{
+    if (cqe->flags & IORING_CQE_F_BUFFER) {
+        uint16_t bid = (uint16_t)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+
+        if (cqe->res > 0 && !conn->Closing) {
+            const struct DTCMessageHeader *msg;
+            int result = DTC_DECODE_NEED_MORE;
+
+            DTCDecoder_feed(&conn->Decoder, uring->Buffers + (size_t)bid * uring->BufferSize, (size_t)cqe->res);
+            while (!conn->Closing && (result = DTCDecoder_next(&conn->Decoder, &msg)) == DTC_DECODE_MESSAGE)
+                uring->Callbacks.on_message(uring->Context, conn, msg);
+
+            if (result == DTC_DECODE_ERROR)
+                DTCUringConnection_close(conn);
+        }
+
+        /* Incomplete frames were copied into the decoder, the buffer can go back */
+        recycle_buffer(uring, bid);
+    }
+
+    if (cqe->res == 0 || (cqe->res < 0 && cqe->res != -ENOBUFS))
+        DTCUringConnection_close(conn);
+
+    if (!(cqe->flags & IORING_CQE_F_MORE)) {
+        conn->RecvArmed = 0;
+        if (!conn->Closing)
+            arm_recv(conn);
+    }
+}
+
+static void handle_send(struct DTCUringConnection *conn, const struct io_uring_cqe *cqe)
+{
+    conn->SendInFlight = 0;
+
+    if (cqe->res < 0) {
+        DTCUringConnection_close(conn);
+        return;
+    }
+
+    DTCOutputRing_consume(&conn->Output, (size_t)cqe->res);
+    if (!conn->Closing)
+        queue_send(conn);
+}
+
+static void handle_accept(struct DTCUring *uring, const struct io_uring_cqe *cqe)
+{
+    if (cqe->res >= 0) {
+        struct DTCUringConnection *conn = NULL;
+
+        if (uring->Callbacks.on_accept != NULL)
+            conn = uring->Callbacks.on_accept(uring->Context, cqe->res);
+
+        if (conn != NULL)
+            DTCUring_add_connection(uring, conn);
+        else
+            close(cqe->res);
+    }
+
+    if (!(cqe->flags & IORING_CQE_F_MORE) && !uring->Stop && cqe->res != -EBADF && cqe->res != -EINVAL)
+        arm_accept(uring);
+}
+
+static int poll_ring(struct DTCUring *uring, unsigned wait_for, const struct timespec *timeout)
+{
+    unsigned head;
+    unsigned tail;
+
+    /* All sends queued since the last poll go out with one submission */
+    while (uring->SendList != NULL) {
+        struct DTCUringConnection *conn = uring->SendList;
+
+        uring->SendList = conn->NextSend;
+        conn->SendQueued = 0;
+        if (conn->Closing)
+            release_if_idle(conn);
+        else if (!conn->SendInFlight)
+            queue_send(conn);
+    }
+
+    if (submit(uring, wait_for, timeout) < 0)
+        return -1;
+
+    head = *uring->CqHead;
+    tail = __atomic_load_n(uring->CqTail, __ATOMIC_ACQUIRE);
+
+    while (head != tail) {
+        struct io_uring_cqe cqe = uring->Cqes[head & uring->CqMask];
+        uintptr_t target = (uintptr_t)(cqe.user_data & ~(uint64_t)OP_MASK);
+
+        /* Free the slot first, handlers may submit and wait */
+        head++;
+        __atomic_store_n(uring->CqHead, head, __ATOMIC_RELEASE);
+
+        switch (cqe.user_data & OP_MASK) {
+        case OP_RECV:
+            handle_recv(uring, (struct DTCUringConnection *)target, &cqe);
+            release_if_idle((struct DTCUringConnection *)target);
+            break;
+        case OP_SEND:
+            handle_send((struct DTCUringConnection *)target, &cqe);
+            release_if_idle((struct DTCUringConnection *)target);
+            break;
+        case OP_ACCEPT:
+            handle_accept(uring, &cqe);
+            break;
+        default:
+            break;
+        }
+
+        if (head == tail)
+            tail = __atomic_load_n(uring->CqTail, __ATOMIC_ACQUIRE);
+    }
+    return 0;
+}
+
+int DTCUring_poll(struct DTCUring *uring, unsigned wait_for)
+{
+    return poll_ring(uring, wait_for, NULL);
+}
+
+int DTCUring_run(struct DTCUring *uring)
+{
+    struct timespec timeout;
+
+    timeout.tv_sec = 1;
+    timeout.tv_nsec = 0;
+
+    while (!uring->Stop) {
+        if (poll_ring(uring, 1, &timeout) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+void DTCUring_stop(struct DTCUring *uring)
+{
+    uring->Stop = 1;
+}
@@ -0,0 +1,147 @@
+#ifndef __DTC_URING_H__
+#define __DTC_URING_H__
+
+/*
+ * io_uring transport for DTC client and server sessions (Linux 6.0+).
+ *
+ * Every connection has one multishot receive armed against a ring of
+ * buffers registered with the kernel, so received bytes land in a
+ * registered buffer and are fed to the connection's DTCDecoder without an
+ * intermediate copy or a syscall per read. Outgoing messages are queued in
+ * each connection's DTCOutputRing and the sends of all connections go to the
+ * kernel in a single io_uring_enter() per loop iteration. A listening socket
+ * can be added with a multishot accept.
+ *
+ * The ring is driven through the raw system calls, there is no liburing
+ * dependency. DTCUring_init() fails with errno set when io_uring is not
+ * available (old kernel, seccomp, io_uring_disabled), EOPNOTSUPP when it
+ * lacks multishot receive, which it tries on a socket pair; callers then
+ * fall back to the epoll reactor in DTCServer.h.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "DTCProtocol.h"
+#include "DTCDecoder.h"
+#include "DTCEncoder.h"
+
+struct DTCUring;
+struct DTCUringConnection;
+struct io_uring_sqe;
+struct io_uring_cqe;
+struct io_uring_buf_ring;
+
+struct DTCUringCallbacks
+{
+    /*
+     * A listener accepted fd. Return a connection initialised with
+     * DTCUringConnection_init(), or NULL to close fd. May be NULL without a
+     * listener.
+     */
+    struct DTCUringConnection *(*on_accept)(void *context, int fd);
+
+    void (*on_message)(void *context, struct DTCUringConnection *conn, const struct DTCMessageHeader *msg);
+
+    /* The connection is no longer used by the ring and may be freed */
+    void (*on_close)(void *context, struct DTCUringConnection *conn);
+};
+
+struct DTCUringConnection
+{
+    struct DTCUring *Uring;
+    struct DTCUringConnection *NextSend;
+    int Fd;
+    int Closing;
+    int RecvArmed;
+    int SendInFlight;
+    int SendQueued;
+    void *UserData;
+    struct DTCOutputRing Output;
+    struct DTCDecoder Decoder;
+};
+
+struct DTCUring
+{
+    int RingFd;
+    int ListenFd;
+    volatile int Stop;
+    struct DTCUringCallbacks Callbacks;
+    void *Context;
+
+    /* Submission queue */
+    unsigned *SqHead;
+    unsigned *SqTail;
+    unsigned *SqArray;
+    unsigned SqMask;
+    unsigned SqEntries;
+    unsigned SqPending;         /* local tail, published on submit */
+    struct io_uring_sqe *Sqes;
+
+    /* Completion queue */
+    unsigned *CqHead;
+    unsigned *CqTail;
+    unsigned CqMask;
+    struct io_uring_cqe *Cqes;
+
+    /* Registered receive buffers */
+    struct io_uring_buf_ring *BufferRing;
+    unsigned char *Buffers;
+    uint32_t BufferCount;       /* power of two */
+    uint32_t BufferSize;
+
+    /* Connections with output waiting for a send */
+    struct DTCUringConnection *SendList;
+
+    void *SqRingMap;
+    void *CqRingMap;
+    size_t SqRingMapSize;
+    size_t CqRingMapSize;
+    size_t SqesMapSize;
+    size_t BufferRingMapSize;
+};
+
+/* Returns 1 if an io_uring with working multishot receive can be set up */
+int DTCUring_supported(void);
+
+/*
+ * entries is the submission queue size. buffer_count (a power of two) buffers
+ * of buffer_size bytes are registered for receives. Returns 0 on success or
+ * -1 with errno set.
+ */
+int DTCUring_init(struct DTCUring *uring, unsigned entries, uint32_t buffer_count, uint32_t buffer_size,
+                  const struct DTCUringCallbacks *callbacks, void *context);
+void DTCUring_close(struct DTCUring *uring);
+
+/* Arms a multishot accept on a bound, listening socket */
+int DTCUring_add_listener(struct DTCUring *uring, int listen_fd);
+
+void DTCUringConnection_init(struct DTCUringConnection *conn, int fd, void *send_buffer, size_t send_buffer_size);
+
+/* Arms the multishot receive of a connected socket, e.g. a client after connect() */
+int DTCUring_add_connection(struct DTCUring *uring, struct DTCUringConnection *conn);
+
+/* Queues a complete message, sent on the next DTCUring_poll(). Returns -1 if the output ring is full. */
+int DTCUringConnection_send(struct DTCUringConnection *conn, const void *msg);
+
+/* Shuts the socket down; on_close follows once the ring has released it */
+void DTCUringConnection_close(struct DTCUringConnection *conn);
+
+/*
+ * Submits all queued sends, waits for at least wait_for completions and
+ * handles every completion available. Returns -1 with errno set on failure.
+ */
+int DTCUring_poll(struct DTCUring *uring, unsigned wait_for);
+
+/* Polls until DTCUring_stop(), which takes effect within a second */
+int DTCUring_run(struct DTCUring *uring);
+void DTCUring_stop(struct DTCUring *uring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DTC_URING_H__ */
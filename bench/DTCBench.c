@@ -0,0 +1,696 @@
+/*
+ * Micro-benchmarks for the DTC C API.
+ *
+ * For every message type: <Name>_init(), encoding into a DTCOutputRing from a
+ * template, frame decoding with DTCDecoder, the message size lookup and
+ * dispatch through a DTCDispatcher, in ns/op and, for decoding, MB/s. The
+ * mixed traffic runs decode a feed of quotes, depth updates and trades into
+ * DTCMarketState and DTCOrderBookSet, once with the full and once with the
+ * compact message variants. The risk run times DTCRisk on single orders with
+ * every check enabled, and the resubscribe run replays every connection of a
+ * DTCSymbolTable dropping and resubscribing its symbols, as after a
+ * reconnect. The fan-out run publishes trades through a DTCFanout to
+ * thousands of subscribers of one symbol. The io_uring run sends trades over
+ * a loopback TCP connection between two DTCUring connections on one ring and
+ * checks every one arrives in order; it is skipped where DTCUring_supported()
+ * is 0, and a lost or reordered trade makes dtcbench exit with status 1.
+ *
+ * Build from this directory:
+ *
+ *   cc -O2 -std=gnu11 -I.. DTCBench.c ../DTCProtocol.c ../DTCDecoder.c \
+ *      ../DTCEncoder.c ../DTCDispatcher.c ../DTCOrderBook.c ../DTCMarketState.c \
+ *      ../DTCOrderCache.c ../DTCPositionKeeper.c ../DTCRisk.c ../DTCTickPrice.c \
+ *      ../DTCSymbolTable.c ../DTCFanout.c ../DTCUring.c -lm -lpthread -o dtcbench
+ *
+ * Usage: dtcbench [iterations] [name filter]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "DTCProtocol.h"
+#include "DTCDecoder.h"
+#include "DTCEncoder.h"
+#include "DTCDispatcher.h"
+#include "DTCOrderBook.h"
+#include "DTCMarketState.h"
+#include "DTCRisk.h"
+#include "DTCSymbolTable.h"
+#include "DTCFanout.h"
+#include "DTCUring.h"
+
+#define STREAM_SIZE (1 << 20)
+#define MIXED_STREAM_SIZE (16 << 20)
+#define MIXED_SYMBOLS 500
+#define MIXED_BOOKS 1024
+
+/* Share of each kind of message in the mixed traffic, in percent */
+#define MIXED_QUOTE_SHARE 60
+#define MIXED_DEPTH_SHARE 32
+#define MIXED_TRADE_SHARE 8
+
+struct bench_result
+{
+    double InitNs;
+    double EncodeNs;
+    double DecodeNs;
+    double DecodeMBps;
+    double LookupNs;
+    double DispatchNs;
+};
+
+/* Keeps the measured work from being optimised away */
+static volatile uint64_t sink;
+
+static unsigned char stream[STREAM_SIZE];
+static unsigned char ring_buffer[STREAM_SIZE];
+static struct DTCMessageTemplates templates;
+static struct DTCDispatcher dispatcher;
+
+static double now_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+static void count_message(void *context, const struct DTCMessageHeader *msg)
+{
+    (void)context;
+    sink += msg->Size;
+}
+
+#define BENCH_INIT(type, name, direction) \
+    static double bench_init_##name(long iterations) \
+    { \
+        struct s_##name msg; \
+        double start = now_ns(); \
+        long i; \
+        for (i = 0; i < iterations; i++) { \
+            name##_init(&msg); \
+            sink += msg.Size; \
+        } \
+        return (now_ns() - start) / (double)iterations; \
+    }
+
+DTC_MESSAGE_LIST(BENCH_INIT)
+
+static double bench_encode(const void *template_msg, long iterations)
+{
+    struct DTCOutputRing ring;
+    double start;
+    long i;
+
+    DTCOutputRing_init(&ring, ring_buffer, sizeof(ring_buffer));
+    start = now_ns();
+    for (i = 0; i < iterations; i++) {
+        struct DTCMessageHeader *out = (struct DTCMessageHeader *)DTCOutputRing_emit(&ring, template_msg);
+
+        if (out == NULL) {
+            /* Stands in for the socket having taken everything */
+            DTCOutputRing_init(&ring, ring_buffer, sizeof(ring_buffer));
+            out = (struct DTCMessageHeader *)DTCOutputRing_emit(&ring, template_msg);
+        }
+        sink += out->Size;
+    }
+    return (now_ns() - start) / (double)iterations;
+}
+
+/* Fills stream with copies of a message, returns the bytes used */
+static size_t fill_stream(const void *template_msg)
+{
+    size_t size = ((const struct DTCMessageHeader *)template_msg)->Size;
+    size_t used = 0;
+
+    while (used + size <= sizeof(stream)) {
+        memcpy(stream + used, template_msg, size);
+        used += size;
+    }
+    return used;
+}
+
+static double bench_decode(size_t length, size_t size, long iterations, double *mb_per_second)
+{
+    struct DTCDecoder decoder;
+    const struct DTCMessageHeader *msg;
+    long frames = 0;
+    double start;
+    double elapsed;
+
+    DTCDecoder_init(&decoder);
+    start = now_ns();
+    while (frames < iterations) {
+        DTCDecoder_feed(&decoder, stream, length);
+        while (DTCDecoder_next(&decoder, &msg) == DTC_DECODE_MESSAGE) {
+            sink += msg->Type;
+            frames++;
+        }
+    }
+    elapsed = now_ns() - start;
+
+    *mb_per_second = (double)frames * (double)size / elapsed * 1e3;
+    return elapsed / (double)frames;
+}
+
+static double bench_lookup(uint16_t msg_type, int direction, long iterations)
+{
+    volatile uint16_t type = msg_type;
+    double start = now_ns();
+    long i;
+
+    if (direction & DTC_SERVER_TO_CLIENT) {
+        for (i = 0; i < iterations; i++)
+            sink += get_respone_message_size(type);
+    } else {
+        for (i = 0; i < iterations; i++)
+            sink += get_request_message_size(type);
+    }
+    return (now_ns() - start) / (double)iterations;
+}
+
+static double bench_dispatch(size_t length, size_t size, long iterations)
+{
+    long done = 0;
+    double start = now_ns();
+
+    while (done < iterations) {
+        size_t offset;
+
+        for (offset = 0; offset + size <= length; offset += size) {
+            DTCDispatcher_dispatch(&dispatcher, (const struct DTCMessageHeader *)(stream + offset));
+            done++;
+        }
+    }
+    return (now_ns() - start) / (double)done;
+}
+
+static void bench_message(const char *name, uint16_t msg_type, int direction, const void *template_msg,
+                          double init_ns, long iterations)
+{
+    size_t size = ((const struct DTCMessageHeader *)template_msg)->Size;
+    size_t length = fill_stream(template_msg);
+    struct bench_result result;
+
+    result.InitNs = init_ns;
+    result.EncodeNs = bench_encode(template_msg, iterations);
+    result.DecodeNs = bench_decode(length, size, iterations, &result.DecodeMBps);
+    result.LookupNs = bench_lookup(msg_type, direction, iterations);
+    result.DispatchNs = bench_dispatch(length, size, iterations);
+
+    printf("%-40s %5u %8.2f %8.2f %8.2f %9.0f %8.2f %8.2f\n", name, (unsigned)size, result.InitNs, result.EncodeNs,
+           result.DecodeNs, result.DecodeMBps, result.LookupNs, result.DispatchNs);
+}
+
+/* Mixed traffic */
+
+static unsigned char mixed_stream[MIXED_STREAM_SIZE];
+static struct DTCMarketState market_state;
+static struct DTCOrderBookSet book_set;
+static struct DTCOrderBook books[MIXED_BOOKS];
+static struct DTCDispatcher mixed_dispatcher;
+
+static uint32_t random_state = 12345;
+
+static uint32_t next_random(void)
+{
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+static void apply_market_state(void *context, const struct DTCMessageHeader *msg)
+{
+    (void)context;
+    DTCMarketState_apply(&market_state, msg);
+}
+
+static void apply_book(void *context, const struct DTCMessageHeader *msg)
+{
+    (void)context;
+    DTCOrderBookSet_apply(&book_set, msg);
+}
+
+/* Appends one message of the mix, returns its size or 0 if the stream is full */
+static size_t append_mixed(size_t used, int compact)
+{
+    uint16_t symbol_id = (uint16_t)(next_random() % MIXED_SYMBOLS);
+    uint32_t kind = next_random() % 100;
+    double price = 100.0 + (double)(next_random() % 40) * 0.25;
+    union
+    {
+        struct s_QuoteIncrementalUpdate Quote;
+        struct s_QuoteIncrementalUpdateCompact QuoteCompact;
+        struct s_MarketDepthIncrementalUpdate Depth;
+        struct s_MarketDepthIncrementalUpdateCompact DepthCompact;
+        struct s_TradeIncrementalUpdate Trade;
+        struct s_TradeIncrementalUpdateCompact TradeCompact;
+    } msg;
+    size_t size;
+
+    if (kind < MIXED_QUOTE_SHARE) {
+        if (compact) {
+            msg.QuoteCompact = templates.QuoteIncrementalUpdateCompact;
+            msg.QuoteCompact.MarketDataSymbolID = symbol_id;
+            msg.QuoteCompact.BidPrice = (float)price;
+            msg.QuoteCompact.AskPrice = (float)(price + 0.25);
+            msg.QuoteCompact.BidSize = msg.QuoteCompact.AskSize = (float)(1 + next_random() % 50);
+        } else {
+            msg.Quote = templates.QuoteIncrementalUpdate;
+            msg.Quote.MarketDataSymbolID = symbol_id;
+            msg.Quote.BidPrice = price;
+            msg.Quote.AskPrice = price + 0.25;
+            msg.Quote.BidSize = msg.Quote.AskSize = (float)(1 + next_random() % 50);
+        }
+    } else if (kind < MIXED_QUOTE_SHARE + MIXED_DEPTH_SHARE) {
+        unsigned char update_type = next_random() % 4 == 0 ? DEPTH_DELETE : DEPTH_INSERT_UPDATE;
+        uint16_t side = next_random() % 2 ? AT_BID : AT_ASK;
+
+        if (compact) {
+            msg.DepthCompact = templates.MarketDepthIncrementalUpdateCompact;
+            msg.DepthCompact.MarketDataSymbolID = symbol_id;
+            msg.DepthCompact.Side = side;
+            msg.DepthCompact.Price = (float)price;
+            msg.DepthCompact.Volume = (float)(1 + next_random() % 100);
+            msg.DepthCompact.UpdateType = update_type;
+        } else {
+            msg.Depth = templates.MarketDepthIncrementalUpdate;
+            msg.Depth.MarketDataSymbolID = symbol_id;
+            msg.Depth.Side = side;
+            msg.Depth.Price = price;
+            msg.Depth.Volume = (double)(1 + next_random() % 100);
+            msg.Depth.UpdateType = update_type;
+        }
+    } else {
+        if (compact) {
+            msg.TradeCompact = templates.TradeIncrementalUpdateCompact;
+            msg.TradeCompact.MarketDataSymbolID = symbol_id;
+            msg.TradeCompact.Price = (float)price;
+            msg.TradeCompact.TradeVolume = (float)(1 + next_random() % 10);
+        } else {
+            msg.Trade = templates.TradeIncrementalUpdate;
+            msg.Trade.MarketDataSymbolID = symbol_id;
+            msg.Trade.Price = price;
+            msg.Trade.TradeVolume = (double)(1 + next_random() % 10);
+        }
+    }
+
+    size = ((const struct DTCMessageHeader *)&msg)->Size;
+    if (used + size > sizeof(mixed_stream))
+        return 0;
+
+    memcpy(mixed_stream + used, &msg, size);
+    return size;
+}
+
+static void bench_mixed(int compact, long iterations)
+{
+    struct DTCDecoder decoder;
+    const struct DTCMessageHeader *msg;
+    size_t length = 0;
+    size_t size;
+    uint16_t symbol_id;
+    long messages = 0;
+    uint64_t bytes = 0;
+    double start;
+    double elapsed;
+
+    random_state = 12345;
+    while ((size = append_mixed(length, compact)) != 0)
+        length += size;
+
+    DTCMarketState_init(&market_state);
+    DTCOrderBookSet_init(&book_set, books, MIXED_BOOKS);
+
+    /* Prices are on a 0.25 grid, books match levels on integer ticks */
+    for (symbol_id = 0; symbol_id < MIXED_SYMBOLS; symbol_id++)
+        DTCOrderBook_set_tick_size(DTCOrderBookSet_get(&book_set, symbol_id, 1), 0.25);
+    DTCDecoder_init(&decoder);
+
+    start = now_ns();
+    while (messages < iterations) {
+        /* Feed in socket sized pieces so frames get split across chunks */
+        size_t offset;
+
+        for (offset = 0; offset < length; offset += 16384) {
+            DTCDecoder_feed(&decoder, mixed_stream + offset, length - offset < 16384 ? length - offset : 16384);
+            while (DTCDecoder_next(&decoder, &msg) == DTC_DECODE_MESSAGE) {
+                DTCDispatcher_dispatch(&mixed_dispatcher, msg);
+                bytes += msg->Size;
+                messages++;
+            }
+        }
+    }
+    elapsed = now_ns() - start;
+
+    printf("mixed %-8s %d/%d/%d quote/depth/trade: %8.2f ns/msg %8.2f M msg/s %9.0f MB/s\n",
+           compact ? "compact" : "full", MIXED_QUOTE_SHARE, MIXED_DEPTH_SHARE, MIXED_TRADE_SHARE,
+           elapsed / (double)messages, (double)messages / elapsed * 1e3,
+           (double)bytes / elapsed * 1e3);
+}
+
+/* Pre-trade risk */
+
+#define RISK_ORDERS 1024
+
+static struct DTCPositionKeeper risk_positions;
+static struct s_SubmitNewSingleOrder risk_orders[RISK_ORDERS];
+static struct DTCRisk risk;
+
+static void bench_risk(long iterations)
+{
+    struct DTCRiskLimits limits;
+    uint16_t symbol_id;
+    long accepted = 0;
+    double start;
+    double elapsed;
+    long i;
+
+    DTCMarketState_init(&market_state);
+    for (symbol_id = 1; symbol_id <= MIXED_SYMBOLS; symbol_id++) {
+        market_state.Bid[symbol_id] = 100.0;
+        market_state.Ask[symbol_id] = 100.25;
+    }
+
+    /* Open positions for 16 accounts on every symbol so the position check finds one */
+    if (DTCPositionKeeper_init(&risk_positions, 16 * MIXED_SYMBOLS) != 0)
+        return;
+    for (i = 0; i < 16 * MIXED_SYMBOLS; i++) {
+        char account[TRADE_ACCOUNT_LENGTH];
+        char symbol[SYMBOL_LENGTH];
+
+        snprintf(account, sizeof(account), "ACCOUNT%ld", i % 16);
+        snprintf(symbol, sizeof(symbol), "SYM%ld", i / 16);
+        DTCPositionKeeper_add_fill(&risk_positions, account, symbol, "EX", BUY, 100.0, 5, 0);
+    }
+
+    memset(&limits, 0, sizeof(limits));
+    limits.MaxOrderQuantity = 100;
+    limits.PriceCollar = 0.05;
+    limits.MaxPosition = 1000;
+    limits.MaxOrdersPerSecond = 1e12;
+    DTCRisk_init(&risk, &limits, &market_state, &risk_positions, NULL);
+
+    /* A rotating set of orders over different accounts, symbols and sides */
+    for (i = 0; i < RISK_ORDERS; i++) {
+        struct s_SubmitNewSingleOrder *order = &risk_orders[i];
+
+        SubmitNewSingleOrder_init(order);
+        snprintf(order->TradeAccount, sizeof(order->TradeAccount), "ACCOUNT%ld", i % 16);
+        snprintf(order->Symbol, sizeof(order->Symbol), "SYM%ld", (i * 7) % MIXED_SYMBOLS);
+        strcpy(order->Exchange, "EX");
+        order->OrderType = ORDER_TYPE_LIMIT;
+        order->BuySell = i & 1 ? BUY : SELL;
+        order->Price1 = i & 1 ? 100.0 : 100.25;
+        order->OrderQuantity = 1;
+    }
+
+    start = now_ns();
+    for (i = 0; i < iterations; i++) {
+        long n = i % RISK_ORDERS;
+
+        accepted += DTCRisk_check_single(&risk, &risk_orders[n], (uint16_t)(1 + (n * 7) % MIXED_SYMBOLS),
+                                         (uint64_t)start + (uint64_t)i) == DTC_RISK_ACCEPT;
+    }
+    elapsed = now_ns() - start;
+
+    printf("risk check single order, all checks:   %8.2f ns/order (%ld of %ld accepted)\n",
+           elapsed / (double)iterations, accepted, iterations);
+    DTCPositionKeeper_free(&risk_positions);
+}
+
+/* Resubscribe storm */
+
+#define STORM_CONNECTIONS 64
+#define STORM_SYMBOLS 10000
+#define STORM_SUBSCRIPTIONS 500
+
+static struct DTCSymbolTable symbol_table;
+static struct DTCSymbolMap storm_maps[STORM_CONNECTIONS];
+static struct s_MarketDataRequest storm_requests[STORM_SYMBOLS];
+
+static void bench_resubscribe(long iterations)
+{
+    long requests = 0;
+    long rounds;
+    uint16_t server_id;
+    double start;
+    double elapsed;
+    long round;
+    int connection;
+    int i;
+
+    DTCSymbolTable_init(&symbol_table);
+    for (i = 0; i < STORM_SYMBOLS; i++) {
+        MarketDataRequest_init(&storm_requests[i]);
+        storm_requests[i].RequestActionValue = SUBSCRIBE;
+        snprintf(storm_requests[i].Symbol, sizeof(storm_requests[i].Symbol), "SYM%d", i);
+        strcpy(storm_requests[i].Exchange, "EX");
+    }
+    for (connection = 0; connection < STORM_CONNECTIONS; connection++)
+        if (DTCSymbolMap_init(&storm_maps[connection], STORM_SUBSCRIPTIONS) != 0)
+            return;
+
+    rounds = iterations / (STORM_CONNECTIONS * STORM_SUBSCRIPTIONS);
+    if (rounds < 1)
+        rounds = 1;
+
+    start = now_ns();
+    for (round = 0; round < rounds; round++) {
+        for (connection = 0; connection < STORM_CONNECTIONS; connection++) {
+            DTCSymbolTable_release_map(&symbol_table, &storm_maps[connection]);
+            for (i = 0; i < STORM_SUBSCRIPTIONS; i++) {
+                struct s_MarketDataRequest *request = &storm_requests[(connection * 157 + i * 13) % STORM_SYMBOLS];
+
+                request->MarketDataSymbolID = (uint16_t)(i + 1);
+                DTCSymbolTable_market_data_request(&symbol_table, &storm_maps[connection], request, &server_id);
+                sink += server_id;
+                requests++;
+            }
+        }
+    }
+    elapsed = now_ns() - start;
+
+    printf("resubscribe storm, %d connections:      %8.2f ns/request (%u symbols interned)\n",
+           STORM_CONNECTIONS, elapsed / (double)requests, symbol_table.Count);
+    for (connection = 0; connection < STORM_CONNECTIONS; connection++)
+        DTCSymbolMap_free(&storm_maps[connection]);
+}
+
+/* Trade fan-out */
+
+#define FANOUT_SUBSCRIBERS 5000
+
+static struct DTCFanout fanout;
+static int fanout_subscribers[FANOUT_SUBSCRIBERS];
+
+static void count_send(void *context, void *subscriber, const struct DTCMessageHeader *msg)
+{
+    (void)context;
+    sink += (uint64_t)*(int *)subscriber + msg->Size;
+}
+
+static void bench_fanout(long iterations)
+{
+    struct s_TradeIncrementalUpdate trade;
+    long deliveries = 0;
+    long messages;
+    double start;
+    double elapsed;
+    long i;
+    int reader;
+
+    DTCFanout_init(&fanout);
+    reader = DTCFanout_register_reader(&fanout);
+
+    /* One in four clients picked a MarketDataSymbolID of their own and gets a rewritten copy */
+    for (i = 0; i < FANOUT_SUBSCRIBERS; i++) {
+        fanout_subscribers[i] = (int)i;
+        DTCFanout_subscribe(&fanout, 1, DTC_FANOUT_MARKET_DATA, &fanout_subscribers[i], (uint16_t)(i % 4 == 0 ? 2 : 1), 0);
+    }
+
+    TradeIncrementalUpdate_init(&trade);
+    trade.MarketDataSymbolID = 1;
+    trade.Price = 100.25;
+    trade.TradeVolume = 1;
+
+    messages = iterations / FANOUT_SUBSCRIBERS;
+    if (messages < 1)
+        messages = 1;
+
+    start = now_ns();
+    for (i = 0; i < messages; i++) {
+        deliveries += DTCFanout_publish(&fanout, (const struct DTCMessageHeader *)&trade, -1, count_send, NULL);
+        DTCFanout_quiescent(&fanout, reader);
+    }
+    elapsed = now_ns() - start;
+
+    printf("trade fan-out, %d subscribers:        %8.2f ns/delivery %10.0f ns/trade\n",
+           FANOUT_SUBSCRIBERS, elapsed / (double)deliveries, elapsed / (double)messages);
+    DTCFanout_free(&fanout);
+}
+
+#define URING_BUFFER_SIZE (1 << 16)
+
+static struct DTCUring uring;
+static struct DTCUringConnection uring_client;
+static struct DTCUringConnection uring_server;
+static unsigned char uring_client_buffer[URING_BUFFER_SIZE];
+static unsigned char uring_server_buffer[URING_BUFFER_SIZE];
+static long uring_received;
+static long uring_out_of_order;
+static int uring_accepted;
+static int uring_closed;
+
+static struct DTCUringConnection *uring_accept(void *context, int fd)
+{
+    (void)context;
+    if (uring_accepted)
+        return NULL;
+    uring_accepted = 1;
+    DTCUringConnection_init(&uring_server, fd, uring_server_buffer, sizeof(uring_server_buffer));
+    return &uring_server;
+}
+
+static void uring_message(void *context, struct DTCUringConnection *conn, const struct DTCMessageHeader *msg)
+{
+    (void)context;
+    if (conn != &uring_server || msg->Type != TRADE_INCREMENTAL_UPDATE
+        || ((const struct s_TradeIncrementalUpdate *)msg)->TradeVolume != (double)(uring_received + 1))
+        uring_out_of_order++;
+    uring_received++;
+}
+
+static void uring_close(void *context, struct DTCUringConnection *conn)
+{
+    (void)context;
+    (void)conn;
+    uring_closed++;
+}
+
+/* Returns -1 if a trade was lost or reordered */
+static int bench_uring(long iterations)
+{
+    static const struct DTCUringCallbacks callbacks = { uring_accept, uring_message, uring_close };
+    struct s_TradeIncrementalUpdate trade;
+    struct sockaddr_in address;
+    socklen_t address_size = sizeof(address);
+    int listen_fd;
+    int client_fd;
+    double start;
+    double elapsed;
+    long sent = 0;
+
+    if (!DTCUring_supported()) {
+        printf("io_uring loopback:                       skipped, not supported here\n");
+        return 0;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    client_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0 || client_fd < 0 || bind(listen_fd, (struct sockaddr *)&address, sizeof(address)) != 0
+        || listen(listen_fd, 1) != 0 || getsockname(listen_fd, (struct sockaddr *)&address, &address_size) != 0
+        || connect(client_fd, (struct sockaddr *)&address, sizeof(address)) != 0
+        || DTCUring_init(&uring, 256, 64, 16384, &callbacks, NULL) != 0) {
+        perror("io_uring loopback");
+        return -1;
+    }
+
+    DTCUring_add_listener(&uring, listen_fd);
+    DTCUringConnection_init(&uring_client, client_fd, uring_client_buffer, sizeof(uring_client_buffer));
+    DTCUring_add_connection(&uring, &uring_client);
+    while (!uring_accepted)
+        DTCUring_poll(&uring, 1);
+
+    TradeIncrementalUpdate_init(&trade);
+    trade.MarketDataSymbolID = 1;
+    trade.Price = 100.25;
+
+    /* Bursts go out as one send each; the loop waits only when the output ring is full */
+    start = now_ns();
+    while (uring_received < iterations) {
+        while (sent < iterations) {
+            trade.TradeVolume = (double)(sent + 1);
+            if (DTCUringConnection_send(&uring_client, &trade) != 0)
+                break;
+            sent++;
+        }
+        if (DTCUring_poll(&uring, 1) != 0 || uring_client.Closing || uring_server.Closing)
+            break;
+    }
+    elapsed = now_ns() - start;
+
+    DTCUringConnection_close(&uring_client);
+    DTCUringConnection_close(&uring_server);
+    while (uring_closed < 2)
+        DTCUring_poll(&uring, 1);
+    DTCUring_close(&uring);
+    close(listen_fd);
+
+    printf("io_uring loopback trades:                %8.2f ns/msg %8.2f M msg/s (%ld lost or out of order)\n",
+           elapsed / (double)iterations, (double)iterations * 1e3 / elapsed,
+           iterations - uring_received + uring_out_of_order);
+    return uring_received == iterations && uring_out_of_order == 0 ? 0 : -1;
+}
+
+static void setup_mixed_dispatcher(void)
+{
+    DTCDispatcher_init(&mixed_dispatcher, NULL);
+    DTCDispatcher_set(&mixed_dispatcher, QUOTE_INCREMENTAL_UPDATE, apply_market_state);
+    DTCDispatcher_set(&mixed_dispatcher, QUOTE_INCREMENTAL_UPDATE_COMPACT, apply_market_state);
+    DTCDispatcher_set(&mixed_dispatcher, TRADE_INCREMENTAL_UPDATE, apply_market_state);
+    DTCDispatcher_set(&mixed_dispatcher, TRADE_INCREMENTAL_UPDATE_COMPACT, apply_market_state);
+    DTCDispatcher_set(&mixed_dispatcher, MARKET_DEPTH_INCREMENTAL_UPDATE, apply_book);
+    DTCDispatcher_set(&mixed_dispatcher, MARKET_DEPTH_INCREMENTAL_UPDATE_COMPACT, apply_book);
+}
+
+int main(int argc, char **argv)
+{
+    long iterations = argc > 1 ? atol(argv[1]) : 1000000;
+    const char *filter = argc > 2 ? argv[2] : NULL;
+    uint16_t msg_type;
+    int failed = 0;
+
+    if (iterations <= 0)
+        iterations = 1000000;
+
+    DTCMessageTemplates_init(&templates);
+    DTCDispatcher_init(&dispatcher, NULL);
+    for (msg_type = 0; msg_type < DTC_MESSAGE_TYPE_COUNT; msg_type++)
+        DTCDispatcher_set(&dispatcher, msg_type, count_message);
+
+    printf("%-40s %5s %8s %8s %8s %9s %8s %8s\n", "message", "size", "init", "encode", "decode", "decode", "lookup", "dispatch");
+    printf("%-40s %5s %8s %8s %8s %9s %8s %8s\n", "", "bytes", "ns/op", "ns/op", "ns/op", "MB/s", "ns/op", "ns/op");
+
+#define BENCH_MESSAGE(type, name, direction) \
+    if (filter == NULL || strstr(#name, filter) != NULL) \
+        bench_message(#name, type, direction, &templates.name, bench_init_##name(iterations), iterations);
+
+    DTC_MESSAGE_LIST(BENCH_MESSAGE)
+
+#undef BENCH_MESSAGE
+
+    if (filter == NULL) {
+        printf("\n");
+        setup_mixed_dispatcher();
+        bench_mixed(0, iterations * 10);
+        bench_mixed(1, iterations * 10);
+        bench_risk(iterations * 10);
+        bench_resubscribe(iterations * 10);
+        bench_fanout(iterations * 10);
+        failed = bench_uring(iterations) != 0;
+    }
+
+    printf("\n(checksum %llu)\n", (unsigned long long)sink);
+    return failed;
+}